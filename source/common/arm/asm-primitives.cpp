@@ -40,6 +40,11 @@ extern "C" {
 namespace X265_NS {
 // private x265 namespace
 
+#if HAVE_NEON
+void setupColorConvertPrimitives_neon(EncoderPrimitives &p);
+void setupFecPrimitives_neon(EncoderPrimitives &p);
+#endif
+
 void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask)
 {
     if (cpuMask & X265_CPU_NEON)
@@ -1012,6 +1017,10 @@ void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask)
         p.cu[BLOCK_4x4].psy_cost_pp = PFX(psyCost_4x4_neon);
         p.cu[BLOCK_8x8].psy_cost_pp = PFX(psyCost_8x8_neon);
 #endif // !HIGH_BIT_DEPTH
+#if HAVE_NEON
+        setupColorConvertPrimitives_neon(p); // colorconvert-neon.cpp
+        setupFecPrimitives_neon(p); // fec-neon.cpp
+#endif
     }
     if (cpuMask & X265_CPU_ARMV6)
     {
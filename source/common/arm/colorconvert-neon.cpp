@@ -0,0 +1,358 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+
+#if HAVE_NEON
+#include <arm_neon.h>
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* de-interleave 16 packed pixels, vld3/vld4 do all the work */
+template<int packing>
+inline void load(const uint8_t* src, uint8x16_t& r, uint8x16_t& g, uint8x16_t& b)
+{
+    typedef RGBLayout<packing> L;
+    if (L::bpp == 3)
+    {
+        uint8x16x3_t v = vld3q_u8(src);
+        r = v.val[L::r];
+        g = v.val[L::g];
+        b = v.val[L::b];
+    }
+    else
+    {
+        uint8x16x4_t v = vld4q_u8(src);
+        r = v.val[L::r];
+        g = v.val[L::g];
+        b = v.val[L::b];
+    }
+}
+
+/* RGB565: vld2 splits the low and high bytes of 16 pixels */
+template<>
+inline void load<RGB_PACKING_RGB565>(const uint8_t* src, uint8x16_t& r, uint8x16_t& g, uint8x16_t& b)
+{
+    uint8x16x2_t v = vld2q_u8(src);
+    uint8x16_t lo = v.val[0];
+    uint8x16_t hi = v.val[1];
+
+    r = vorrq_u8(vandq_u8(hi, vdupq_n_u8(0xF8)), vshrq_n_u8(hi, 5));
+    g = vorrq_u8(vshlq_n_u8(hi, 5), vshlq_n_u8(vshrq_n_u8(lo, 5), 2));
+    g = vorrq_u8(g, vshrq_n_u8(g, 6));
+    b = vshlq_n_u8(lo, 3);
+    b = vorrq_u8(b, vshrq_n_u8(b, 5));
+}
+
+/* weighted sum of 8 16bit R, G, B triplets, saturated to 8 bytes */
+template<int shift>
+inline uint8x8_t dot3(uint16x8_t r, uint16x8_t g, uint16x8_t b, const int16_t w[3], int32x4_t add)
+{
+    int16x8_t sr = vreinterpretq_s16_u16(r);
+    int16x8_t sg = vreinterpretq_s16_u16(g);
+    int16x8_t sb = vreinterpretq_s16_u16(b);
+
+    int32x4_t lo = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(add, vget_low_s16(sr), w[0]), vget_low_s16(sg), w[1]), vget_low_s16(sb), w[2]);
+    int32x4_t hi = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(add, vget_high_s16(sr), w[0]), vget_high_s16(sg), w[1]), vget_high_s16(sb), w[2]);
+
+    return vqmovn_u16(vcombine_u16(vqshrun_n_s32(lo, shift), vqshrun_n_s32(hi, shift)));
+}
+
+/* convert 16 pixels of one row to a single Y, Cb or Cr component */
+inline uint8x16_t convert16(uint8x16_t r, uint8x16_t g, uint8x16_t b, const int16_t w[3], int32x4_t add)
+{
+    return vcombine_u8(dot3<RGB2YUV_SHIFT>(vmovl_u8(vget_low_u8(r)), vmovl_u8(vget_low_u8(g)), vmovl_u8(vget_low_u8(b)), w, add),
+                       dot3<RGB2YUV_SHIFT>(vmovl_u8(vget_high_u8(r)), vmovl_u8(vget_high_u8(g)), vmovl_u8(vget_high_u8(b)), w, add));
+}
+
+template<int packing>
+void rgb2yuv_i444_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const int32x4_t addY = vdupq_n_s32(rgb2yuvLumaAdd(*coeffs));
+    const int32x4_t addC = vdupq_n_s32(rgb2yuvChromaAdd());
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            uint8x16_t r, g, b;
+            load<packing>(src + x * L::bpp, r, g, b);
+
+            vst1q_u8(dstY + x, convert16(r, g, b, coeffs->y, addY));
+            vst1q_u8(dstU + x, convert16(r, g, b, coeffs->u, addC));
+            vst1q_u8(dstV + x, convert16(r, g, b, coeffs->v, addC));
+        }
+
+        rgb2yuvRow444<packing>(src, dstY, dstU, dstV, widthV, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i420_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const int32x4_t addY = vdupq_n_s32(rgb2yuvLumaAdd(*coeffs));
+    const int32x4_t addC = vdupq_n_s32(rgb2yuvChroma420Add());
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 16)
+        {
+            uint8x16_t r0, g0, b0, r1, g1, b1;
+            load<packing>(src + x * L::bpp, r0, g0, b0);
+            load<packing>(src1 + x * L::bpp, r1, g1, b1);
+
+            vst1q_u8(dstY + x, convert16(r0, g0, b0, coeffs->y, addY));
+            vst1q_u8(dstY1 + x, convert16(r1, g1, b1, coeffs->y, addY));
+
+            /* 2x2 sums: pairwise widening add of each row, then add the rows */
+            uint16x8_t sr = vaddq_u16(vpaddlq_u8(r0), vpaddlq_u8(r1));
+            uint16x8_t sg = vaddq_u16(vpaddlq_u8(g0), vpaddlq_u8(g1));
+            uint16x8_t sb = vaddq_u16(vpaddlq_u8(b0), vpaddlq_u8(b1));
+
+            vst1_u8(dstU + (x >> 1), dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, coeffs->u, addC));
+            vst1_u8(dstV + (x >> 1), dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, coeffs->v, addC));
+        }
+
+        rgb2yuvRow420<packing>(src, src1, dstY, dstY1, dstU, dstV, widthV, width, *coeffs);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2gbr_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR,
+                  intptr_t dstStride, int width, int height)
+{
+    typedef RGBLayout<packing> L;
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            uint8x16_t r, g, b;
+            load<packing>(src + x * L::bpp, r, g, b);
+
+            vst1q_u8(dstG + x, g);
+            vst1q_u8(dstB + x, b);
+            vst1q_u8(dstR + x, r);
+        }
+
+        rgb2gbrRow<packing>(src, dstG, dstB, dstR, widthV, width);
+
+        src += srcStride;
+        dstG += dstStride;
+        dstB += dstStride;
+        dstR += dstStride;
+    }
+}
+
+void yuyv2yuv_i422_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 32)
+        {
+            /* Y even, U, Y odd, V */
+            uint8x16x4_t v = vld4q_u8(src + 2 * x);
+            uint8x16x2_t luma = { { v.val[0], v.val[2] } };
+
+            vst2q_u8(dstY + x, luma);
+            vst1q_u8(dstU + (x >> 1), v.val[1]);
+            vst1q_u8(dstV + (x >> 1), v.val[3]);
+        }
+
+        yuyv2yuvRow422(src, dstY, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void yuyv2yuv_i420_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 32)
+        {
+            uint8x16x4_t v0 = vld4q_u8(src + 2 * x);
+            uint8x16x4_t v1 = vld4q_u8(src1 + 2 * x);
+            uint8x16x2_t luma0 = { { v0.val[0], v0.val[2] } };
+            uint8x16x2_t luma1 = { { v1.val[0], v1.val[2] } };
+
+            vst2q_u8(dstY + x, luma0);
+            vst2q_u8(dstY1 + x, luma1);
+            vst1q_u8(dstU + (x >> 1), vrhaddq_u8(v0.val[1], v1.val[1]));
+            vst1q_u8(dstV + (x >> 1), vrhaddq_u8(v0.val[3], v1.val[3]));
+        }
+
+        yuyv2yuvRow420(src, src1, dstY, dstY1, dstU, dstV, widthV, width);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void uvsplit_neon(const uint8_t* src, intptr_t srcStride, uint8_t* dstU, uint8_t* dstV, intptr_t dstStride, int width, int height)
+{
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            uint8x16x2_t v = vld2q_u8(src + 2 * x);
+            vst1q_u8(dstU + x, v.val[0]);
+            vst1q_u8(dstV + x, v.val[1]);
+        }
+
+        uvsplitRow(src, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstU += dstStride;
+        dstV += dstStride;
+    }
+}
+
+/* One output pixel at a time, its channels in the four 32bit accumulator
+ * lanes. Each tap pair loads 8 bytes, the 3 byte packing spreading them to
+ * four channel slots first */
+template<int bpp>
+void scaleh_neon(const uint8_t* src, int16_t* dst, const int32_t* pos, const int16_t* coeffs, int taps, int width, int srcWidth)
+{
+    static const uint8_t spread[8] = { 0, 1, 2, 255, 3, 4, 5, 255 };
+    const uint8x8_t order = vld1_u8(spread);
+
+    /* the 8 byte loads of a window must stay within the row */
+    int widthV = width;
+    while (widthV > 0 && (pos[widthV - 1] + taps - 2) * bpp + 8 > srcWidth * bpp)
+        widthV--;
+
+    for (int x = 0; x < widthV; x++)
+    {
+        const uint8_t* px = src + pos[x] * bpp;
+        const int16_t* c = coeffs + x * taps;
+        int32x4_t sum = vdupq_n_s32(1 << (SCALE_SHIFT_H - 1));
+
+        for (int k = 0; k < taps; k += 2)
+        {
+            uint8x8_t raw = vld1_u8(px + k * bpp);
+            if (bpp == 3)
+                raw = vtbl1_u8(raw, order);
+            int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(raw));
+            sum = vmlal_n_s16(sum, vget_low_s16(v), c[k]);
+            sum = vmlal_n_s16(sum, vget_high_s16(v), c[k + 1]);
+        }
+
+        /* the fourth lane of a 3 byte pixel is overwritten by the next one */
+        vst1_s16(dst + x * bpp, vmovn_s32(vshrq_n_s32(sum, SCALE_SHIFT_H)));
+    }
+
+    scalehRow<bpp>(src, dst, pos, coeffs, taps, widthV, width);
+}
+
+void scalev_neon(const int16_t* const* rows, uint8_t* dst, const int16_t* coeffs, int taps, int count)
+{
+    const int countV = count & ~7;
+
+    for (int i = 0; i < countV; i += 8)
+    {
+        int32x4_t lo = vdupq_n_s32(1 << (SCALE_SHIFT_V - 1));
+        int32x4_t hi = lo;
+
+        for (int k = 0; k < taps; k++)
+        {
+            int16x8_t v = vld1q_s16(rows[k] + i);
+            lo = vmlal_n_s16(lo, vget_low_s16(v), coeffs[k]);
+            hi = vmlal_n_s16(hi, vget_high_s16(v), coeffs[k]);
+        }
+
+        int16x8_t out = vcombine_s16(vmovn_s32(vshrq_n_s32(lo, SCALE_SHIFT_V)), vmovn_s32(vshrq_n_s32(hi, SCALE_SHIFT_V)));
+        vst1_u8(dst + i, vqmovun_s16(out));
+    }
+
+    scalevRow(rows, dst, coeffs, taps, countV, count);
+}
+}
+
+namespace X265_NS {
+void setupColorConvertPrimitives_neon(EncoderPrimitives &p)
+{
+#define RGB2YUV_NEON(PACKING) \
+    p.rgb2yuv[PACKING][X265_CSP_I420] = rgb2yuv_i420_neon<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I444] = rgb2yuv_i444_neon<PACKING>; \
+    p.rgb2gbr[PACKING] = rgb2gbr_neon<PACKING>;
+
+    RGB2YUV_NEON(RGB_PACKING_RGB);
+    RGB2YUV_NEON(RGB_PACKING_BGR);
+    RGB2YUV_NEON(RGB_PACKING_RGBA);
+    RGB2YUV_NEON(RGB_PACKING_BGRA);
+    RGB2YUV_NEON(RGB_PACKING_RGB565);
+
+#undef RGB2YUV_NEON
+
+    p.yuyv2yuv[X265_CSP_I420] = yuyv2yuv_i420_neon;
+    p.yuyv2yuv[X265_CSP_I422] = yuyv2yuv_i422_neon;
+    p.uvsplit = uvsplit_neon;
+
+    p.scaleh[0] = scaleh_neon<3>;
+    p.scaleh[1] = scaleh_neon<4>;
+    p.scalev = scalev_neon;
+}
+}
+#endif // if HAVE_NEON
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "fec.h"
+
+#if HAVE_NEON
+#include <arm_neon.h>
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* 16 entry byte lookup, a single tbl on AArch64 and two 8 byte halves of a
+ * vtbl2 on ARMv7 */
+#if defined(__aarch64__)
+typedef uint8x16_t lut_t;
+inline lut_t loadLut(const uint8_t* t) { return vld1q_u8(t); }
+inline uint8x16_t lookup(lut_t t, uint8x16_t idx) { return vqtbl1q_u8(t, idx); }
+#else
+typedef uint8x8x2_t lut_t;
+inline lut_t loadLut(const uint8_t* t)
+{
+    lut_t l;
+    l.val[0] = vld1_u8(t);
+    l.val[1] = vld1_u8(t + 8);
+    return l;
+}
+inline uint8x16_t lookup(lut_t t, uint8x16_t idx)
+{
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+}
+#endif
+
+void gfmuladd_neon(uint8_t* dst, const uint8_t* src, uint8_t c, intptr_t size)
+{
+    if (c <= 1)
+    {
+        gfMulAddRow(dst, src, c, 0, size);
+        return;
+    }
+
+    uint8_t lo[16], hi[16];
+    gf256NibbleTables(c, lo, hi);
+    const lut_t tlo = loadLut(lo);
+    const lut_t thi = loadLut(hi);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+
+    intptr_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t p = veorq_u8(lookup(tlo, vandq_u8(s, mask)), lookup(thi, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+    }
+    gfMulAddRow(dst, src, c, i, size);
+}
+}
+
+namespace X265_NS {
+void setupFecPrimitives_neon(EncoderPrimitives &p)
+{
+    p.gfmuladd = gfmuladd_neon;
+}
+}
+#endif // if HAVE_NEON
@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+
+using namespace X265_NS;
+
+namespace X265_NS {
+// x265 private namespace
+
+/* Kr/Kb matrices scaled to Q14. Luma weights sum to the range scale and chroma
+ * weights sum to zero, so greys convert without chroma error. Limited range
+ * scales luma by 219/255 and chroma by 224/255 */
+const RGBToYUVCoeffs g_rgbToYuvCoeffs[NUM_RGB_MATRICES] =
+{
+    /* BT.601, limited range */
+    { { 4207, 8260, 1604 }, { -2428, -4768, 7196 }, { 7196, -6026, -1170 }, 16 },
+    /* BT.601, full range */
+    { { 4899, 9617, 1868 }, { -2765, -5427, 8192 }, { 8192, -6860, -1332 }, 0 },
+    /* BT.709, limited range */
+    { { 2991, 10064, 1016 }, { -1649, -5547, 7196 }, { 7196, -6536, -660 }, 16 },
+    /* BT.709, full range */
+    { { 3483, 11718, 1183 }, { -1877, -6315, 8192 }, { 8192, -7441, -751 }, 0 },
+};
+}
+
+namespace {
+// file local namespace
+
+template<int packing>
+void rgb2yuv_i400_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                    uint8_t*, uint8_t*, intptr_t, int width, int height,
+                    const RGBToYUVCoeffs* coeffs)
+{
+    for (int y = 0; y < height; y++)
+    {
+        rgb2yuvRow400<packing>(src, dstY, 0, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i422_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                    uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                    const RGBToYUVCoeffs* coeffs)
+{
+    X265_CHECK(!(width & 1), "rgb2yuv_i422 requires an even width\n");
+
+    for (int y = 0; y < height; y++)
+    {
+        rgb2yuvRow422<packing>(src, dstY, dstU, dstV, 0, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i444_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                    uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                    const RGBToYUVCoeffs* coeffs)
+{
+    for (int y = 0; y < height; y++)
+    {
+        rgb2yuvRow444<packing>(src, dstY, dstU, dstV, 0, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2gbr_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR,
+               intptr_t dstStride, int width, int height)
+{
+    for (int y = 0; y < height; y++)
+    {
+        rgb2gbrRow<packing>(src, dstG, dstB, dstR, 0, width);
+
+        src += srcStride;
+        dstG += dstStride;
+        dstB += dstStride;
+        dstR += dstStride;
+    }
+}
+
+void yuyv2yuv_i422_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                     uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    X265_CHECK(!(width & 1), "yuyv2yuv_i422 requires an even width\n");
+
+    for (int y = 0; y < height; y++)
+    {
+        yuyv2yuvRow422(src, dstY, dstU, dstV, 0, width);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void yuyv2yuv_i420_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                     uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    X265_CHECK(!((width | height) & 1), "yuyv2yuv_i420 requires even dimensions\n");
+
+    for (int y = 0; y < height; y += 2)
+    {
+        yuyv2yuvRow420(src, src + srcStride, dstY, dstY + dstStrideY, dstU, dstV, 0, width);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void uvsplit_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstU, uint8_t* dstV, intptr_t dstStride, int width, int height)
+{
+    for (int y = 0; y < height; y++)
+    {
+        uvsplitRow(src, dstU, dstV, 0, width);
+
+        src += srcStride;
+        dstU += dstStride;
+        dstV += dstStride;
+    }
+}
+
+template<int bpp>
+void scaleh_c(const uint8_t* src, int16_t* dst, const int32_t* pos, const int16_t* coeffs, int taps, int width, int)
+{
+    scalehRow<bpp>(src, dst, pos, coeffs, taps, 0, width);
+}
+
+void scalev_c(const int16_t* const* rows, uint8_t* dst, const int16_t* coeffs, int taps, int count)
+{
+    scalevRow(rows, dst, coeffs, taps, 0, count);
+}
+
+template<int packing>
+void rgb2yuv_i420_c(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                    uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                    const RGBToYUVCoeffs* coeffs)
+{
+    X265_CHECK(!((width | height) & 1), "rgb2yuv_i420 requires even dimensions\n");
+
+    for (int y = 0; y < height; y += 2)
+    {
+        rgb2yuvRow420<packing>(src, src + srcStride, dstY, dstY + dstStrideY, dstU, dstV, 0, width, *coeffs);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+}
+
+namespace X265_NS {
+// x265 private namespace
+
+void setupColorConvertPrimitives_c(EncoderPrimitives& p)
+{
+#define RGB2YUV_C(PACKING) \
+    p.rgb2yuv[PACKING][X265_CSP_I400] = rgb2yuv_i400_c<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I420] = rgb2yuv_i420_c<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I422] = rgb2yuv_i422_c<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I444] = rgb2yuv_i444_c<PACKING>; \
+    p.rgb2gbr[PACKING] = rgb2gbr_c<PACKING>;
+
+    RGB2YUV_C(RGB_PACKING_RGB);
+    RGB2YUV_C(RGB_PACKING_BGR);
+    RGB2YUV_C(RGB_PACKING_RGBA);
+    RGB2YUV_C(RGB_PACKING_BGRA);
+    RGB2YUV_C(RGB_PACKING_RGB565);
+
+#undef RGB2YUV_C
+
+    p.yuyv2yuv[X265_CSP_I420] = yuyv2yuv_i420_c;
+    p.yuyv2yuv[X265_CSP_I422] = yuyv2yuv_i422_c;
+    p.uvsplit = uvsplit_c;
+
+    p.scaleh[0] = scaleh_c<3>;
+    p.scaleh[1] = scaleh_c<4>;
+    p.scalev = scalev_c;
+}
+}
@@ -0,0 +1,268 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_COLORCONVERT_H
+#define X265_COLORCONVERT_H
+
+#include "common.h"
+#include "primitives.h"
+
+/* Scalar raw input conversion row kernels (RGB to YUV or GBR, packed YUV to
+ * planar, RGB scaling) shared by the C primitives and by the vector primitives, which use
+ * them for the columns left over after their last full vector. All
+ * implementations must match these bit for bit */
+
+namespace X265_NS {
+// private x265 namespace
+
+#define RGB2YUV_SHIFT 14
+
+/* Scaler coefficients are Q14, the horizontal pass keeps 6 fraction bits
+ * of precision for the vertical pass */
+#define SCALE_COEFF_SHIFT 14
+#define SCALE_SHIFT_H     (SCALE_COEFF_SHIFT - 6)
+#define SCALE_SHIFT_V     (SCALE_COEFF_SHIFT + 6)
+
+/* Byte offsets of the colour components within one packed pixel */
+template<int packing>
+struct RGBLayout
+{
+    enum
+    {
+        bpp = packing == RGB_PACKING_RGB565 ? 2 : (packing == RGB_PACKING_RGBA || packing == RGB_PACKING_BGRA) ? 4 : 3,
+        r   = (packing == RGB_PACKING_BGR || packing == RGB_PACKING_BGRA) ? 2 : 0,
+        g   = 1,
+        b   = 2 - r
+    };
+};
+
+/* Rounding constants added before the final shift. 4:2:0 chroma is computed
+ * from the sum of a 2x2 block, so it is shifted two more bits, and 4:2:2
+ * chroma from the sum of a horizontal pair, shifted one more bit */
+inline int rgb2yuvLumaAdd(const RGBToYUVCoeffs& c) { return (c.yOffset << RGB2YUV_SHIFT) + (1 << (RGB2YUV_SHIFT - 1)); }
+inline int rgb2yuvChromaAdd()                      { return (128 << RGB2YUV_SHIFT) + (1 << (RGB2YUV_SHIFT - 1)); }
+inline int rgb2yuvChroma420Add()                   { return (128 << (RGB2YUV_SHIFT + 2)) + (1 << (RGB2YUV_SHIFT + 1)); }
+inline int rgb2yuvChroma422Add()                   { return (128 << (RGB2YUV_SHIFT + 1)) + (1 << RGB2YUV_SHIFT); }
+
+inline uint8_t rgb2yuvClip(int v) { return (uint8_t)x265_clip3(0, 255, v); }
+
+/* Fetch pixel x of a row as 8bit R, G and B */
+template<int packing>
+inline void rgbLoad(const uint8_t* src, int x, int& r, int& g, int& b)
+{
+    typedef RGBLayout<packing> L;
+    const uint8_t* px = src + x * L::bpp;
+    r = px[L::r];
+    g = px[L::g];
+    b = px[L::b];
+}
+
+/* 5 and 6 bit components are widened by replicating their top bits, so
+ * full scale stays full scale */
+template<>
+inline void rgbLoad<RGB_PACKING_RGB565>(const uint8_t* src, int x, int& r, int& g, int& b)
+{
+    int px = src[2 * x] | (src[2 * x + 1] << 8);
+    r = ((px >> 8) & 0xF8) | (px >> 13);
+    g = ((px >> 3) & 0xFC) | ((px >> 9) & 3);
+    b = ((px << 3) & 0xF8) | ((px >> 2) & 7);
+}
+
+/* Convert columns [x0, x1) of one row to luma only */
+template<int packing>
+inline void rgb2yuvRow400(const uint8_t* src, uint8_t* dstY, int x0, int x1, const RGBToYUVCoeffs& c)
+{
+    const int addY = rgb2yuvLumaAdd(c);
+
+    for (int x = x0; x < x1; x++)
+    {
+        int r, g, b;
+        rgbLoad<packing>(src, x, r, g, b);
+        dstY[x] = rgb2yuvClip((c.y[0] * r + c.y[1] * g + c.y[2] * b + addY) >> RGB2YUV_SHIFT);
+    }
+}
+
+/* Convert columns [x0, x1) of one row to 4:4:4 */
+template<int packing>
+inline void rgb2yuvRow444(const uint8_t* src, uint8_t* dstY, uint8_t* dstU, uint8_t* dstV,
+                          int x0, int x1, const RGBToYUVCoeffs& c)
+{
+    const int addY = rgb2yuvLumaAdd(c);
+    const int addC = rgb2yuvChromaAdd();
+
+    for (int x = x0; x < x1; x++)
+    {
+        int r, g, b;
+        rgbLoad<packing>(src, x, r, g, b);
+
+        dstY[x] = rgb2yuvClip((c.y[0] * r + c.y[1] * g + c.y[2] * b + addY) >> RGB2YUV_SHIFT);
+        dstU[x] = rgb2yuvClip((c.u[0] * r + c.u[1] * g + c.u[2] * b + addC) >> RGB2YUV_SHIFT);
+        dstV[x] = rgb2yuvClip((c.v[0] * r + c.v[1] * g + c.v[2] * b + addC) >> RGB2YUV_SHIFT);
+    }
+}
+
+/* Convert columns [x0, x1) of one row to 4:2:2, x0 and x1 must be even */
+template<int packing>
+inline void rgb2yuvRow422(const uint8_t* src, uint8_t* dstY, uint8_t* dstU, uint8_t* dstV,
+                          int x0, int x1, const RGBToYUVCoeffs& c)
+{
+    const int addY = rgb2yuvLumaAdd(c);
+    const int addC = rgb2yuvChroma422Add();
+
+    for (int x = x0; x < x1; x += 2)
+    {
+        int sr = 0, sg = 0, sb = 0;
+        for (int j = 0; j < 2; j++)
+        {
+            int r, g, b;
+            rgbLoad<packing>(src, x + j, r, g, b);
+
+            dstY[x + j] = rgb2yuvClip((c.y[0] * r + c.y[1] * g + c.y[2] * b + addY) >> RGB2YUV_SHIFT);
+            sr += r;
+            sg += g;
+            sb += b;
+        }
+
+        dstU[x >> 1] = rgb2yuvClip((c.u[0] * sr + c.u[1] * sg + c.u[2] * sb + addC) >> (RGB2YUV_SHIFT + 1));
+        dstV[x >> 1] = rgb2yuvClip((c.v[0] * sr + c.v[1] * sg + c.v[2] * sb + addC) >> (RGB2YUV_SHIFT + 1));
+    }
+}
+
+/* Convert columns [x0, x1) of a pair of rows to 4:2:0, x0 and x1 must be even */
+template<int packing>
+inline void rgb2yuvRow420(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1,
+                          uint8_t* dstU, uint8_t* dstV, int x0, int x1, const RGBToYUVCoeffs& c)
+{
+    const int addY = rgb2yuvLumaAdd(c);
+    const int addC = rgb2yuvChroma420Add();
+
+    for (int x = x0; x < x1; x += 2)
+    {
+        int sr = 0, sg = 0, sb = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            const uint8_t* row = i ? src1 : src0;
+            uint8_t* dstY = i ? dstY1 : dstY0;
+            for (int j = 0; j < 2; j++)
+            {
+                int r, g, b;
+                rgbLoad<packing>(row, x + j, r, g, b);
+
+                dstY[x + j] = rgb2yuvClip((c.y[0] * r + c.y[1] * g + c.y[2] * b + addY) >> RGB2YUV_SHIFT);
+                sr += r;
+                sg += g;
+                sb += b;
+            }
+        }
+
+        dstU[x >> 1] = rgb2yuvClip((c.u[0] * sr + c.u[1] * sg + c.u[2] * sb + addC) >> (RGB2YUV_SHIFT + 2));
+        dstV[x >> 1] = rgb2yuvClip((c.v[0] * sr + c.v[1] * sg + c.v[2] * sb + addC) >> (RGB2YUV_SHIFT + 2));
+    }
+}
+
+/* Split columns [x0, x1) of one row into G, B and R planes */
+template<int packing>
+inline void rgb2gbrRow(const uint8_t* src, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        int r, g, b;
+        rgbLoad<packing>(src, x, r, g, b);
+        dstG[x] = (uint8_t)g;
+        dstB[x] = (uint8_t)b;
+        dstR[x] = (uint8_t)r;
+    }
+}
+
+/* De-interleave columns [x0, x1) of one YUYV row to 4:2:2, x0 and x1 must be even */
+inline void yuyv2yuvRow422(const uint8_t* src, uint8_t* dstY, uint8_t* dstU, uint8_t* dstV, int x0, int x1)
+{
+    for (int x = x0; x < x1; x += 2)
+    {
+        const uint8_t* px = src + 2 * x;
+        dstY[x] = px[0];
+        dstY[x + 1] = px[2];
+        dstU[x >> 1] = px[1];
+        dstV[x >> 1] = px[3];
+    }
+}
+
+/* De-interleave columns [x0, x1) of a pair of YUYV rows to 4:2:0, x0 and x1
+ * must be even */
+inline void yuyv2yuvRow420(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1,
+                           uint8_t* dstU, uint8_t* dstV, int x0, int x1)
+{
+    for (int x = x0; x < x1; x += 2)
+    {
+        const uint8_t* px0 = src0 + 2 * x;
+        const uint8_t* px1 = src1 + 2 * x;
+        dstY0[x] = px0[0];
+        dstY0[x + 1] = px0[2];
+        dstY1[x] = px1[0];
+        dstY1[x + 1] = px1[2];
+        dstU[x >> 1] = (uint8_t)((px0[1] + px1[1] + 1) >> 1);
+        dstV[x >> 1] = (uint8_t)((px0[3] + px1[3] + 1) >> 1);
+    }
+}
+
+/* Horizontally filter output pixels [x0, x1) of one packed row, every
+ * channel of a pixel independently */
+template<int bpp>
+inline void scalehRow(const uint8_t* src, int16_t* dst, const int32_t* pos, const int16_t* coeffs, int taps, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        const uint8_t* px = src + pos[x] * bpp;
+        const int16_t* c = coeffs + x * taps;
+        for (int ch = 0; ch < bpp; ch++)
+        {
+            int sum = 0;
+            for (int k = 0; k < taps; k++)
+                sum += px[k * bpp + ch] * c[k];
+            dst[x * bpp + ch] = (int16_t)((sum + (1 << (SCALE_SHIFT_H - 1))) >> SCALE_SHIFT_H);
+        }
+    }
+}
+
+/* Vertically filter samples [i0, i1) of taps horizontally filtered rows */
+inline void scalevRow(const int16_t* const* rows, uint8_t* dst, const int16_t* coeffs, int taps, int i0, int i1)
+{
+    for (int i = i0; i < i1; i++)
+    {
+        int sum = 0;
+        for (int k = 0; k < taps; k++)
+            sum += rows[k][i] * coeffs[k];
+        dst[i] = rgb2yuvClip((sum + (1 << (SCALE_SHIFT_V - 1))) >> SCALE_SHIFT_V);
+    }
+}
+
+/* Split chroma samples [x0, x1) of one interleaved UV row */
+inline void uvsplitRow(const uint8_t* src, uint8_t* dstU, uint8_t* dstV, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        dstU[x] = src[2 * x];
+        dstV[x] = src[2 * x + 1];
+    }
+}
+}
+
+#endif // ifndef X265_COLORCONVERT_H
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_FEC_H
+#define X265_FEC_H
+
+#include "common.h"
+#include "primitives.h"
+
+/* Erasure coding over GF(2^8), modulo x^8 + x^4 + x^3 + x^2 + 1, for packet
+ * level forward error correction. A block of k equally sized data symbols
+ * is protected by m parity symbols, parity j being the sum over i of
+ * fecCoeff(j, i) * data i. Any k of the k + m symbols recover the block and
+ * parity 0 alone is the XOR of the data */
+
+namespace X265_NS {
+// private x265 namespace
+
+#define FEC_MAX_DATA   128
+#define FEC_MAX_PARITY 128
+
+extern const uint8_t g_gf256Exp[512];
+extern const uint8_t g_gf256Log[256];
+
+inline uint8_t gf256Mul(uint8_t a, uint8_t b) { return a && b ? g_gf256Exp[g_gf256Log[a] + g_gf256Log[b]] : 0; }
+inline uint8_t gf256Inv(uint8_t a)            { return g_gf256Exp[255 - g_gf256Log[a]]; }
+
+/* c times every low nibble and every high nibble, multiplication is linear
+ * so c * x is lo[x & 15] ^ hi[x >> 4]. These are the pshufb and tbl lookups
+ * of the vector gfmuladd */
+inline void gf256NibbleTables(uint8_t c, uint8_t* lo, uint8_t* hi)
+{
+    for (int x = 0; x < 16; x++)
+    {
+        lo[x] = gf256Mul(c, (uint8_t)x);
+        hi[x] = gf256Mul(c, (uint8_t)(x << 4));
+    }
+}
+
+/* dst ^= c * src for bytes [start, size), the C primitive and the tail of
+ * the vector ones */
+inline void gfMulAddRow(uint8_t* dst, const uint8_t* src, uint8_t c, intptr_t start, intptr_t size)
+{
+    if (c == 1)
+    {
+        for (intptr_t i = start; i < size; i++)
+            dst[i] ^= src[i];
+    }
+    else if (c)
+    {
+        int logc = g_gf256Log[c];
+        for (intptr_t i = start; i < size; i++)
+            if (src[i])
+                dst[i] ^= g_gf256Exp[logc + g_gf256Log[src[i]]];
+    }
+}
+
+uint8_t fecCoeff(int parity, int index);
+
+/* parity symbol number parity of the k data symbols */
+void fecEncode(const uint8_t* const* data, int k, int parity, uint8_t* out, intptr_t size);
+
+/* fills in the data symbols that are not present from numParity received
+ * parity symbols, parityIndex giving the number of each. Fails when fewer
+ * parities than missing data symbols arrived */
+bool fecRecover(uint8_t* const* data, const bool* present, int k, const uint8_t* const* parity, const int* parityIndex, int numParity, intptr_t size);
+}
+
+#endif // ifndef X265_FEC_H
@@ -32,6 +32,7 @@ using namespace X265_NS;
 Frame::Frame()
 {
     m_bChromaExtended = false;
+    m_bInvalidated = false;
     m_lowresInit = false;
     m_reconRowFlag = NULL;
     m_reconColCount = NULL;
@@ -39,6 +40,10 @@ Frame::Frame()
     m_encData = NULL;
     m_reconPic = NULL;
     m_quantOffsets = NULL;
+    m_ctuChangeMap = NULL;
+    memset(&m_sourcePic, 0, sizeof(m_sourcePic));
+    m_sourceRows = 0;
+    m_sourcePadX = m_sourcePadY = 0;
     m_next = NULL;
     m_prev = NULL;
     m_param = NULL;
@@ -174,6 +179,29 @@ void Frame::reinit(const SPS& sps)
     m_encData->reinit(sps);
 }
 
+/* Blocks on the application until the first rows luma rows of a progressive
+ * input picture are written and copies them into m_fencPic. Called by the
+ * FrameEncoder thread before it enables the CTU rows covering them */
+void Frame::readSourceRows(int rows)
+{
+    if (!m_sourcePic.rowsReady)
+        return;
+
+    int height = m_fencPic->m_picHeight - m_sourcePadY;
+    rows = X265_MIN(rows, height);
+    if (rows <= m_sourceRows)
+        return;
+
+    int ready = m_sourcePic.rowsReady(m_sourcePic.rowsOpaque, rows);
+    ready = X265_MIN(X265_MAX(ready, rows), height);
+    if (ready < height)
+        ready &= ~((1 << m_fencPic->m_vChromaShift) - 1);
+    m_fencPic->copyRowsFromPicture(m_sourcePic, *m_param, m_sourcePadX, m_sourcePadY, m_sourceRows, ready);
+    m_sourceRows = ready;
+    if (ready == height)
+        m_sourcePic.rowsReady = NULL;
+}
+
 void Frame::destroy()
 {
     if (m_encData)
@@ -215,6 +243,9 @@ void Frame::destroy()
         delete[] m_quantOffsets;
     }
 
+    X265_FREE(m_ctuChangeMap);
+    m_ctuChangeMap = NULL;
+
     if (m_userSEI.numPayloads)
     {
         for (int i = 0; i < m_userSEI.numPayloads; i++)
@@ -94,9 +94,19 @@ public:
     Lowres                 m_lowres;
     bool                   m_lowresInit;         // lowres init complete (pre-analysis)
     bool                   m_bChromaExtended;    // orig chroma planes motion extended for weight analysis
+    bool                   m_bInvalidated;       // lost at the receiver, or predicted from a lost picture
     bool                   m_reconfigureRc;
 
     float*                 m_quantOffsets;       // points to quantOffsets in x265_picture
+    uint8_t*               m_ctuChangeMap;       // per CTU, zero if x265_picture.changeMap marked all its blocks unchanged
+
+    /* Progressive input, see x265_picture.rowsReady. m_fencPic holds the first
+     * m_sourceRows luma rows of m_sourcePic, FrameEncoder reads the rest as it
+     * reaches them. rowsReady is cleared once the picture is complete */
+    x265_picture           m_sourcePic;
+    int                    m_sourceRows;
+    int                    m_sourcePadX;         // conformance window padding passed to copyFromPicture
+    int                    m_sourcePadY;
     x265_sei               m_userSEI;
     uint32_t               m_picStruct;          // picture structure SEI message
     x265_dolby_vision_rpu            m_rpu;
@@ -143,6 +153,7 @@ public:
     bool allocEncodeData(x265_param *param, const SPS& sps);
     void reinit(const SPS& sps);
     void destroy();
+    void readSourceRows(int rows);
 };
 }
 
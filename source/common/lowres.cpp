@@ -255,8 +255,9 @@ void Lowres::destroy()
         delete[] pAQLayer;
     }
 }
-// (re) initialize lowres state
-void Lowres::init(PicYuv *origPic, int poc)
+// (re) initialize lowres state, bDownscale false leaves the planes stale for
+// frames whose pixels are not available to the lookahead
+void Lowres::init(PicYuv *origPic, int poc, bool bDownscale)
 {
     bLastMiniGopBFrame = false;
     bKeyframe = false; // Not a keyframe unless identified by lookahead
@@ -286,6 +287,9 @@ void Lowres::init(PicYuv *origPic, int poc)
         for (int i = 0; i < X265_LOOKAHEAD_MAX + 1; i++)
             plannedType[i] = X265_TYPE_AUTO;
 
+    if (!bDownscale)
+        return;
+
     /* downscale and generate 4 hpel planes for lookahead */
     primitives.frameInitLowres(origPic->m_picOrg[0],
                                lowresPlane[0], lowresPlane[1], lowresPlane[2], lowresPlane[3],
@@ -236,7 +236,7 @@ struct Lowres : public ReferencePlanes
     ReferencePlanes weightedRef[X265_BFRAME_MAX + 2];
     bool create(x265_param* param, PicYuv *origPic, uint32_t qgSize);
     void destroy();
-    void init(PicYuv *origPic, int poc);
+    void init(PicYuv *origPic, int poc, bool bDownscale = true);
 };
 }
 
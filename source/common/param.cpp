@@ -1632,6 +1632,8 @@ int x265_check_params(x265_param* param)
           || param->vui.matrixCoeffs == 3,
           "Matrix Coefficients must be undef, bt709, fcc, bt470bg, smpte170m,"
           " smpte240m, GBR, YCgCo, bt2020nc, bt2020c, smpte-st-2085, chroma-nc, chroma-c or ictcp");
+    CHECK(param->vui.matrixCoeffs == 0 && param->internalCsp != X265_CSP_I444,
+          "GBR Matrix Coefficients require 4:4:4 color space");
     CHECK(param->vui.chromaSampleLocTypeTopField < 0
           || param->vui.chromaSampleLocTypeTopField > 5,
           "Chroma Sample Location Type Top Field must be 0-5");
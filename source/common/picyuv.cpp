@@ -462,6 +462,85 @@ void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, i
     }
 }
 
+/* Copies luma rows [rowBegin, rowEnd) of a picture that is still being
+ * written, and the chroma rows beneath them, extending the right edge as
+ * copyFromPicture does and the bottom once the last row arrives. Both bounds
+ * are multiples of the chroma row height unless rowEnd is the picture height.
+ * Luma clipping and picture statistics are not applied, the encoder only
+ * reads input progressively when neither is configured */
+void PicYuv::copyRowsFromPicture(const x265_picture& pic, const x265_param& param, int padx, int pady, int rowBegin, int rowEnd)
+{
+    int width = m_picWidth - padx;
+    int height = m_picHeight - pady;
+
+    /* same internal padding as copyFromPicture */
+    uint8_t rem = width & 15;
+    padx = rem ? 16 - rem : padx;
+    rem = height & 15;
+    pady = rem ? 16 - rem : pady;
+    padx++;
+    pady++;
+    m_picCsp = pic.colorSpace;
+
+    X265_CHECK(pic.bitDepth >= 8, "pic.bitDepth check failure");
+    X265_CHECK(m_param->bCopyPicToFrame, "progressive input needs a copy of the picture\n");
+
+    int planes = param.internalCsp != X265_CSP_I400 ? 3 : 1;
+    for (int i = 0; i < planes; i++)
+    {
+        uint32_t hShift = i ? m_hChromaShift : 0;
+        uint32_t vShift = i ? m_vChromaShift : 0;
+        intptr_t stride = i ? m_strideC : m_stride;
+        int planeWidth = width >> hShift;
+        int planeHeight = height >> vShift;
+        int begin = rowBegin >> vShift;
+        int end = rowEnd == height ? planeHeight : rowEnd >> vShift;
+        if (end <= begin)
+            continue;
+
+        pixel* dst = m_picOrg[i] + begin * stride;
+        if (pic.bitDepth == 8)
+        {
+            const uint8_t* src = (uint8_t*)pic.planes[i] + begin * pic.stride[i];
+#if (X265_DEPTH > 8)
+            primitives.planecopy_cp(src, pic.stride[i], dst, stride, planeWidth, end - begin, X265_DEPTH - 8);
+#else
+            for (int r = begin; r < end; r++)
+            {
+                memcpy(dst + (r - begin) * stride, src, planeWidth * sizeof(pixel));
+                src += pic.stride[i];
+            }
+#endif
+        }
+        else
+        {
+            uint16_t mask = (1 << X265_DEPTH) - 1;
+            int shift = abs(pic.bitDepth - X265_DEPTH);
+            const uint16_t* src = (uint16_t*)((char*)pic.planes[i] + begin * pic.stride[i]);
+            if (pic.bitDepth > X265_DEPTH)
+                primitives.planecopy_sp(src, pic.stride[i] / sizeof(*src), dst, stride, planeWidth, end - begin, shift, mask);
+            else
+                primitives.planecopy_sp_shl(src, pic.stride[i] / sizeof(*src), dst, stride, planeWidth, end - begin, shift, mask);
+        }
+
+        /* extend the right edge if width was not multiple of the minimum CU size */
+        for (int r = begin; r < end; r++)
+        {
+            pixel* row = m_picOrg[i] + r * stride;
+            for (int x = 0; x < padx >> hShift; x++)
+                row[planeWidth + x] = row[planeWidth - 1];
+        }
+
+        /* extend the bottom if height was not multiple of the minimum CU size */
+        if (end == planeHeight)
+        {
+            pixel* last = m_picOrg[i] + (planeHeight - 1) * stride;
+            for (int j = 1; j <= pady >> vShift; j++)
+                memcpy(last + j * stride, last, ((width + padx) >> hShift) * sizeof(pixel));
+        }
+    }
+}
+
 namespace X265_NS {
 
 template<uint32_t OUTPUT_BITDEPTH_DIV8>
@@ -59,6 +59,8 @@ void setupLoopFilterPrimitives_c(EncoderPrimitives &p);
 void setupSaoPrimitives_c(EncoderPrimitives &p);
 void setupSeaIntegralPrimitives_c(EncoderPrimitives &p);
 void setupLowPassPrimitives_c(EncoderPrimitives& p);
+void setupColorConvertPrimitives_c(EncoderPrimitives& p);
+void setupFecPrimitives_c(EncoderPrimitives& p);
 
 void setupCPrimitives(EncoderPrimitives &p)
 {
@@ -70,6 +72,8 @@ void setupCPrimitives(EncoderPrimitives &p)
     setupLoopFilterPrimitives_c(p); // loopfilter.cpp
     setupSaoPrimitives_c(p);        // sao.cpp
     setupSeaIntegralPrimitives_c(p);  // framefilter.cpp
+    setupColorConvertPrimitives_c(p); // colorconvert.cpp
+    setupFecPrimitives_c(p);          // fec.cpp
 }
 
 void enableLowpassDCTPrimitives(EncoderPrimitives &p)
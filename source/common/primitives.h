@@ -117,6 +117,40 @@ enum ChromaCU422
     BLOCK_422_32x64
 };
 
+/* Byte order of packed 8bit RGB source pixels. Indexes the colour conversion
+ * primitives, 32bit layouts ignore their fourth (alpha) byte. RGB565 is a
+ * little endian 16bit word, R in the top bits, expanded to 8bit per component */
+enum RGBPacking
+{
+    RGB_PACKING_RGB,
+    RGB_PACKING_BGR,
+    RGB_PACKING_RGBA,
+    RGB_PACKING_BGRA,
+    RGB_PACKING_RGB565,
+    NUM_RGB_PACKINGS
+};
+
+/* RGB to Y'CbCr conversion matrices, see g_rgbToYuvCoeffs */
+enum RGBMatrix
+{
+    RGB_MATRIX_BT601_LIMITED,
+    RGB_MATRIX_BT601_FULL,
+    RGB_MATRIX_BT709_LIMITED,
+    RGB_MATRIX_BT709_FULL,
+    NUM_RGB_MATRICES
+};
+
+/* Q14 fixed point conversion weights, each triplet is in R, G, B order */
+struct RGBToYUVCoeffs
+{
+    int16_t y[3];
+    int16_t u[3];
+    int16_t v[3];
+    int16_t yOffset; // 16 for limited (video) range, 0 for full range
+};
+
+extern const RGBToYUVCoeffs g_rgbToYuvCoeffs[NUM_RGB_MATRICES];
+
 enum IntegralSize
 {
     INTEGRAL_4,
@@ -229,6 +263,13 @@ typedef void(*psyRdoQuant_t1)(int16_t *m_resiDctCoeff, int64_t *costUncoded, int
 typedef void(*psyRdoQuant_t2)(int16_t *m_resiDctCoeff, int16_t *m_fencDctCoeff, int64_t *costUncoded, int64_t *totalUncodedCost, int64_t *totalRdCost, int64_t *psyScale, uint32_t blkPos);
 typedef void(*ssimDistortion_t)(const pixel *fenc, uint32_t fStride, const pixel *recon,  intptr_t rstride, uint64_t *ssBlock, int shift, uint64_t *ac_k);
 typedef void(*normFactor_t)(const pixel *src, uint32_t blockSize, int shift, uint64_t *z_k);
+typedef void (*rgb2yuv_t)(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY, uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height, const RGBToYUVCoeffs* coeffs);
+typedef void (*rgb2gbr_t)(const uint8_t* src, intptr_t srcStride, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR, intptr_t dstStride, int width, int height);
+typedef void (*yuyv2yuv_t)(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY, uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height);
+typedef void (*uvsplit_t)(const uint8_t* src, intptr_t srcStride, uint8_t* dstU, uint8_t* dstV, intptr_t dstStride, int width, int height);
+typedef void (*scaleh_t)(const uint8_t* src, int16_t* dst, const int32_t* pos, const int16_t* coeffs, int taps, int width, int srcWidth);
+typedef void (*scalev_t)(const int16_t* const* rows, uint8_t* dst, const int16_t* coeffs, int taps, int count);
+typedef void (*gfmuladd_t)(uint8_t* dst, const uint8_t* src, uint8_t c, intptr_t size);
 /* Function pointers to optimized encoder primitives. Each pointer can reference
  * either an assembly routine, a SIMD intrinsic primitive, or a C function */
 struct EncoderPrimitives
@@ -377,6 +418,39 @@ struct EncoderPrimitives
     integralv_t            integral_initv[NUM_INTEGRAL_SIZE];
     integralh_t            integral_inith[NUM_INTEGRAL_SIZE];
 
+    /* Packed 8bit RGB to 8bit planar YUV conversion of raw input pictures,
+     * indexed by RGBPacking and output color space. Chroma subsampling is a
+     * box filter fused into the conversion, so 4:2:0 requires an even width
+     * and height and 4:2:2 an even width. I400 leaves dstU and dstV alone */
+    rgb2yuv_t             rgb2yuv[NUM_RGB_PACKINGS][X265_CSP_COUNT];
+
+    /* Packed 8bit RGB split into G, B and R planes without any arithmetic, the
+     * 4:4:4 plane order of matrix_coefficients 0 (GBR) */
+    rgb2gbr_t             rgb2gbr[NUM_RGB_PACKINGS];
+
+    /* Packed YUYV (4:2:2) to planar YUV, indexed by output color space. 4:2:2
+     * is a plain de-interleave, 4:2:0 averages the chroma of each row pair.
+     * width and, for 4:2:0, height must be even */
+    yuyv2yuv_t            yuyv2yuv[X265_CSP_COUNT];
+
+    /* De-interleave the UV plane of NV12 into U and V planes, width counts
+     * chroma samples */
+    uvsplit_t             uvsplit;
+
+    /* Separable polyphase scaling of packed 8bit RGB rows ahead of rgb2yuv.
+     * scaleh filters width output pixels of one row, pixel x reading taps
+     * source pixels from pos[x] weighted by coeffs[x * taps], into 16bit
+     * samples with SCALE_SHIFT_H fraction bits. It is indexed by bytes per
+     * pixel - 3, srcWidth bounds the reads and dst must have room for one
+     * sample more than it fills. scalev combines taps such rows into count
+     * 8bit samples. taps is always even, coefficients are Q14 */
+    scaleh_t              scaleh[2];
+    scalev_t              scalev;
+
+    /* dst ^= c * src over GF(2^8), the one operation of the packet erasure
+     * code in fec.h. Buffers need no alignment, dst may equal src */
+    gfmuladd_t            gfmuladd;
+
     /* There is one set of chroma primitives per color space. An encoder will
      * have just a single color space and thus it will only ever use one entry
      * in this array. However we always fill all entries in the array in case
@@ -0,0 +1,502 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+#include <immintrin.h> // AVX2
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* Same gather scheme as the SSE4 version, with 8 pixels in each 128bit lane */
+template<int packing>
+struct ComponentShuffle
+{
+    typedef RGBLayout<packing> L;
+    enum { HI_OFFSET = L::bpp == 3 ? 8 : 16 };
+
+    __m256i lo[3];
+    __m256i hi[3];
+
+    ComponentShuffle()
+    {
+        const int offset[3] = { L::r, L::g, L::b };
+        for (int c = 0; c < 3; c++)
+        {
+            ALIGN_VAR_16(int8_t, maskLo[16]);
+            ALIGN_VAR_16(int8_t, maskHi[16]);
+            for (int i = 0; i < 8; i++)
+            {
+                int pos = i * L::bpp + offset[c];
+                bool bLo = (i + 1) * L::bpp <= 16;
+                maskLo[2 * i] = bLo ? (int8_t)pos : -128;
+                maskHi[2 * i] = bLo ? -128 : (int8_t)(pos - HI_OFFSET);
+                maskLo[2 * i + 1] = maskHi[2 * i + 1] = -128;
+            }
+            lo[c] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)maskLo));
+            hi[c] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)maskHi));
+        }
+    }
+
+    /* unpack 16 pixels to 16bit R, G and B */
+    void load(const uint8_t* src, __m256i& r, __m256i& g, __m256i& b) const
+    {
+        const uint8_t* src1 = src + 8 * L::bpp;
+        __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src)),
+                                            _mm_loadu_si128((const __m128i*)src1), 1);
+        __m256i d = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + HI_OFFSET))),
+                                            _mm_loadu_si128((const __m128i*)(src1 + HI_OFFSET)), 1);
+
+        r = _mm256_or_si256(_mm256_shuffle_epi8(a, lo[0]), _mm256_shuffle_epi8(d, hi[0]));
+        g = _mm256_or_si256(_mm256_shuffle_epi8(a, lo[1]), _mm256_shuffle_epi8(d, hi[1]));
+        b = _mm256_or_si256(_mm256_shuffle_epi8(a, lo[2]), _mm256_shuffle_epi8(d, hi[2]));
+    }
+};
+
+template<>
+struct ComponentShuffle<RGB_PACKING_RGB565>
+{
+    ComponentShuffle() {}
+
+    /* unpack 16 pixels to 16bit R, G and B */
+    void load(const uint8_t* src, __m256i& r, __m256i& g, __m256i& b) const
+    {
+        const __m256i m5 = _mm256_set1_epi16(0xF8);
+        const __m256i m6 = _mm256_set1_epi16(0xFC);
+        __m256i px = _mm256_loadu_si256((const __m256i*)src);
+
+        r = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(px, 8), m5), _mm256_srli_epi16(px, 13));
+        g = _mm256_and_si256(_mm256_srli_epi16(px, 3), m6);
+        g = _mm256_or_si256(g, _mm256_srli_epi16(g, 6));
+        b = _mm256_and_si256(_mm256_slli_epi16(px, 3), m5);
+        b = _mm256_or_si256(b, _mm256_srli_epi16(b, 5));
+    }
+};
+
+/* Same masks as the SSE4 version, 16 pixels in each 128bit lane */
+template<int packing>
+struct PlaneShuffle
+{
+    typedef RGBLayout<packing> L;
+
+    __m256i mask[3][L::bpp];
+
+    PlaneShuffle()
+    {
+        const int offset[3] = { L::g, L::b, L::r };
+        ALIGN_VAR_16(int8_t, m[16]);
+
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < L::bpp; k++)
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    int pos = i * L::bpp + offset[c] - 16 * k;
+                    m[i] = pos >= 0 && pos < 16 ? (int8_t)pos : -128;
+                }
+                mask[c][k] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)m));
+            }
+        }
+    }
+
+    /* split 32 pixels into G, B and R bytes */
+    void split(const uint8_t* src, __m256i plane[3]) const
+    {
+        const uint8_t* src1 = src + 16 * L::bpp;
+        __m256i v[L::bpp];
+        for (int k = 0; k < L::bpp; k++)
+            v[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + 16 * k))),
+                                           _mm_loadu_si128((const __m128i*)(src1 + 16 * k)), 1);
+
+        for (int c = 0; c < 3; c++)
+        {
+            plane[c] = _mm256_shuffle_epi8(v[0], mask[c][0]);
+            for (int k = 1; k < L::bpp; k++)
+                plane[c] = _mm256_or_si256(plane[c], _mm256_shuffle_epi8(v[k], mask[c][k]));
+        }
+    }
+};
+
+struct Weights
+{
+    __m256i rg;
+    __m256i b;
+    __m256i add;
+
+    Weights(const int16_t w[3], int add32)
+    {
+        rg  = _mm256_set1_epi32((w[1] << 16) | (uint16_t)w[0]);
+        b   = _mm256_set1_epi32((uint16_t)w[2]);
+        add = _mm256_set1_epi32(add32);
+    }
+};
+
+/* weighted sum of 16 16bit R, G, B triplets, lane order is preserved */
+template<int shift>
+inline __m256i dot3(__m256i r, __m256i g, __m256i b, const Weights& w)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r, g), w.rg),
+                                  _mm256_madd_epi16(_mm256_unpacklo_epi16(b, zero), w.b));
+    __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r, g), w.rg),
+                                  _mm256_madd_epi16(_mm256_unpackhi_epi16(b, zero), w.b));
+    lo = _mm256_srai_epi32(_mm256_add_epi32(lo, w.add), shift);
+    hi = _mm256_srai_epi32(_mm256_add_epi32(hi, w.add), shift);
+
+    return _mm256_packs_epi32(lo, hi);
+}
+
+/* saturate two vectors of 16 16bit values to 32 bytes in pixel order */
+inline __m256i pack(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+/* sums horizontal pairs of two rows of 32 pixels, returns 16 16bit sums */
+inline __m256i sum2x2(__m256i row0a, __m256i row0b, __m256i row1a, __m256i row1b)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+
+    __m256i a = _mm256_madd_epi16(_mm256_add_epi16(row0a, row1a), one);
+    __m256i b = _mm256_madd_epi16(_mm256_add_epi16(row0b, row1b), one);
+
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+}
+
+template<int packing>
+void rgb2yuv_i444_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChromaAdd());
+    const Weights wv(coeffs->v, rgb2yuvChromaAdd());
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i r0, g0, b0, r1, g1, b1;
+            shuf.load(src + x * L::bpp, r0, g0, b0);
+            shuf.load(src + (x + 16) * L::bpp, r1, g1, b1);
+
+            __m256i luma = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wy), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wy));
+            __m256i cb = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wu), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wu));
+            __m256i cr = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wv), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wv));
+
+            _mm256_storeu_si256((__m256i*)(dstY + x), luma);
+            _mm256_storeu_si256((__m256i*)(dstU + x), cb);
+            _mm256_storeu_si256((__m256i*)(dstV + x), cr);
+        }
+
+        rgb2yuvRow444<packing>(src, dstY, dstU, dstV, widthV, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i420_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChroma420Add());
+    const Weights wv(coeffs->v, rgb2yuvChroma420Add());
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i r00, g00, b00, r01, g01, b01, r10, g10, b10, r11, g11, b11;
+            shuf.load(src + x * L::bpp, r00, g00, b00);
+            shuf.load(src + (x + 16) * L::bpp, r01, g01, b01);
+            shuf.load(src1 + x * L::bpp, r10, g10, b10);
+            shuf.load(src1 + (x + 16) * L::bpp, r11, g11, b11);
+
+            _mm256_storeu_si256((__m256i*)(dstY + x), pack(dot3<RGB2YUV_SHIFT>(r00, g00, b00, wy), dot3<RGB2YUV_SHIFT>(r01, g01, b01, wy)));
+            _mm256_storeu_si256((__m256i*)(dstY1 + x), pack(dot3<RGB2YUV_SHIFT>(r10, g10, b10, wy), dot3<RGB2YUV_SHIFT>(r11, g11, b11, wy)));
+
+            __m256i sr = sum2x2(r00, r01, r10, r11);
+            __m256i sg = sum2x2(g00, g01, g10, g11);
+            __m256i sb = sum2x2(b00, b01, b10, b11);
+            __m256i chroma = pack(dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wu), dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wv));
+
+            _mm_storeu_si128((__m128i*)(dstU + (x >> 1)), _mm256_castsi256_si128(chroma));
+            _mm_storeu_si128((__m128i*)(dstV + (x >> 1)), _mm256_extracti128_si256(chroma, 1));
+        }
+
+        rgb2yuvRow420<packing>(src, src1, dstY, dstY1, dstU, dstV, widthV, width, *coeffs);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2gbr_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR,
+                  intptr_t dstStride, int width, int height)
+{
+    typedef RGBLayout<packing> L;
+    static const PlaneShuffle<packing> shuf;
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i plane[3];
+            shuf.split(src + x * L::bpp, plane);
+
+            _mm256_storeu_si256((__m256i*)(dstG + x), plane[0]);
+            _mm256_storeu_si256((__m256i*)(dstB + x), plane[1]);
+            _mm256_storeu_si256((__m256i*)(dstR + x), plane[2]);
+        }
+
+        rgb2gbrRow<packing>(src, dstG, dstB, dstR, widthV, width);
+
+        src += srcStride;
+        dstG += dstStride;
+        dstB += dstStride;
+        dstR += dstStride;
+    }
+}
+
+/* YUYV: Y0-7, U0-3, V0-3 of the 8 pixels in each lane */
+inline __m256i yuyvShuffle(const uint8_t* src)
+{
+    const __m256i mask = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15,
+                                          0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15);
+    return _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)src), mask);
+}
+
+/* U0-15 in the low lane and V0-15 in the high lane of 32 pixels */
+inline __m256i yuyvChroma(__m256i a, __m256i b)
+{
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    return _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi32(a, b), order);
+}
+
+void yuyv2yuv_i422_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i a = yuyvShuffle(src + 2 * x);
+            __m256i b = yuyvShuffle(src + 2 * x + 32);
+            __m256i uv = yuyvChroma(a, b);
+
+            _mm256_storeu_si256((__m256i*)(dstY + x), _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8));
+            _mm_storeu_si128((__m128i*)(dstU + (x >> 1)), _mm256_castsi256_si128(uv));
+            _mm_storeu_si128((__m128i*)(dstV + (x >> 1)), _mm256_extracti128_si256(uv, 1));
+        }
+
+        yuyv2yuvRow422(src, dstY, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void yuyv2yuv_i420_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i a0 = yuyvShuffle(src + 2 * x);
+            __m256i b0 = yuyvShuffle(src + 2 * x + 32);
+            __m256i a1 = yuyvShuffle(src1 + 2 * x);
+            __m256i b1 = yuyvShuffle(src1 + 2 * x + 32);
+            __m256i uv = _mm256_avg_epu8(yuyvChroma(a0, b0), yuyvChroma(a1, b1));
+
+            _mm256_storeu_si256((__m256i*)(dstY + x), _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a0, b0), 0xD8));
+            _mm256_storeu_si256((__m256i*)(dstY1 + x), _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a1, b1), 0xD8));
+            _mm_storeu_si128((__m128i*)(dstU + (x >> 1)), _mm256_castsi256_si128(uv));
+            _mm_storeu_si128((__m128i*)(dstV + (x >> 1)), _mm256_extracti128_si256(uv, 1));
+        }
+
+        yuyv2yuvRow420(src, src1, dstY, dstY1, dstU, dstV, widthV, width);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void uvsplit_avx2(const uint8_t* src, intptr_t srcStride, uint8_t* dstU, uint8_t* dstV, intptr_t dstStride, int width, int height)
+{
+    const __m256i mask = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                                          0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    const int widthV = width & ~31;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 32)
+        {
+            __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 2 * x)), mask);
+            __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 2 * x + 32)), mask);
+
+            _mm256_storeu_si256((__m256i*)(dstU + x), _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8));
+            _mm256_storeu_si256((__m256i*)(dstV + x), _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8));
+        }
+
+        uvsplitRow(src, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstU += dstStride;
+        dstV += dstStride;
+    }
+}
+
+/* Two output pixels per vector, one in each 128bit lane. Each tap pair loads
+ * 8 bytes at the pixel's window and interleaves the channels of the two
+ * source pixels, so a single madd against the pair's coefficients sums both
+ * taps of every channel */
+template<int bpp>
+void scaleh_avx2(const uint8_t* src, int16_t* dst, const int32_t* pos, const int16_t* coeffs, int taps, int width, int srcWidth)
+{
+    const __m256i order = bpp == 4
+        ? _mm256_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1,
+                           0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1)
+        : _mm256_setr_epi8(0, -1, 3, -1, 1, -1, 4, -1, 2, -1, 5, -1, -1, -1, -1, -1,
+                           0, -1, 3, -1, 1, -1, 4, -1, 2, -1, 5, -1, -1, -1, -1, -1);
+    const __m256i round = _mm256_set1_epi32(1 << (SCALE_SHIFT_H - 1));
+
+    /* the 8 byte loads of a window must stay within the row */
+    int widthV = width;
+    while (widthV > 0 && (pos[widthV - 1] + taps - 2) * bpp + 8 > srcWidth * bpp)
+        widthV--;
+    widthV &= ~1;
+
+    for (int x = 0; x < widthV; x += 2)
+    {
+        const uint8_t* p0 = src + pos[x] * bpp;
+        const uint8_t* p1 = src + pos[x + 1] * bpp;
+        const int16_t* c0 = coeffs + x * taps;
+        const int16_t* c1 = c0 + taps;
+        __m256i sum = round;
+
+        for (int k = 0; k < taps; k += 2)
+        {
+            __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(p0 + k * bpp))),
+                                                 _mm_loadl_epi64((const __m128i*)(p1 + k * bpp)), 1);
+            __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(*(const int32_t*)(c0 + k))),
+                                                _mm_set1_epi32(*(const int32_t*)(c1 + k)), 1);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_shuffle_epi8(px, order), c));
+        }
+
+        __m256i out = _mm256_packs_epi32(_mm256_srai_epi32(sum, SCALE_SHIFT_H), _mm256_setzero_si256());
+        _mm_storel_epi64((__m128i*)(dst + x * bpp), _mm256_castsi256_si128(out));
+        _mm_storel_epi64((__m128i*)(dst + (x + 1) * bpp), _mm256_extracti128_si256(out, 1));
+    }
+
+    scalehRow<bpp>(src, dst, pos, coeffs, taps, widthV, width);
+}
+
+void scalev_avx2(const int16_t* const* rows, uint8_t* dst, const int16_t* coeffs, int taps, int count)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (SCALE_SHIFT_V - 1));
+    const int countV = count & ~15;
+
+    for (int i = 0; i < countV; i += 16)
+    {
+        __m256i lo = round;
+        __m256i hi = round;
+
+        for (int k = 0; k < taps; k += 2)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(rows[k] + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(rows[k + 1] + i));
+            __m256i c = _mm256_set1_epi32((uint16_t)coeffs[k] | ((uint32_t)(uint16_t)coeffs[k + 1] << 16));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+        }
+
+        __m256i out = _mm256_packs_epi32(_mm256_srai_epi32(lo, SCALE_SHIFT_V), _mm256_srai_epi32(hi, SCALE_SHIFT_V));
+        out = _mm256_permute4x64_epi64(_mm256_packus_epi16(out, out), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(out));
+    }
+
+    scalevRow(rows, dst, coeffs, taps, countV, count);
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicColorConvert_avx2(EncoderPrimitives &p)
+{
+#define RGB2YUV_AVX2(PACKING) \
+    p.rgb2yuv[PACKING][X265_CSP_I420] = rgb2yuv_i420_avx2<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I444] = rgb2yuv_i444_avx2<PACKING>;
+
+    RGB2YUV_AVX2(RGB_PACKING_RGB);
+    RGB2YUV_AVX2(RGB_PACKING_BGR);
+    RGB2YUV_AVX2(RGB_PACKING_RGBA);
+    RGB2YUV_AVX2(RGB_PACKING_BGRA);
+    RGB2YUV_AVX2(RGB_PACKING_RGB565);
+
+#undef RGB2YUV_AVX2
+
+    /* 3 byte packings only, as in the SSE4 setup */
+    p.rgb2gbr[RGB_PACKING_RGB] = rgb2gbr_avx2<RGB_PACKING_RGB>;
+    p.rgb2gbr[RGB_PACKING_BGR] = rgb2gbr_avx2<RGB_PACKING_BGR>;
+
+    p.yuyv2yuv[X265_CSP_I420] = yuyv2yuv_i420_avx2;
+    p.yuyv2yuv[X265_CSP_I422] = yuyv2yuv_i422_avx2;
+    p.uvsplit = uvsplit_avx2;
+
+    p.scaleh[0] = scaleh_avx2<3>;
+    p.scaleh[1] = scaleh_avx2<4>;
+    p.scalev = scalev_avx2;
+}
+}
@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+#include <immintrin.h> // AVX-512 F + BW
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* Same gather scheme as the SSE4 version, with 8 pixels in each 128bit lane */
+template<int packing>
+struct ComponentShuffle
+{
+    typedef RGBLayout<packing> L;
+    enum { HI_OFFSET = L::bpp == 3 ? 8 : 16 };
+
+    __m512i lo[3];
+    __m512i hi[3];
+
+    ComponentShuffle()
+    {
+        const int offset[3] = { L::r, L::g, L::b };
+        for (int c = 0; c < 3; c++)
+        {
+            ALIGN_VAR_16(int8_t, maskLo[16]);
+            ALIGN_VAR_16(int8_t, maskHi[16]);
+            for (int i = 0; i < 8; i++)
+            {
+                int pos = i * L::bpp + offset[c];
+                bool bLo = (i + 1) * L::bpp <= 16;
+                maskLo[2 * i] = bLo ? (int8_t)pos : -128;
+                maskHi[2 * i] = bLo ? -128 : (int8_t)(pos - HI_OFFSET);
+                maskLo[2 * i + 1] = maskHi[2 * i + 1] = -128;
+            }
+            lo[c] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)maskLo));
+            hi[c] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)maskHi));
+        }
+    }
+
+    static inline __m512i load4(const uint8_t* src)
+    {
+        __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)src));
+        v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + 8 * L::bpp)), 1);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + 16 * L::bpp)), 2);
+        return _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + 24 * L::bpp)), 3);
+    }
+
+    /* unpack 32 pixels to 16bit R, G and B */
+    void load(const uint8_t* src, __m512i& r, __m512i& g, __m512i& b) const
+    {
+        __m512i a = load4(src);
+        __m512i d = load4(src + HI_OFFSET);
+
+        r = _mm512_or_si512(_mm512_shuffle_epi8(a, lo[0]), _mm512_shuffle_epi8(d, hi[0]));
+        g = _mm512_or_si512(_mm512_shuffle_epi8(a, lo[1]), _mm512_shuffle_epi8(d, hi[1]));
+        b = _mm512_or_si512(_mm512_shuffle_epi8(a, lo[2]), _mm512_shuffle_epi8(d, hi[2]));
+    }
+};
+
+struct Weights
+{
+    __m512i rg;
+    __m512i b;
+    __m512i add;
+
+    Weights(const int16_t w[3], int add32)
+    {
+        rg  = _mm512_set1_epi32((w[1] << 16) | (uint16_t)w[0]);
+        b   = _mm512_set1_epi32((uint16_t)w[2]);
+        add = _mm512_set1_epi32(add32);
+    }
+};
+
+/* weighted sum of 32 16bit R, G, B triplets, lane order is preserved */
+template<int shift>
+inline __m512i dot3(__m512i r, __m512i g, __m512i b, const Weights& w)
+{
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i lo = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpacklo_epi16(r, g), w.rg),
+                                  _mm512_madd_epi16(_mm512_unpacklo_epi16(b, zero), w.b));
+    __m512i hi = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpackhi_epi16(r, g), w.rg),
+                                  _mm512_madd_epi16(_mm512_unpackhi_epi16(b, zero), w.b));
+    lo = _mm512_srai_epi32(_mm512_add_epi32(lo, w.add), shift);
+    hi = _mm512_srai_epi32(_mm512_add_epi32(hi, w.add), shift);
+
+    return _mm512_packs_epi32(lo, hi);
+}
+
+/* gathers the even then the odd 64bit words, undoing the per lane interleave
+ * of the pack instructions */
+inline __m512i deinterleave(__m512i v)
+{
+    return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), v);
+}
+
+/* saturate two vectors of 32 16bit values to 64 bytes in pixel order */
+inline __m512i pack(__m512i a, __m512i b)
+{
+    return deinterleave(_mm512_packus_epi16(a, b));
+}
+
+/* sums horizontal pairs of two rows of 64 pixels, returns 32 16bit sums */
+inline __m512i sum2x2(__m512i row0a, __m512i row0b, __m512i row1a, __m512i row1b)
+{
+    const __m512i one = _mm512_set1_epi16(1);
+
+    __m512i a = _mm512_madd_epi16(_mm512_add_epi16(row0a, row1a), one);
+    __m512i b = _mm512_madd_epi16(_mm512_add_epi16(row0b, row1b), one);
+
+    return deinterleave(_mm512_packs_epi32(a, b));
+}
+
+template<int packing>
+void rgb2yuv_i444_avx512(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                         uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                         const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChromaAdd());
+    const Weights wv(coeffs->v, rgb2yuvChromaAdd());
+    const int widthV = width & ~63;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 64)
+        {
+            __m512i r0, g0, b0, r1, g1, b1;
+            shuf.load(src + x * L::bpp, r0, g0, b0);
+            shuf.load(src + (x + 32) * L::bpp, r1, g1, b1);
+
+            __m512i luma = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wy), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wy));
+            __m512i cb = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wu), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wu));
+            __m512i cr = pack(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wv), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wv));
+
+            _mm512_storeu_si512((void*)(dstY + x), luma);
+            _mm512_storeu_si512((void*)(dstU + x), cb);
+            _mm512_storeu_si512((void*)(dstV + x), cr);
+        }
+
+        rgb2yuvRow444<packing>(src, dstY, dstU, dstV, widthV, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i420_avx512(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                         uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                         const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChroma420Add());
+    const Weights wv(coeffs->v, rgb2yuvChroma420Add());
+    const int widthV = width & ~63;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 64)
+        {
+            __m512i r00, g00, b00, r01, g01, b01, r10, g10, b10, r11, g11, b11;
+            shuf.load(src + x * L::bpp, r00, g00, b00);
+            shuf.load(src + (x + 32) * L::bpp, r01, g01, b01);
+            shuf.load(src1 + x * L::bpp, r10, g10, b10);
+            shuf.load(src1 + (x + 32) * L::bpp, r11, g11, b11);
+
+            _mm512_storeu_si512((void*)(dstY + x), pack(dot3<RGB2YUV_SHIFT>(r00, g00, b00, wy), dot3<RGB2YUV_SHIFT>(r01, g01, b01, wy)));
+            _mm512_storeu_si512((void*)(dstY1 + x), pack(dot3<RGB2YUV_SHIFT>(r10, g10, b10, wy), dot3<RGB2YUV_SHIFT>(r11, g11, b11, wy)));
+
+            __m512i sr = sum2x2(r00, r01, r10, r11);
+            __m512i sg = sum2x2(g00, g01, g10, g11);
+            __m512i sb = sum2x2(b00, b01, b10, b11);
+            __m512i chroma = pack(dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wu), dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wv));
+
+            _mm256_storeu_si256((__m256i*)(dstU + (x >> 1)), _mm512_castsi512_si256(chroma));
+            _mm256_storeu_si256((__m256i*)(dstV + (x >> 1)), _mm512_extracti64x4_epi64(chroma, 1));
+        }
+
+        rgb2yuvRow420<packing>(src, src1, dstY, dstY1, dstU, dstV, widthV, width, *coeffs);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicColorConvert_avx512(EncoderPrimitives &p)
+{
+#define RGB2YUV_AVX512(PACKING) \
+    p.rgb2yuv[PACKING][X265_CSP_I420] = rgb2yuv_i420_avx512<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I444] = rgb2yuv_i444_avx512<PACKING>;
+
+    RGB2YUV_AVX512(RGB_PACKING_RGB);
+    RGB2YUV_AVX512(RGB_PACKING_BGR);
+    RGB2YUV_AVX512(RGB_PACKING_RGBA);
+    RGB2YUV_AVX512(RGB_PACKING_BGRA);
+
+#undef RGB2YUV_AVX512
+}
+}
@@ -0,0 +1,416 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+#include <xmmintrin.h> // SSE
+#include <smmintrin.h> // SSE4.1
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* pshufb masks gathering one colour component of 8 packed pixels into 16bit
+ * lanes. The 8 pixels straddle two 16 byte loads, lo at the first pixel and
+ * hi at byte offset HI_OFFSET, so 24bit pixels are loaded without overread */
+template<int packing>
+struct ComponentShuffle
+{
+    typedef RGBLayout<packing> L;
+    enum { HI_OFFSET = L::bpp == 3 ? 8 : 16 };
+
+    __m128i lo[3];
+    __m128i hi[3];
+
+    ComponentShuffle()
+    {
+        const int offset[3] = { L::r, L::g, L::b };
+        for (int c = 0; c < 3; c++)
+        {
+            ALIGN_VAR_16(int8_t, maskLo[16]);
+            ALIGN_VAR_16(int8_t, maskHi[16]);
+            for (int i = 0; i < 8; i++)
+            {
+                int pos = i * L::bpp + offset[c];
+                bool bLo = (i + 1) * L::bpp <= 16;
+                maskLo[2 * i] = bLo ? (int8_t)pos : -128;
+                maskHi[2 * i] = bLo ? -128 : (int8_t)(pos - HI_OFFSET);
+                maskLo[2 * i + 1] = maskHi[2 * i + 1] = -128;
+            }
+            lo[c] = _mm_load_si128((const __m128i*)maskLo);
+            hi[c] = _mm_load_si128((const __m128i*)maskHi);
+        }
+    }
+
+    /* unpack 8 pixels to 16bit R, G and B */
+    void load(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b) const
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)src);
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + HI_OFFSET));
+
+        r = _mm_or_si128(_mm_shuffle_epi8(a, lo[0]), _mm_shuffle_epi8(d, hi[0]));
+        g = _mm_or_si128(_mm_shuffle_epi8(a, lo[1]), _mm_shuffle_epi8(d, hi[1]));
+        b = _mm_or_si128(_mm_shuffle_epi8(a, lo[2]), _mm_shuffle_epi8(d, hi[2]));
+    }
+};
+
+/* 8 RGB565 pixels are a single load of 16bit words, components are masked
+ * out and widened as in rgbLoad */
+template<>
+struct ComponentShuffle<RGB_PACKING_RGB565>
+{
+    ComponentShuffle() {}
+
+    void load(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b) const
+    {
+        const __m128i m5 = _mm_set1_epi16(0xF8);
+        const __m128i m6 = _mm_set1_epi16(0xFC);
+        __m128i px = _mm_loadu_si128((const __m128i*)src);
+
+        r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(px, 8), m5), _mm_srli_epi16(px, 13));
+        g = _mm_and_si128(_mm_srli_epi16(px, 3), m6);
+        g = _mm_or_si128(g, _mm_srli_epi16(g, 6));
+        b = _mm_and_si128(_mm_slli_epi16(px, 3), m5);
+        b = _mm_or_si128(b, _mm_srli_epi16(b, 5));
+    }
+};
+
+/* pshufb masks gathering one colour component of 16 packed pixels into
+ * bytes. The pixels span bpp 16 byte loads and every load contributes the
+ * components it holds, the other mask bytes zero their lanes */
+template<int packing>
+struct PlaneShuffle
+{
+    typedef RGBLayout<packing> L;
+
+    __m128i mask[3][L::bpp];
+
+    PlaneShuffle()
+    {
+        const int offset[3] = { L::g, L::b, L::r };
+        ALIGN_VAR_16(int8_t, m[16]);
+
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < L::bpp; k++)
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    int pos = i * L::bpp + offset[c] - 16 * k;
+                    m[i] = pos >= 0 && pos < 16 ? (int8_t)pos : -128;
+                }
+                mask[c][k] = _mm_load_si128((const __m128i*)m);
+            }
+        }
+    }
+
+    /* split 16 pixels into G, B and R bytes */
+    void split(const uint8_t* src, __m128i plane[3]) const
+    {
+        __m128i v[L::bpp];
+        for (int k = 0; k < L::bpp; k++)
+            v[k] = _mm_loadu_si128((const __m128i*)(src + 16 * k));
+
+        for (int c = 0; c < 3; c++)
+        {
+            plane[c] = _mm_shuffle_epi8(v[0], mask[c][0]);
+            for (int k = 1; k < L::bpp; k++)
+                plane[c] = _mm_or_si128(plane[c], _mm_shuffle_epi8(v[k], mask[c][k]));
+        }
+    }
+};
+
+/* one row of conversion weights, R and G interleaved for pmaddwd */
+struct Weights
+{
+    __m128i rg;
+    __m128i b;
+    __m128i add;
+
+    Weights(const int16_t w[3], int add32)
+    {
+        rg  = _mm_set1_epi32((w[1] << 16) | (uint16_t)w[0]);
+        b   = _mm_set1_epi32((uint16_t)w[2]);
+        add = _mm_set1_epi32(add32);
+    }
+};
+
+/* weighted sum of 8 16bit R, G, B triplets, returns 8 signed 16bit results */
+template<int shift>
+inline __m128i dot3(__m128i r, __m128i g, __m128i b, const Weights& w)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r, g), w.rg),
+                               _mm_madd_epi16(_mm_unpacklo_epi16(b, zero), w.b));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r, g), w.rg),
+                               _mm_madd_epi16(_mm_unpackhi_epi16(b, zero), w.b));
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, w.add), shift);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, w.add), shift);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+/* sums horizontal pairs of two rows of 16 pixels, returns 8 16bit sums */
+inline __m128i sum2x2(__m128i row0a, __m128i row0b, __m128i row1a, __m128i row1b)
+{
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i a = _mm_madd_epi16(_mm_add_epi16(row0a, row1a), one);
+    __m128i b = _mm_madd_epi16(_mm_add_epi16(row0b, row1b), one);
+
+    return _mm_packs_epi32(a, b);
+}
+
+template<int packing>
+void rgb2yuv_i444_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChromaAdd());
+    const Weights wv(coeffs->v, rgb2yuvChromaAdd());
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i r0, g0, b0, r1, g1, b1;
+            shuf.load(src + x * L::bpp, r0, g0, b0);
+            shuf.load(src + (x + 8) * L::bpp, r1, g1, b1);
+
+            __m128i luma = _mm_packus_epi16(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wy), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wy));
+            __m128i cb = _mm_packus_epi16(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wu), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wu));
+            __m128i cr = _mm_packus_epi16(dot3<RGB2YUV_SHIFT>(r0, g0, b0, wv), dot3<RGB2YUV_SHIFT>(r1, g1, b1, wv));
+
+            _mm_storeu_si128((__m128i*)(dstY + x), luma);
+            _mm_storeu_si128((__m128i*)(dstU + x), cb);
+            _mm_storeu_si128((__m128i*)(dstV + x), cr);
+        }
+
+        rgb2yuvRow444<packing>(src, dstY, dstU, dstV, widthV, width, *coeffs);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2yuv_i420_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                       uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height,
+                       const RGBToYUVCoeffs* coeffs)
+{
+    typedef RGBLayout<packing> L;
+    const ComponentShuffle<packing> shuf;
+    const Weights wy(coeffs->y, rgb2yuvLumaAdd(*coeffs));
+    const Weights wu(coeffs->u, rgb2yuvChroma420Add());
+    const Weights wv(coeffs->v, rgb2yuvChroma420Add());
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i r00, g00, b00, r01, g01, b01, r10, g10, b10, r11, g11, b11;
+            shuf.load(src + x * L::bpp, r00, g00, b00);
+            shuf.load(src + (x + 8) * L::bpp, r01, g01, b01);
+            shuf.load(src1 + x * L::bpp, r10, g10, b10);
+            shuf.load(src1 + (x + 8) * L::bpp, r11, g11, b11);
+
+            __m128i luma0 = _mm_packus_epi16(dot3<RGB2YUV_SHIFT>(r00, g00, b00, wy), dot3<RGB2YUV_SHIFT>(r01, g01, b01, wy));
+            __m128i luma1 = _mm_packus_epi16(dot3<RGB2YUV_SHIFT>(r10, g10, b10, wy), dot3<RGB2YUV_SHIFT>(r11, g11, b11, wy));
+            _mm_storeu_si128((__m128i*)(dstY + x), luma0);
+            _mm_storeu_si128((__m128i*)(dstY1 + x), luma1);
+
+            __m128i sr = sum2x2(r00, r01, r10, r11);
+            __m128i sg = sum2x2(g00, g01, g10, g11);
+            __m128i sb = sum2x2(b00, b01, b10, b11);
+            __m128i chroma = _mm_packus_epi16(dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wu), dot3<RGB2YUV_SHIFT + 2>(sr, sg, sb, wv));
+
+            _mm_storel_epi64((__m128i*)(dstU + (x >> 1)), chroma);
+            _mm_storel_epi64((__m128i*)(dstV + (x >> 1)), _mm_srli_si128(chroma, 8));
+        }
+
+        rgb2yuvRow420<packing>(src, src1, dstY, dstY1, dstU, dstV, widthV, width, *coeffs);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+template<int packing>
+void rgb2gbr_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstG, uint8_t* dstB, uint8_t* dstR,
+                  intptr_t dstStride, int width, int height)
+{
+    typedef RGBLayout<packing> L;
+    static const PlaneShuffle<packing> shuf;
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i plane[3];
+            shuf.split(src + x * L::bpp, plane);
+
+            _mm_storeu_si128((__m128i*)(dstG + x), plane[0]);
+            _mm_storeu_si128((__m128i*)(dstB + x), plane[1]);
+            _mm_storeu_si128((__m128i*)(dstR + x), plane[2]);
+        }
+
+        rgb2gbrRow<packing>(src, dstG, dstB, dstR, widthV, width);
+
+        src += srcStride;
+        dstG += dstStride;
+        dstB += dstStride;
+        dstR += dstStride;
+    }
+}
+
+/* YUYV: Y0-7, U0-3, V0-3 of the 8 pixels in one load */
+inline __m128i yuyvShuffle(const uint8_t* src)
+{
+    const __m128i mask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), mask);
+}
+
+void yuyv2yuv_i422_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i a = yuyvShuffle(src + 2 * x);
+            __m128i b = yuyvShuffle(src + 2 * x + 16);
+            __m128i uv = _mm_unpackhi_epi32(a, b);
+
+            _mm_storeu_si128((__m128i*)(dstY + x), _mm_unpacklo_epi64(a, b));
+            _mm_storel_epi64((__m128i*)(dstU + (x >> 1)), uv);
+            _mm_storel_epi64((__m128i*)(dstV + (x >> 1)), _mm_srli_si128(uv, 8));
+        }
+
+        yuyv2yuvRow422(src, dstY, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstY += dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void yuyv2yuv_i420_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstY, intptr_t dstStrideY,
+                        uint8_t* dstU, uint8_t* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const uint8_t* src1 = src + srcStride;
+        uint8_t* dstY1 = dstY + dstStrideY;
+
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i a0 = yuyvShuffle(src + 2 * x);
+            __m128i b0 = yuyvShuffle(src + 2 * x + 16);
+            __m128i a1 = yuyvShuffle(src1 + 2 * x);
+            __m128i b1 = yuyvShuffle(src1 + 2 * x + 16);
+            __m128i uv = _mm_avg_epu8(_mm_unpackhi_epi32(a0, b0), _mm_unpackhi_epi32(a1, b1));
+
+            _mm_storeu_si128((__m128i*)(dstY + x), _mm_unpacklo_epi64(a0, b0));
+            _mm_storeu_si128((__m128i*)(dstY1 + x), _mm_unpacklo_epi64(a1, b1));
+            _mm_storel_epi64((__m128i*)(dstU + (x >> 1)), uv);
+            _mm_storel_epi64((__m128i*)(dstV + (x >> 1)), _mm_srli_si128(uv, 8));
+        }
+
+        yuyv2yuvRow420(src, src1, dstY, dstY1, dstU, dstV, widthV, width);
+
+        src += 2 * srcStride;
+        dstY += 2 * dstStrideY;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+    }
+}
+
+void uvsplit_sse4(const uint8_t* src, intptr_t srcStride, uint8_t* dstU, uint8_t* dstV, intptr_t dstStride, int width, int height)
+{
+    const __m128i mask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    const int widthV = width & ~15;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < widthV; x += 16)
+        {
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * x)), mask);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * x + 16)), mask);
+
+            _mm_storeu_si128((__m128i*)(dstU + x), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(dstV + x), _mm_unpackhi_epi64(a, b));
+        }
+
+        uvsplitRow(src, dstU, dstV, widthV, width);
+
+        src += srcStride;
+        dstU += dstStride;
+        dstV += dstStride;
+    }
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicColorConvert_sse41(EncoderPrimitives &p)
+{
+#define RGB2YUV_SSE4(PACKING) \
+    p.rgb2yuv[PACKING][X265_CSP_I420] = rgb2yuv_i420_sse4<PACKING>; \
+    p.rgb2yuv[PACKING][X265_CSP_I444] = rgb2yuv_i444_sse4<PACKING>;
+
+    RGB2YUV_SSE4(RGB_PACKING_RGB);
+    RGB2YUV_SSE4(RGB_PACKING_BGR);
+    RGB2YUV_SSE4(RGB_PACKING_RGBA);
+    RGB2YUV_SSE4(RGB_PACKING_BGRA);
+    RGB2YUV_SSE4(RGB_PACKING_RGB565);
+
+#undef RGB2YUV_SSE4
+
+    /* the compiler already vectorizes the 4 byte de-interleave as well as
+     * pshufb does, only the 3 byte packings gain */
+    p.rgb2gbr[RGB_PACKING_RGB] = rgb2gbr_sse4<RGB_PACKING_RGB>;
+    p.rgb2gbr[RGB_PACKING_BGR] = rgb2gbr_sse4<RGB_PACKING_BGR>;
+
+    p.yuyv2yuv[X265_CSP_I420] = yuyv2yuv_i420_sse4;
+    p.yuyv2yuv[X265_CSP_I422] = yuyv2yuv_i422_sse4;
+    p.uvsplit = uvsplit_sse4;
+}
+}
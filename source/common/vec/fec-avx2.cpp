@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "fec.h"
+#include <immintrin.h> // AVX2
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* The SSSE3 nibble lookup with the tables broadcast to both lanes, two
+ * vectors per iteration */
+void gfmuladd_avx2(uint8_t* dst, const uint8_t* src, uint8_t c, intptr_t size)
+{
+    if (c <= 1)
+    {
+        gfMulAddRow(dst, src, c, 0, size);
+        return;
+    }
+
+    ALIGN_VAR_16(uint8_t, lo[16]);
+    ALIGN_VAR_16(uint8_t, hi[16]);
+    gf256NibbleTables(c, lo, hi);
+    const __m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)lo));
+    const __m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)hi));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    intptr_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m256i s0 = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i s1 = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        __m256i p0 = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(s0, mask)),
+                                      _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(s0, 4), mask)));
+        __m256i p1 = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(s1, mask)),
+                                      _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(s1, 4), mask)));
+        __m256i d0 = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i d1 = _mm256_loadu_si256((const __m256i*)(dst + i + 32));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(d0, p0));
+        _mm256_storeu_si256((__m256i*)(dst + i + 32), _mm256_xor_si256(d1, p1));
+    }
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask)),
+                                     _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(s, 4), mask)));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(d, p));
+    }
+    gfMulAddRow(dst, src, c, i, size);
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicFec_avx2(EncoderPrimitives &p)
+{
+    p.gfmuladd = gfmuladd_avx2;
+}
+}
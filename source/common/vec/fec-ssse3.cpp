@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "fec.h"
+#include <tmmintrin.h> // SSSE3
+
+using namespace X265_NS;
+
+namespace {
+// file local namespace
+
+/* Each nibble of src selects c times that nibble from a 16 entry table */
+void gfmuladd_ssse3(uint8_t* dst, const uint8_t* src, uint8_t c, intptr_t size)
+{
+    if (c <= 1)
+    {
+        gfMulAddRow(dst, src, c, 0, size);
+        return;
+    }
+
+    ALIGN_VAR_16(uint8_t, lo[16]);
+    ALIGN_VAR_16(uint8_t, hi[16]);
+    gf256NibbleTables(c, lo, hi);
+    const __m128i tlo = _mm_load_si128((const __m128i*)lo);
+    const __m128i thi = _mm_load_si128((const __m128i*)hi);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    intptr_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i pl = _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask));
+        __m128i ph = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi16(s, 4), mask));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, _mm_xor_si128(pl, ph)));
+    }
+    gfMulAddRow(dst, src, c, i, size);
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicFec_ssse3(EncoderPrimitives &p)
+{
+    p.gfmuladd = gfmuladd_ssse3;
+}
+}
@@ -31,6 +31,7 @@
 #define HAVE_SSSE3
 #define HAVE_SSE4
 #define HAVE_AVX2
+#define HAVE_AVX512
 #elif defined(__GNUC__)
 #define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
 #if __clang__ || GCC_VERSION >= 40300 /* gcc_version >= gcc-4.3.0 */
@@ -41,6 +42,9 @@
 #if __clang__ || GCC_VERSION >= 40700 /* gcc_version >= gcc-4.7.0 */
 #define HAVE_AVX2
 #endif
+#if __clang__ || GCC_VERSION >= 50000 /* gcc_version >= gcc-5.0.0 */
+#define HAVE_AVX512
+#endif
 #elif defined(_MSC_VER)
 #define HAVE_SSE3
 #define HAVE_SSSE3
@@ -48,6 +52,9 @@
 #if _MSC_VER >= 1700 // VC11
 #define HAVE_AVX2
 #endif
+#if _MSC_VER >= 1911 // VC15.3
+#define HAVE_AVX512
+#endif
 #endif // compiler checks
 #endif // if X265_ARCH_X86
 
@@ -56,7 +63,12 @@ namespace X265_NS {
 
 void setupIntrinsicDCT_sse3(EncoderPrimitives&);
 void setupIntrinsicDCT_ssse3(EncoderPrimitives&);
+void setupIntrinsicFec_ssse3(EncoderPrimitives&);
 void setupIntrinsicDCT_sse41(EncoderPrimitives&);
+void setupIntrinsicColorConvert_sse41(EncoderPrimitives&);
+void setupIntrinsicColorConvert_avx2(EncoderPrimitives&);
+void setupIntrinsicFec_avx2(EncoderPrimitives&);
+void setupIntrinsicColorConvert_avx512(EncoderPrimitives&);
 
 /* Use primitives for the best available vector architecture */
 void setupInstrinsicPrimitives(EncoderPrimitives &p, int cpuMask)
@@ -71,12 +83,27 @@ void setupInstrinsicPrimitives(EncoderPrimitives &p, int cpuMask)
     if (cpuMask & X265_CPU_SSSE3)
     {
         setupIntrinsicDCT_ssse3(p);
+        setupIntrinsicFec_ssse3(p);
     }
 #endif
 #ifdef HAVE_SSE4
     if (cpuMask & X265_CPU_SSE4)
     {
         setupIntrinsicDCT_sse41(p);
+        setupIntrinsicColorConvert_sse41(p);
+    }
+#endif
+#ifdef HAVE_AVX2
+    if (cpuMask & X265_CPU_AVX2)
+    {
+        setupIntrinsicColorConvert_avx2(p);
+        setupIntrinsicFec_avx2(p);
+    }
+#endif
+#ifdef HAVE_AVX512
+    if (cpuMask & X265_CPU_AVX512)
+    {
+        setupIntrinsicColorConvert_avx512(p);
     }
 #endif
     (void)p;
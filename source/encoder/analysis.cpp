@@ -264,6 +264,10 @@ Mode& Analysis::compressCTU(CUData& ctu, Frame& frame, const CUGeom& cuGeom, con
             ctu.m_cuPelX / m_param->maxCUSize >= frame.m_encData->m_pir.pirStartCol
             && ctu.m_cuPelX / m_param->maxCUSize < frame.m_encData->m_pir.pirEndCol)
             compressIntraCU(ctu, cuGeom, qp);
+        else if (m_frame->m_ctuChangeMap && !m_frame->m_ctuChangeMap[ctu.m_cuAddr] && compressUnchangedCU(ctu, cuGeom, qp))
+        {
+            /* coded as skip, the source did not touch this CTU */
+        }
         else if (!m_param->rdLevel)
         {
             /* In RD Level 0/1, copy source pixels into the reconstructed block so
@@ -2865,6 +2869,54 @@ void Analysis::checkMerge2Nx2N_rd0_4(Mode& skip, Mode& merge, const CUGeom& cuGe
     checkDQP(*md.bestMode, cuGeom);
 }
 
+/* Codes the CTU as one 2Nx2N skip CU using the zero motion L0 merge candidate
+ * into the previous picture, whose reconstruction already holds these pixels.
+ * Returns false, leaving the CTU to the normal analysis, when the previous
+ * picture is not the first L0 reference or no such candidate exists */
+bool Analysis::compressUnchangedCU(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp)
+{
+    if ((cuGeom.flags & CUGeom::SPLIT_MANDATORY) || m_param->bLossless)
+        return false;
+    if (!m_slice->m_numRefIdx[0] || m_slice->m_refPOCList[0][0] != m_slice->m_poc - 1)
+        return false;
+
+    uint32_t depth = cuGeom.depth;
+    ModeDepth& md = m_modeDepth[depth];
+    Mode& skip = md.pred[PRED_SKIP];
+
+    skip.cu.initSubCU(parentCTU, cuGeom, qp);
+    skip.initCosts();
+    skip.cu.setPartSizeSubParts(SIZE_2Nx2N);
+    skip.cu.setPredModeSubParts(MODE_INTER);
+    skip.cu.m_mergeFlag[0] = true;
+
+    MVField candMvField[MRG_MAX_NUM_CANDS][2];
+    uint8_t candDir[MRG_MAX_NUM_CANDS];
+    uint32_t numMergeCand = skip.cu.getInterMergeCandidates(0, 0, candMvField, candDir);
+    uint32_t cand = 0;
+    while (cand < numMergeCand && (candDir[cand] != 1 || candMvField[cand][0].refIdx || candMvField[cand][0].mv.word))
+        cand++;
+    if (cand == numMergeCand)
+        return false;
+
+    skip.cu.m_mvpIdx[0][0] = (uint8_t)cand; // merge candidate ID is stored in L0 MVP idx
+    skip.cu.setPUInterDir(candDir[cand], 0, 0);
+    skip.cu.setPUMv(0, candMvField[cand][0].mv, 0, 0);
+    skip.cu.setPUMv(1, candMvField[cand][1].mv, 0, 0);
+    skip.cu.setPURefIdx(0, (int8_t)candMvField[cand][0].refIdx, 0, 0);
+    skip.cu.setPURefIdx(1, (int8_t)candMvField[cand][1].refIdx, 0, 0);
+
+    PredictionUnit pu(skip.cu, cuGeom, 0);
+    motionCompensation(skip.cu, pu, skip.predYuv, true, m_csp != X265_CSP_I400 && m_frame->m_fencPic->m_picCsp != X265_CSP_I400);
+    encodeResAndCalcRdSkipCU(skip);
+    checkDQP(skip, cuGeom);
+
+    md.bestMode = &skip;
+    skip.cu.copyToPic(depth);
+    skip.reconYuv.copyToPicYuv(*m_frame->m_reconPic, parentCTU.m_cuAddr, cuGeom.absPartIdx);
+    return true;
+}
+
 /* sets md.bestMode if a valid merge candidate is found, else leaves it NULL */
 void Analysis::checkMerge2Nx2N_rd5_6(Mode& skip, Mode& merge, const CUGeom& cuGeom)
 {
@@ -172,6 +172,9 @@ protected:
 
     void recodeCU(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp, int32_t origqp = -1);
 
+    /* zero motion skip for a CTU the source reported unchanged, no analysis */
+    bool compressUnchangedCU(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp);
+
     /* measure merge and skip */
     void checkMerge2Nx2N_rd0_4(Mode& skip, Mode& merge, const CUGeom& cuGeom);
     void checkMerge2Nx2N_rd5_6(Mode& skip, Mode& merge, const CUGeom& cuGeom);
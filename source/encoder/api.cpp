@@ -721,6 +721,15 @@ int x265_encoder_intra_refresh(x265_encoder *enc)
     encoder->m_bQueuedIntraRefresh = 1;
     return 0;
 }
+int x265_encoder_invalidate_reference(x265_encoder *enc, int poc)
+{
+    if (!enc)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    return encoder->invalidateReference(poc) ? 0 : -1;
+}
+
 int x265_encoder_ctu_info(x265_encoder *enc, int poc, x265_ctu_info_t** ctu)
 {
     if (!ctu || !enc)
@@ -730,6 +739,25 @@ int x265_encoder_ctu_info(x265_encoder *enc, int poc, x265_ctu_info_t** ctu)
     return 0;
 }
 
+int x265_encoder_set_nal_callback(x265_encoder *enc, x265_nal_callback callback, void *opaque)
+{
+    if (!enc)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (callback && encoder->m_param->frameNumThreads > 1)
+    {
+        x265_log(encoder->m_param, X265_LOG_ERROR, "NAL callback requires --frame-threads 1\n");
+        return -1;
+    }
+    if (callback && encoder->m_param->bEnableSAO)
+        x265_log(encoder->m_param, X265_LOG_WARNING, "SAO delays NAL callbacks until each picture is complete, use --no-sao to send slices early\n");
+
+    encoder->m_nalCallback = callback;
+    encoder->m_nalCallbackOpaque = opaque;
+    return 0;
+}
+
 int x265_get_slicetype_poc_and_scenecut(x265_encoder *enc, int *slicetype, int *poc, int *sceneCut)
 {
     if (!enc)
@@ -963,6 +991,9 @@ void x265_picture_init(x265_param *param, x265_picture *pic)
     pic->colorSpace = param->internalCsp;
     pic->forceqp = X265_QP_AUTO;
     pic->quantOffsets = NULL;
+    pic->changeMap = NULL;
+    pic->rowsReady = NULL;
+    pic->rowsOpaque = NULL;
     pic->userSEI.payloads = NULL;
     pic->userSEI.numPayloads = 0;
     pic->rpu.payloadSize = 0;
@@ -1054,7 +1085,9 @@ static const x265_api libapi =
     &x265_calculate_vmaf_framelevelscore,
     &x265_vmaf_encoder_log,
 #endif
-    &PARAM_NS::x265_zone_param_parse
+    &PARAM_NS::x265_zone_param_parse,
+    &x265_encoder_set_nal_callback,
+    &x265_encoder_invalidate_reference,
 };
 
 typedef const x265_api* (*api_get_func)(int bitDepth);
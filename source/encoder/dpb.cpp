@@ -166,6 +166,7 @@ void DPB::prepareEncode(Frame *newFrame)
         newFrame->m_encData->m_bHasReferences = true;
     }
 
+    newFrame->m_bInvalidated = false;
     m_picList.pushFront(*newFrame);
 
     // Do decoding refresh marking if any
@@ -173,6 +174,22 @@ void DPB::prepareEncode(Frame *newFrame)
 
     computeRPS(pocCurr, slice->isIRAP(), &slice->m_rps, slice->m_sps->maxDecPicBuffering);
 
+    /* Invalidated references may leave a B picture without a future
+     * reference, code it as P. If every reference was invalidated there is
+     * nothing left to predict from; code the picture as a non-IRAP I slice
+     * so the receiver recovers without an IDR. The lowres type follows, rate
+     * control and the picture output read the slice type from it */
+    if (slice->m_sliceType == B_SLICE && !slice->m_rps.numberOfPositivePictures)
+    {
+        slice->m_sliceType = P_SLICE;
+        newFrame->m_lowres.sliceType = X265_TYPE_P;
+    }
+    if (slice->m_sliceType != I_SLICE && !slice->m_rps.numberOfPictures)
+    {
+        slice->m_sliceType = I_SLICE;
+        newFrame->m_lowres.sliceType = X265_TYPE_I;
+    }
+
     // Mark pictures in m_piclist as unreferenced if they are not included in RPS
     applyReferencePictureSet(&slice->m_rps, pocCurr);
 
@@ -218,6 +235,49 @@ void DPB::prepareEncode(Frame *newFrame)
     }
 }
 
+/* Stop predicting from a picture the receiver failed to decode. The picture,
+ * and every picture in the DPB that was predicted from it directly or
+ * through another invalidated picture, are marked unreferenced so that
+ * computeRPS() leaves them out of all later reference lists. Returns false
+ * if the POC is no longer (or not yet) in the DPB */
+bool DPB::invalidateReference(int poc)
+{
+    Frame* lost = m_picList.getPOC(poc);
+    if (!lost)
+        return false;
+
+    lost->m_bInvalidated = true;
+    lost->m_encData->m_bHasReferences = false;
+
+    /* m_picList is kept newest first, walk it oldest first so one pass
+     * carries the invalidation down every chain of prediction */
+    for (Frame* iterPic = m_picList.last(); iterPic; iterPic = iterPic->m_prev)
+    {
+        if (iterPic->m_bInvalidated || iterPic->m_poc == poc)
+            continue;
+
+        Slice* slice = iterPic->m_encData->m_slice;
+        int numPredDir = slice->isInterP() ? 1 : slice->isInterB() ? 2 : 0;
+        for (int l = 0; l < numPredDir && !iterPic->m_bInvalidated; l++)
+        {
+            for (int ref = 0; ref < slice->m_numRefIdx[l]; ref++)
+            {
+                /* look the reference up by POC, the Frame it pointed to may
+                 * have been recycled for a later picture */
+                Frame* refPic = m_picList.getPOC(slice->m_refPOCList[l][ref]);
+                if (refPic && refPic->m_bInvalidated)
+                {
+                    iterPic->m_bInvalidated = true;
+                    iterPic->m_encData->m_bHasReferences = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 void DPB::computeRPS(int curPoc, bool isRAP, RPS * rps, unsigned int maxDecPicBuffer)
 {
     unsigned int poci = 0, numNeg = 0, numPos = 0;
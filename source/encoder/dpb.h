@@ -75,6 +75,8 @@ public:
 
     void recycleUnreferenced();
 
+    bool invalidateReference(int poc);
+
 protected:
 
     void computeRPS(int curPoc, bool isRAP, RPS * rps, unsigned int maxDecPicBuffer);
@@ -90,6 +90,8 @@ Encoder::Encoder()
     m_aborted = false;
     m_reconfigure = false;
     m_reconfigureRc = false;
+    m_nalCallback = NULL;
+    m_nalCallbackOpaque = NULL;
     m_encodedFrameNum = 0;
     m_pocLast = -1;
     m_curEncoder = 0;
@@ -516,6 +518,18 @@ void Encoder::create()
         }
     }
     m_bZeroLatency = !m_param->bframes && !m_param->lookaheadDepth && m_param->frameNumThreads == 1 && m_param->maxSlices == 1;
+    /* the picture is decided and its frame encoder started without reading
+     * its pixels only when nothing ahead of the CTU rows looks at them */
+    m_bProgressiveInput = m_bZeroLatency && m_param->rc.rateControlMode == X265_RC_CQP && !m_param->rc.vbvBufferSize &&
+                          !m_param->rc.aqMode && !m_param->bAQMotion && !m_param->rc.cuTree &&
+                          !m_param->rc.bStatRead && !m_param->rc.bStatWrite &&
+                          !m_param->bEnableWeightedPred && !m_param->bEnableWeightedBiPred &&
+                          !m_param->scenecutThreshold && !m_param->bHistBasedSceneCut && !m_param->bEnableFades &&
+                          !m_param->bEnableSceneCutAwareQp && !m_param->bEnableFrameDuplication &&
+                          !m_param->analysisSave && !m_param->analysisLoad && !m_param->bAnalysisType &&
+                          !m_param->bDynamicRefine && !m_param->bOptCUDeltaQP && !m_param->bField && !m_param->interlaceMode &&
+                          m_param->bCopyPicToFrame && m_param->csvLogLevel < 2 && !m_param->maxCLL && !m_param->maxFALL &&
+                          !m_param->minLuma && m_param->maxLuma == PIXEL_MAX;
     m_aborted |= parseLambdaFile(m_param);
 
     m_encodeStartTime = x265_mdate();
@@ -1689,8 +1703,23 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             inFrame->m_lowresInit = false;
         }
 
-        /* Copy input picture into a Frame and PicYuv, send to lookahead */
-        inFrame->m_fencPic->copyFromPicture(*inputPic, *m_param, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
+        /* Copy input picture into a Frame and PicYuv, send to lookahead. A
+         * picture still being written is copied by its FrameEncoder row by
+         * row when possible, otherwise wait for all of it here */
+        inFrame->m_sourcePic.rowsReady = NULL;
+        if (inputPic->rowsReady && m_bProgressiveInput)
+        {
+            inFrame->m_sourcePic = *inputPic;
+            inFrame->m_sourceRows = 0;
+            inFrame->m_sourcePadX = m_sps.conformanceWindow.rightOffset;
+            inFrame->m_sourcePadY = m_sps.conformanceWindow.bottomOffset;
+        }
+        else
+        {
+            if (inputPic->rowsReady)
+                inputPic->rowsReady(inputPic->rowsOpaque, m_param->sourceHeight - m_sps.conformanceWindow.bottomOffset);
+            inFrame->m_fencPic->copyFromPicture(*inputPic, *m_param, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
+        }
 
         inFrame->m_poc       = ++m_pocLast;
         inFrame->m_userData  = inputPic->userData;
@@ -1725,6 +1754,34 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             memcpy(inFrame->m_quantOffsets, inputPic->quantOffsets, cuCount * sizeof(float));
         }
 
+        if (inputPic->changeMap != NULL)
+        {
+            /* a CTU is unchanged only if every 16x16 block it covers is */
+            int blocksInRow = (m_param->sourceWidth - m_sps.conformanceWindow.rightOffset + 15) >> 4;
+            int blocksInCol = (m_param->sourceHeight - m_sps.conformanceWindow.bottomOffset + 15) >> 4;
+            int ctuBlocks = m_param->maxCUSize >> 4;
+            if (!inFrame->m_ctuChangeMap)
+                inFrame->m_ctuChangeMap = X265_MALLOC(uint8_t, m_sps.numCUsInFrame);
+            if (inFrame->m_ctuChangeMap)
+            {
+                for (uint32_t cuAddr = 0; cuAddr < m_sps.numCUsInFrame; cuAddr++)
+                {
+                    int bx0 = (cuAddr % m_sps.numCuInWidth) * ctuBlocks, bx1 = X265_MIN(bx0 + ctuBlocks, blocksInRow);
+                    int by0 = (cuAddr / m_sps.numCuInWidth) * ctuBlocks, by1 = X265_MIN(by0 + ctuBlocks, blocksInCol);
+                    uint8_t changed = 0;
+                    for (int by = by0; by < by1 && !changed; by++)
+                        for (int bx = bx0; bx < bx1; bx++)
+                            changed |= inputPic->changeMap[by * blocksInRow + bx];
+                    inFrame->m_ctuChangeMap[cuAddr] = changed;
+                }
+            }
+        }
+        else if (inFrame->m_ctuChangeMap)
+        {
+            X265_FREE(inFrame->m_ctuChangeMap);
+            inFrame->m_ctuChangeMap = NULL;
+        }
+
         if (m_pocLast == 0)
             m_firstPts = inFrame->m_pts;
         if (m_bframeDelay && m_pocLast == m_bframeDelay)
@@ -2381,6 +2438,16 @@ bool Encoder::isReconfigureRc(x265_param* latestParam, x265_param* param_in)
         || latestParam->rc.rfConstant != param_in->rc.rfConstant);
 }
 
+/* Called between encodes, while no picture is being added to or recycled from
+ * the DPB */
+bool Encoder::invalidateReference(int poc)
+{
+    if (!m_dpb->invalidateReference(poc))
+        return false;
+    x265_log(m_param, X265_LOG_DEBUG, "invalidated reference POC %d\n", poc);
+    return true;
+}
+
 void Encoder::copyCtuInfo(x265_ctu_info_t** frameCtuInfo, int poc)
 {
     uint32_t widthInCU = (m_param->sourceWidth + m_param->maxCUSize - 1) >> m_param->maxLog2CUSize;
@@ -225,6 +225,7 @@ public:
     Window             m_conformanceWindow;
 
     bool               m_bZeroLatency;     // x265_encoder_encode() returns NALs for the input picture, zero lag
+    bool               m_bProgressiveInput; // x265_picture.rowsReady rows are read as FrameEncoder reaches them
     bool               m_aborted;          // fatal error detected
     bool               m_reconfigure;      // Encoder reconfigure in progress
     bool               m_reconfigureRc;
@@ -236,6 +237,10 @@ public:
      * one is done. Requires bIntraRefresh to be set.*/
     int                m_bQueuedIntraRefresh;
 
+    /* Given each access unit as its slices complete, see x265_encoder_set_nal_callback */
+    x265_nal_callback  m_nalCallback;
+    void*              m_nalCallbackOpaque;
+
     /* For optimising slice QP */
     Lock               m_sliceQpLock;
     int                m_iFrameNum;   
@@ -314,6 +319,8 @@ public:
 
     void copyCtuInfo(x265_ctu_info_t** frameCtuInfo, int poc);
 
+    bool invalidateReference(int poc);
+
     int copySlicetypePocAndSceneCut(int *slicetype, int *poc, int *sceneCut);
 
     int getRefFrameList(PicYuv** l0, PicYuv** l1, int sliceType, int poc, int* pocL0, int* pocL1);
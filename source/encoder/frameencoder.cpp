@@ -52,6 +52,8 @@ FrameEncoder::FrameEncoder()
     m_outStreams = NULL;
     m_backupStreams = NULL;
     m_substreamSizes = NULL;
+    m_sliceRowsDone = NULL;
+    m_bStreamSlices = false;
     m_nr = NULL;
     m_tld = NULL;
     m_rows = NULL;
@@ -88,6 +90,7 @@ void FrameEncoder::destroy()
     delete[] m_outStreams;
     delete[] m_backupStreams;
     X265_FREE(m_sliceBaseRow);
+    X265_FREE((void*)m_sliceRowsDone);
     X265_FREE(m_sliceMaxBlockRow);
     X265_FREE(m_cuGeoms);
     X265_FREE(m_ctuGeomMap);
@@ -136,6 +139,9 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
     m_sliceBaseRow[0] = 0;
     m_sliceBaseRow[m_param->maxSlices] = m_numRows;
 
+    m_sliceRowsDone = X265_MALLOC(int, m_param->maxSlices);
+    ok &= !!m_sliceRowsDone;
+
     m_sliceMaxBlockRow = X265_MALLOC(uint32_t, m_param->maxSlices + 1);
     ok &= !!m_sliceMaxBlockRow;
     uint32_t maxBlockRows = (m_param->sourceHeight + (16 - 1)) / 16;
@@ -453,6 +459,14 @@ void FrameEncoder::compressFrame()
      * unit) */
     Slice* slice = m_frame->m_encData->m_slice;
 
+    /* SAO parameters are coded in the CTUs after the whole frame is filtered, so
+     * only SAO-less slices can be streamed as soon as their rows are coded */
+    m_bStreamSlices = m_top->m_nalCallback && !slice->m_bUseSao;
+    m_nextStreamSlice = 0;
+    m_streamedNals = 0;
+    for (uint32_t sliceId = 0; sliceId < m_param->maxSlices; sliceId++)
+        m_sliceRowsDone[sliceId] = 0;
+
     if (m_param->bEnableAccessUnitDelimiters && (m_frame->m_poc || m_param->bRepeatHeaders))
     {
         m_bs.resetBits();
@@ -853,6 +867,9 @@ void FrameEncoder::compressFrame()
                     }
                 }
 
+                // block until a progressive input picture has the source rows we need
+                m_frame->readSourceRows((row + 1) * m_param->maxCUSize);
+
                 enableRowEncoder(m_row_to_idx[row]); /* clear external dependency for this row */
                 if (!rowInSlice)
                 {
@@ -893,6 +910,8 @@ void FrameEncoder::compressFrame()
                     }
                 }
 
+                m_frame->readSourceRows((i + 1) * m_param->maxCUSize);
+
                 if (!i)
                     m_row0WaitTime = x265_mdate();
                 else if (i == m_numRows - 1)
@@ -996,59 +1015,11 @@ void FrameEncoder::compressFrame()
 
     m_entropyCoder.setBitstream(&m_bs);
 
-    if (m_param->maxSlices > 1)
+    /* streamed slices were serialized as their last rows completed */
+    if (!m_bStreamSlices)
     {
-        uint32_t nextSliceRow = 0;
-
-        for(uint32_t sliceId = 0; sliceId < m_param->maxSlices; sliceId++)
-        {
-            m_bs.resetBits();
-
-            const uint32_t sliceAddr = nextSliceRow * m_numCols;
-            if (m_param->bOptRefListLengthPPS)
-            {
-                ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
-                m_top->analyseRefIdx(slice->m_numRefIdx);
-            }
-            m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, sliceAddr, m_sliceAddrBits, slice->m_sliceQp);
-
-            // Find rows of current slice
-            const uint32_t prevSliceRow = nextSliceRow;
-            while(nextSliceRow < m_numRows && m_rows[nextSliceRow].sliceId == sliceId)
-                nextSliceRow++;
-
-            // serialize each row, record final lengths in slice header
-            uint32_t maxStreamSize = m_nalList.serializeSubstreams(&m_substreamSizes[prevSliceRow], (nextSliceRow - prevSliceRow), &m_outStreams[prevSliceRow]);
-
-            // complete the slice header by writing WPP row-starts
-            m_entropyCoder.setBitstream(&m_bs);
-            if (slice->m_pps->bEntropyCodingSyncEnabled)
-                m_entropyCoder.codeSliceHeaderWPPEntryPoints(&m_substreamSizes[prevSliceRow], (nextSliceRow - prevSliceRow - 1), maxStreamSize);
-            
-            m_bs.writeByteAlignment();
-
-            m_nalList.serialize(slice->m_nalUnitType, m_bs);
-        }
-    }
-    else
-    {
-        if (m_param->bOptRefListLengthPPS)
-        {
-            ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
-            m_top->analyseRefIdx(slice->m_numRefIdx);
-        }
-        m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, 0, 0, slice->m_sliceQp);
-
-        // serialize each row, record final lengths in slice header
-        uint32_t maxStreamSize = m_nalList.serializeSubstreams(m_substreamSizes, numSubstreams, m_outStreams);
-
-        // complete the slice header by writing WPP row-starts
-        m_entropyCoder.setBitstream(&m_bs);
-        if (slice->m_pps->bEntropyCodingSyncEnabled)
-            m_entropyCoder.codeSliceHeaderWPPEntryPoints(m_substreamSizes, (slice->m_sps->numCuInHeight - 1), maxStreamSize);
-        m_bs.writeByteAlignment();
-
-        m_nalList.serialize(slice->m_nalUnitType, m_bs);
+        for (uint32_t sliceId = 0; sliceId < m_param->maxSlices; sliceId++)
+            serializeSlice(sliceId);
     }
 
     if (m_param->decodedPictureHashSEI)
@@ -1098,6 +1069,9 @@ void FrameEncoder::compressFrame()
         m_nalList.serialize(NAL_UNIT_UNSPECIFIED, m_bs);
     }
 
+    if (m_top->m_nalCallback)
+        streamNals(true);
+
     m_endCompressTime = x265_mdate();
 
     /* Decrement referenced frame reference counts, allow them to be recycled */
@@ -1224,6 +1198,56 @@ void FrameEncoder::initDecodedPictureHashSEI(int row, int cuAddr, int height)
     }
 }
 
+void FrameEncoder::serializeSlice(uint32_t sliceId)
+{
+    Slice* slice = m_frame->m_encData->m_slice;
+    const uint32_t firstRow = m_sliceBaseRow[sliceId];
+    const uint32_t numStreams = m_param->bEnableWavefront ? m_sliceBaseRow[sliceId + 1] - firstRow : 1;
+
+    m_bs.resetBits();
+    m_entropyCoder.setBitstream(&m_bs);
+
+    if (m_param->bOptRefListLengthPPS)
+    {
+        ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
+        m_top->analyseRefIdx(slice->m_numRefIdx);
+    }
+    m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, firstRow * m_numCols, m_sliceAddrBits, slice->m_sliceQp);
+
+    // serialize each row, record final lengths in slice header
+    uint32_t maxStreamSize = m_nalList.serializeSubstreams(&m_substreamSizes[firstRow], numStreams, &m_outStreams[firstRow]);
+
+    // complete the slice header by writing WPP row-starts
+    m_entropyCoder.setBitstream(&m_bs);
+    if (slice->m_pps->bEntropyCodingSyncEnabled)
+        m_entropyCoder.codeSliceHeaderWPPEntryPoints(&m_substreamSizes[firstRow], numStreams - 1, maxStreamSize);
+    m_bs.writeByteAlignment();
+
+    m_nalList.serialize(slice->m_nalUnitType, m_bs);
+}
+
+/* Called by the worker that completes a slice. Slices may complete out of
+ * order, each is serialized and sent once all slices ahead of it have been */
+void FrameEncoder::streamSlices()
+{
+    ScopedLock lock(m_streamLock);
+
+    while (m_nextStreamSlice < m_param->maxSlices &&
+           m_sliceRowsDone[m_nextStreamSlice] == (int)(m_sliceBaseRow[m_nextStreamSlice + 1] - m_sliceBaseRow[m_nextStreamSlice]))
+    {
+        serializeSlice(m_nextStreamSlice++);
+        streamNals(false);
+    }
+}
+
+/* Give the NALs serialized since the last call to the NAL callback */
+void FrameEncoder::streamNals(bool bLast)
+{
+    uint32_t count = m_nalList.m_numNal - m_streamedNals;
+    m_top->m_nalCallback(m_top->m_nalCallbackOpaque, m_nalList.m_nal + m_streamedNals, count, m_frame->m_pts, bLast);
+    m_streamedNals = m_nalList.m_numNal;
+}
+
 void FrameEncoder::encodeSlice(uint32_t sliceAddr)
 {
     Slice* slice = m_frame->m_encData->m_slice;
@@ -1846,6 +1870,10 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
        if (!slice->m_bUseSao && (m_param->bEnableWavefront || bLastRowInSlice))
                rowCoder.finishSlice();
 
+    /* the slice is complete once every one of its substreams is flushed */
+    if (m_bStreamSlices && ATOMIC_INC(&m_sliceRowsDone[sliceId]) == (int)(endRowInSlicePlus1 - m_sliceBaseRow[sliceId]))
+        streamSlices();
+
 
     /* Processing left Deblock block with current threading */
     if ((m_param->bEnableLoopFilter | slice->m_bUseSao) & (rowInSlice >= 2))
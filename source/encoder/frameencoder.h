@@ -144,6 +144,14 @@ public:
     volatile int             m_completionCount;
     volatile int             m_vbvResetTriggerRow;
     volatile int             m_sliceCnt;
+    volatile int*            m_sliceRowsDone;   // rows of each slice whose substreams are flushed, when streaming
+
+    /* Slices go to the encoder's NAL callback in order as their rows complete,
+     * m_streamLock guards m_bs and m_nalList while they are written */
+    bool                     m_bStreamSlices;
+    uint32_t                 m_nextStreamSlice;
+    uint32_t                 m_streamedNals;
+    Lock                     m_streamLock;
 
     uint32_t                 m_numRows;
     uint32_t                 m_numCols;
@@ -234,6 +242,9 @@ protected:
     int  collectCTUStatistics(const CUData& ctu, FrameStats* frameLog);
     void noiseReductionUpdate();
     void writeTrailingSEIMessages();
+    void serializeSlice(uint32_t sliceId);
+    void streamSlices();
+    void streamNals(bool bLast);
     bool writeToneMapInfo(x265_sei_payload *payload);
 
     /* Called by WaveFront::findJob() */
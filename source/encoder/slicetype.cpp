@@ -1383,10 +1383,16 @@ void PreLookaheadGroup::processTasks(int workerThreadID)
         ProfileLookaheadTime(m_lookahead.m_preLookaheadElapsedTime, m_lookahead.m_countPreLookahead);
         ProfileScopeEvent(prelookahead);
         m_lock.release();
-        preFrame->m_lowres.init(preFrame->m_fencPic, preFrame->m_poc);
-        if (m_lookahead.m_bAdaptiveQuant)
-            tld.calcAdaptiveQuantFrame(preFrame, m_lookahead.m_param);
-        tld.lowresIntraEstimate(preFrame->m_lowres, m_lookahead.m_param->rc.qgSize);
+        /* the pixels of progressive input arrive after the lookahead is done
+         * with the picture, it only needs the state reset */
+        bool bPixels = !preFrame->m_sourcePic.rowsReady;
+        preFrame->m_lowres.init(preFrame->m_fencPic, preFrame->m_poc, bPixels);
+        if (bPixels)
+        {
+            if (m_lookahead.m_bAdaptiveQuant)
+                tld.calcAdaptiveQuantFrame(preFrame, m_lookahead.m_param);
+            tld.lowresIntraEstimate(preFrame->m_lowres, m_lookahead.m_param->rc.qgSize);
+        }
         preFrame->m_lowresInit = true;
 
         m_lock.acquire();
@@ -5,15 +5,12 @@
 #include <string.h>
 
 #include "input/rgbreader.h"
+#include "common.h"
+#include "primitives.h"
 
-namespace  {
+using namespace X265_NS;
 
-inline int clamp(int num, int min, int max)
-{
-    return (num < min) ? min :
-                         (num > max) ? max :
-                                       num;
-}
+namespace  {
 
 void makeRgbFile(int width, int height)
 {
@@ -31,22 +28,100 @@ void makeRgbFile(int width, int height)
     }
     fclose(fp);
 }
+
+//RGBPacking of the packed RGB formats, -1 for the YUV ones
+int rgbPacking(uint32_t fourcc)
+{
+    switch (fourcc)
+    {
+    case RAW_FOURCC_RGB24:  return RGB_PACKING_RGB;
+    case RAW_FOURCC_BGR24:  return RGB_PACKING_BGR;
+    case RAW_FOURCC_RGBA:   return RGB_PACKING_RGBA;
+    case RAW_FOURCC_BGRA:   return RGB_PACKING_BGRA;
+    case RAW_FOURCC_RGB565: return RGB_PACKING_RGB565;
+    default:                return -1;
+    }
+}
 }//namespace
 
-RawImageReader::RawImageReader(std::function<int(char **data, ssize_t *bytes, int width, int height)> readRgb888)
+RawImageReader::RawImageReader(ReadRawFrame readFrame)
     : RGB(nullptr)
-    , YUV(nullptr)
     , RgbSz(0)
-    , _rgbreader(new rgbreader(readRgb888))
+    , _fourcc(RAW_FOURCC_RGB24)
+    , _rgbPool(nullptr)
+    , _rgbPoolSz(0)
+    , _rgbreader(new rgbreader(readFrame))
+    , _generation(0)
+    , _threads(0)
+    , _pool(nullptr)
+    , _gbr(false)
+    , _matrix(RGB_MATRIX_BT601_LIMITED)
+    , _blockRowsDone(0)
 {
+    _damage.count = -1;
 }
 
 RawImageReader::~RawImageReader()
 {
-    if(YUV) free(YUV);
+    StopThreadPool();
+    X265_FREE(_rgbPool);
     if(_rgbreader) delete _rgbreader;
 }
 
+bool RawImageReader::StartThreadPool()
+{
+    int threads = std::min(_threads, (int)MAX_POOL_THREADS);
+    int nodes = ThreadPool::getNumaNodeCount();
+    _pool = new ThreadPool();
+    if (!_pool->create(threads, 1, (uint64_t)-1 >> (64 - nodes)))
+    {
+        delete _pool;
+        _pool = nullptr;
+        return false;
+    }
+    //registered the way the encoder registers its frame encoders
+    _idle.m_pool = _pool;
+    _idle.m_jpId = _pool->m_numProviders++;
+    _pool->m_jpTable[_idle.m_jpId] = &_idle;
+    if (!_pool->start())
+    {
+        StopThreadPool();
+        return false;
+    }
+    return true;
+}
+void RawImageReader::StopThreadPool()
+{
+    if (_pool)
+    {
+        _pool->stopWorkers();
+        delete _pool;
+        _pool = nullptr;
+    }
+}
+bool RawImageReader::Open(const char* device, int width, int height, int skipFrames, bool loop, int &frameCount)
+{
+    frameCount = -1;
+    if (strcmp(device, "/dev/screen") == 0)
+    {
+        return true;
+    }
+    if (!_file.Open(device, RawFrameSize(_fourcc, width, height), skipFrames, loop))
+    {
+        return false;
+    }
+    if (!loop)
+    {
+        frameCount = _file.FrameCount();
+    }
+    return true;
+}
+
+bool RawImageReader::SetScaler(int captureWidth, int captureHeight, int width, int height, RgbScaler::Filter filter)
+{
+    return _scaler.Init(captureWidth, captureHeight, width, height, filter);
+}
+
 bool RawImageReader::ReadAsRgb(const char* device, int width, int height)
 {
 //    makeRgbFile(width, height);
@@ -54,7 +129,23 @@ bool RawImageReader::ReadAsRgb(const char* device, int width, int height)
     {
         return false;
     }
-    for(int i = 0; i < RgbSz; i+=BytesPerPixel)
+    if (_frame.fourcc != RAW_FOURCC_RGB24 || _frame.strides[0] != (intptr_t)width * 3)
+    {
+        std::cout << "Device " << device << " is not packed RGB24\n";
+        return false;
+    }
+    RgbSz = (ssize_t)width * height * 3;
+    if (RGB != _rgbPool)
+    {
+        //never swap in place in memory we do not own
+        if (!AllocRgb(RgbSz))
+        {
+            return false;
+        }
+        memcpy(_rgbPool, RGB, RgbSz);
+        RGB = _rgbPool;
+    }
+    for(int i = 0; i < RgbSz; i+=3)
     {
         char tmp = RGB[i];
         RGB[i] = RGB[i+2];
@@ -62,87 +153,344 @@ bool RawImageReader::ReadAsRgb(const char* device, int width, int height)
     }
     return true;
 }
-bool RawImageReader::ReadAsYuv(const char* device, int width, int height)
+bool RawImageReader::ReadAsYuv(const char* device, int width, int height, int csp, char *yuv, ssize_t yuvSz, uint32_t *blockGen)
 {
-    if(!ReadDevice(device, width, height))
+    if (_gbr && csp != X265_CSP_I444)
+    {
+        std::cout << "GBR input requires " << x265_source_csp_names[X265_CSP_I444]
+                  << ", got " << x265_source_csp_names[csp] << "\n";
+        return false;
+    }
+    if (csp < X265_CSP_I400 || csp >= X265_CSP_COUNT)
     {
+        std::cout << "Unsupported color space " << csp << " for device " << device << "\n";
         return false;
     }
+    const x265_cli_csp& layout = x265_cli_csps[csp];
     int frameSize = width * height;
-    int chromasize = frameSize;// / 4;
+    int chromaStride = width >> layout.width[1];
+    int chromaSize = layout.planes > 1 ? chromaStride * (height >> layout.height[1]) : 0;
+    if (yuvSz != frameSize + 2 * chromaSize)
     {
+        std::cout << "Device frame size " << frameSize + 2 * chromaSize
+                  << " does not match input frame size " << yuvSz << "\n";
+        return false;
+    }
+    if (_scaler.Active() && (_scaler.DstWidth() != width || _scaler.DstHeight() != height))
+    {
+        std::cout << "Device " << device << " scales to " << _scaler.DstWidth() << "x" << _scaler.DstHeight()
+                  << ", expected " << width << "x" << height << "\n";
+        return false;
+    }
+    int captureWidth = _scaler.Active() ? _scaler.SrcWidth() : width;
+    int captureHeight = _scaler.Active() ? _scaler.SrcHeight() : height;
+    if(!ReadDevice(device, captureWidth, captureHeight))
+    {
+        return false;
+    }
+    int packing = rgbPacking(_frame.fourcc);
+    bool supported;
+    if (_scaler.Active())
+    {
+        int bpp = RawBytesPerPixel(_frame.fourcc);
+        supported = packing >= 0 && (bpp == 3 || bpp == 4) && (_gbr || primitives.rgb2yuv[packing][csp]);
+    }
+    else if (packing >= 0)
+    {
+        supported = _gbr || primitives.rgb2yuv[packing][csp];
+    }
+    else
+    {
+        supported = !_gbr && (_frame.fourcc == RAW_FOURCC_YUYV ? primitives.yuyv2yuv[csp] != nullptr
+                                                               : csp == X265_CSP_I400 || csp == X265_CSP_I420);
+    }
+    if (!supported)
+    {
+        std::cout << "Cannot " << (_scaler.Active() ? "scale and " : "") << "convert "
+                  << std::string((const char *)&_frame.fourcc, 4) << " from device " << device
+                  << " to " << (_gbr ? "GBR" : x265_source_csp_names[csp]) << "\n";
+        return false;
+    }
 
-        YuvSz = frameSize * 3;
-        YUV = (char*)realloc(YUV, YuvSz);
-        if (!YUV)
-        {
-            std::cout << "Failed to allocate YUV memory for device " << device
-                      << "\n" ;
-            return false;
-        }
-
-        unsigned char *rgb = (unsigned char *)RGB;
-        unsigned char *yuv = (unsigned char *)YUV;
+    TrackDamage(width, height);
 
-        int yIndex = 0;
-        int uIndex = frameSize;
-        int vIndex = frameSize + chromasize;
+    _job.packing = packing;
+    _job.dst = (uint8_t *)yuv;
+    _job.width = width;
+    _job.height = height;
+    _job.csp = csp;
+    _job.chromaStride = chromaStride;
+    _job.chromaSize = chromaSize;
+    _job.blockGen = blockGen;
 
-        int R, G, B, Y, U, V;
-        int index = 0;
-        int rgbIndex = 0;
+    /* strips of one block row each, shared with idle pool workers */
+    int rows = (height + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+    if (_rowsConverted)
+    {
+        _blockRowDone.assign(rows, 0);
+        _blockRowsDone = 0;
+    }
+    if (_threads > 0 && !_pool && rows > 1 && !StartThreadPool())
+    {
+        x265_log(NULL, X265_LOG_WARNING, "unable to start colour conversion threads, converting on the capture thread\n");
+        _threads = 0;
+    }
+    if (_pool && rows > 1)
+    {
+        ConvertGroup strips(*this);
+        strips.m_jobTotal = rows;
+        strips.tryBondPeers(*_pool, rows - 1);
+        strips.processTasks(-1);
+        strips.waitForExit();
+    }
+    else
+    {
+        for (int by = 0; by < rows; by++)
+        {
+            ConvertBlockRow(by);
+            BlockRowDone(by);
+        }
+    }
+    return true;
+}
+void RawImageReader::ConvertGroup::processTasks(int)
+{
+    m_lock.acquire();
+    while (m_jobAcquired < m_jobTotal)
+    {
+        int row = m_jobAcquired++;
+        m_lock.release();
+        _reader.ConvertBlockRow(row);
+        _reader.BlockRowDone(row);
+        m_lock.acquire();
+    }
+    m_lock.release();
+}
+void RawImageReader::ConvertRect(int x, int y, int w, int h)
+{
+    const x265_cli_csp& layout = x265_cli_csps[_job.csp];
+    intptr_t lumaSize = (intptr_t)_job.width * _job.height;
+    intptr_t chromaOffset = (intptr_t)(y >> layout.height[1]) * _job.chromaStride + (x >> layout.width[1]);
+    uint8_t *dstY = _job.dst + (intptr_t)y * _job.width + x;
+    uint8_t *dstU = _job.dst + lumaSize + chromaOffset;
+    uint8_t *dstV = dstU + _job.chromaSize;
+    const uint8_t *src = _frame.planes[0] + y * _frame.strides[0] + x * RawBytesPerPixel(_frame.fourcc);
+    if (_job.packing >= 0 && _scaler.Active())
+    {
+        /* convert a row pair at a time while the scaled pixels are in cache */
+        int group = layout.height[1] + 1;
+        _scaler.Scale(_frame.planes[0], _frame.strides[0], RawBytesPerPixel(_frame.fourcc), x, y, w, h, group,
+                      [&](const uint8_t *rows, intptr_t stride, int rowY, int count)
+        {
+            ConvertRgb(rows, stride, x, rowY, w, count);
+        });
+    }
+    else if (_job.packing >= 0)
+    {
+        ConvertRgb(src, _frame.strides[0], x, y, w, h);
+    }
+    else if (_frame.fourcc == RAW_FOURCC_YUYV)
+    {
+        primitives.yuyv2yuv[_job.csp](src, _frame.strides[0], dstY, _job.width, dstU, dstV, _job.chromaStride, w, h);
+    }
+    else
+    {
+        /* NV12, the luma plane is already in place, only chroma needs splitting */
+        for (int row = 0; row < h; row++)
+        {
+            memcpy(dstY + (intptr_t)row * _job.width, src + row * _frame.strides[0], w);
+        }
+        if (layout.planes > 1)
+        {
+            primitives.uvsplit(_frame.planes[1] + (y >> 1) * _frame.strides[1] + x, _frame.strides[1],
+                               dstU, dstV, _job.chromaStride, w >> 1, h >> 1);
+        }
+    }
+}
+void RawImageReader::SetMatrix(int matrixCoeffs, bool fullRange)
+{
+    bool bt709 = matrixCoeffs == 1;
+    //2 is unspecified, 5 and 6 are BT.601 625 and 525 lines
+    if (!bt709 && matrixCoeffs != 2 && matrixCoeffs != 5 && matrixCoeffs != 6)
+    {
+        x265_log(NULL, X265_LOG_WARNING, "no RGB conversion for matrix coefficients %d, converting with BT.601\n", matrixCoeffs);
+    }
+    if (bt709)
+    {
+        _matrix = fullRange ? RGB_MATRIX_BT709_FULL : RGB_MATRIX_BT709_LIMITED;
+    }
+    else
+    {
+        _matrix = fullRange ? RGB_MATRIX_BT601_FULL : RGB_MATRIX_BT601_LIMITED;
+    }
+}
+void RawImageReader::ConvertRgb(const uint8_t *src, intptr_t srcStride, int x, int y, int w, int h)
+{
+    const x265_cli_csp& layout = x265_cli_csps[_job.csp];
+    intptr_t chromaOffset = (intptr_t)(y >> layout.height[1]) * _job.chromaStride + (x >> layout.width[1]);
+    uint8_t *dstY = _job.dst + (intptr_t)y * _job.width + x;
+    uint8_t *dstU = _job.dst + (intptr_t)_job.width * _job.height + chromaOffset;
+    uint8_t *dstV = dstU + _job.chromaSize;
+    if (_gbr)
+    {
+        /* 4:4:4, the chroma planes share the luma layout */
+        primitives.rgb2gbr[_job.packing](src, srcStride, dstY, dstU, dstV, _job.width, w, h);
+    }
+    else
+    {
+        primitives.rgb2yuv[_job.packing][_job.csp](src, srcStride, dstY, _job.width, dstU, dstV,
+                                                   _job.chromaStride, w, h, &g_rgbToYuvCoeffs[_matrix]);
+    }
+}
+void RawImageReader::ConvertBlockRow(int by)
+{
+    int y = by * DAMAGE_BLOCK;
+    int h = std::min((int)DAMAGE_BLOCK, _job.height - y);
+    if (!_job.blockGen)
+    {
+        ConvertRect(0, y, _job.width, h);
+        return;
+    }
 
-        for (int j = 0; j < height; j++)
+    /* convert runs of stale blocks */
+    int cols = (_job.width + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+    const uint32_t *cur = &_blockGen[by * cols];
+    uint32_t *have = _job.blockGen + by * cols;
+    for (int bx = 0; bx < cols;)
+    {
+        if (have[bx] == cur[bx])
         {
-            for (int i = 0; i < width; i++)
+            bx++;
+            continue;
+        }
+        int end = bx;
+        while (end < cols && have[end] != cur[end])
+        {
+            have[end] = cur[end];
+            end++;
+        }
+        int x = bx * DAMAGE_BLOCK;
+        ConvertRect(x, y, std::min(end * DAMAGE_BLOCK, _job.width) - x, h);
+        bx = end;
+    }
+}
+//strips finish out of order, report the rows above the first unfinished one
+void RawImageReader::BlockRowDone(int blockRow)
+{
+    if (!_rowsConverted)
+    {
+        return;
+    }
+    X265_NS::ScopedLock lock(_progressLock);
+    _blockRowDone[blockRow] = 1;
+    int done = _blockRowsDone;
+    while (_blockRowsDone < (int)_blockRowDone.size() && _blockRowDone[_blockRowsDone])
+    {
+        _blockRowsDone++;
+    }
+    if (_blockRowsDone != done)
+    {
+        _rowsConverted(std::min(_blockRowsDone * (int)DAMAGE_BLOCK, _job.height));
+    }
+}
+void RawImageReader::TrackDamage(int width, int height)
+{
+    int cols = (width + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+    int rows = (height + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+    _generation++;
+    //more rects than fit were left out, only a full conversion is safe
+    if (_damage.count < 0 || _damage.count > (int)RgbDamage::MAX_RECTS || _blockGen.size() != (size_t)cols * rows)
+    {
+        _blockGen.assign((size_t)cols * rows, _generation);
+        return;
+    }
+    for (int i = 0; i < _damage.count; i++)
+    {
+        const RgbDirtyRect &r = _damage.rects[i];
+        int left = std::max(r.x, 0), right = r.x + r.width;
+        int top = std::max(r.y, 0), bottom = r.y + r.height;
+        if (_scaler.Active())
+        {
+            //rects are in capture coordinates, mark every output pixel they feed
+            _scaler.OutputColumns(left, right, left, right);
+            _scaler.OutputRows(top, bottom, top, bottom);
+        }
+        int x0 = left / DAMAGE_BLOCK;
+        int y0 = top / DAMAGE_BLOCK;
+        int x1 = (std::min(right, width) + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+        int y1 = (std::min(bottom, height) + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK;
+        for (int by = y0; by < y1; by++)
+        {
+            for (int bx = x0; bx < x1; bx++)
             {
-                R = rgb[rgbIndex++];
-                G = rgb[rgbIndex++];
-                B = rgb[rgbIndex++];
-
-                Y = ((66 * R + 129 * G + 25 * B + 128) >> 8) + 16;
-                U = ((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128;
-                V = ((112 * R - 94 * G - 18 * B + 128) >> 8) + 128;
-
-                yuv[yIndex++] = (unsigned char)clamp(Y, 0, 255);
-                yuv[uIndex++] = (unsigned char)clamp(U, 0, 255);
-                yuv[vIndex++] = (unsigned char)clamp(V, 0, 255);
-
-                index++;
+                _blockGen[by * cols + bx] = _generation;
             }
         }
     }
-    return true;
 }
-bool RawImageReader::ReadFromFile(const char *filename, int width, int height)
+bool RawImageReader::AllocRgb(ssize_t bytes)
 {
-    FILE* fp = fopen(filename, "rb");
-    if (!fp)
+    if (bytes > _rgbPoolSz)
     {
-        std::cout << "Failed to open device " << filename << "\n" ;
-        return false;
+        X265_FREE(_rgbPool);
+        _rgbPool = X265_MALLOC(char, bytes);
+        _rgbPoolSz = _rgbPool ? bytes : 0;
     }
-
-    BytesPerPixel = 3;//get from ioctl device
-    RgbSz = width * height * BytesPerPixel;
-
-    RGB = (char*)realloc(RGB, RgbSz);
-    if (!RGB)
+    return _rgbPool != nullptr;
+}
+bool RawImageReader::ReadFromFile(const char *filename, int width, int height)
+{
+    if (!_file.IsOpen())
     {
-        std::cout << "Failed to allocate memory for device " << filename
-                  << "\n" ;
-        return false;
+        int frameCount;
+        if (!Open(filename, width, height, 0, false, frameCount))
+        {
+            return false;
+        }
     }
 
-    fread(RGB, RgbSz, 1, fp);
-    fclose(fp);
-    return true;
+    RGB = _file.NextFrame();
+    RgbSz = RawFrameSize(_fourcc, width, height);
+    RawFrameLayout(_frame, _fourcc, width, height, RGB, RgbSz);
+    _damage.count = -1;
+    return RGB != nullptr;
 }
 
 bool RawImageReader::ReadDevice(const char *device, int width, int height)
 {
-    BytesPerPixel = 3;
-    return (strcmp(device, "/dev/screen") == 0) ?
-                _rgbreader->readImage(&RGB, &RgbSz, width, height) :
-                ReadFromFile(device, width, height);
+    if (strcmp(device, "/dev/screen") != 0)
+    {
+        return ReadFromFile(device, width, height);
+    }
+
+    /* lend the capture callback the pooled buffer laid out in the format we
+     * ask for, it may still hand back memory of its own in any format */
+    if (!AllocRgb(RawFrameSize(_fourcc, width, height)))
+    {
+        std::cout << "Failed to allocate memory for device " << device << "\n" ;
+        return false;
+    }
+    RawFrameLayout(_frame, _fourcc, width, height, _rgbPool, _rgbPoolSz);
+    if (!_rgbreader->readImage(&_frame, &_damage))
+    {
+        return false;
+    }
+    int bpp = RawBytesPerPixel(_frame.fourcc);
+    ssize_t planeBytes = (ssize_t)_frame.strides[0] * (height - 1) + (ssize_t)width * bpp;
+    if (!bpp || !_frame.planes[0] || _frame.strides[0] < (intptr_t)width * bpp || _frame.bytes < planeBytes ||
+        (_frame.fourcc == RAW_FOURCC_NV12 && (!_frame.planes[1] || _frame.strides[1] < ((width + 1) & ~1))))
+    {
+        std::cout << "Device " << device << " returned an invalid " << std::string((const char *)&_frame.fourcc, 4)
+                  << " frame of " << _frame.bytes << " bytes\n" ;
+        return false;
+    }
+    if (_frame.width != width || _frame.height != height)
+    {
+        std::cout << "Device " << device << " returned a " << _frame.width << "x" << _frame.height
+                  << " frame, expected " << width << "x" << height << "\n" ;
+        return false;
+    }
+    RGB = (char *)_frame.planes[0];
+    RgbSz = _frame.bytes;
+    return true;
 }
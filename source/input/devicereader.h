@@ -2,23 +2,104 @@
 
 #include <functional>
 #include <string>
+#include <vector>
+
+#include "rgbfile.h"
+#include "rgbreader.h"
+#include "rgbscaler.h"
+#include "threadpool.h"
 
-class rgbreader;
 class RawImageReader
 {
 public:
-    RawImageReader(std::function<int(char **data, ssize_t *bytes, int width, int height)> readRgb888);
+    enum { DAMAGE_BLOCK = 16 };//change tracking granularity, as x265_picture.changeMap
+
+    RawImageReader(ReadRawFrame readFrame);
     ~RawImageReader();
+    //maps a raw RGB file, frameCount is -1 for live devices and looped files
+    bool Open(const char* device, int width, int height, int skipFrames, bool loop, int &frameCount);
     bool ReadAsRgb(const char* device, int width, int height);
-    bool ReadAsYuv(const char* device, int width, int height);
+    /* converts one frame into the caller's planar buffer of yuvSz bytes. When
+     * blockGen is given it holds, for each DAMAGE_BLOCK square of the buffer,
+     * the generation of the source it was last converted from. Only stale
+     * blocks are converted and blockGen is brought up to date */
+    bool ReadAsYuv(const char* device, int width, int height, int csp, char *yuv, ssize_t yuvSz, uint32_t *blockGen);
+    static int DamageBlocks(int width, int height) { return ((width + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK) * ((height + DAMAGE_BLOCK - 1) / DAMAGE_BLOCK); }
+    /* workers of a pool of threads, started by the first conversion, help
+     * convert. 0 converts on the calling thread. The pool is the reader's
+     * own and competes with the encoder's for the cores, so it is only
+     * there when asked for */
+    void SetThreads(int threads) { _threads = threads; }
+    /* called during ReadAsYuv each time the rows converted from the top of
+     * the frame grow, with their count, possibly from pool workers */
+    void SetRowsConverted(std::function<void (int rows)> rowsConverted) { _rowsConverted = rowsConverted; }
+    //de-interleave straight into G, B, R planes (matrix_coefficients 0) instead of converting to YUV, needs 4:4:4
+    void SetGbr(bool gbr) { _gbr = gbr; }
+    /* RGB to YUV with the matrix and range the VUI signals, BT.601 when
+     * unspecified. Matrices without a conversion table warn and use BT.601 */
+    void SetMatrix(int matrixCoeffs, bool fullRange);
+    //format asked of the capture callback and expected in files, a RawFourcc
+    void SetFormat(uint32_t fourcc) { _fourcc = fourcc; }
+    /* frames are captured (and files laid out) at captureWidth x captureHeight
+     * and scaled to the width and height ReadAsYuv is asked for, which must
+     * match width and height here. Needs 8bit packed RGB */
+    bool SetScaler(int captureWidth, int captureHeight, int width, int height, RgbScaler::Filter filter);
 
-    char *RGB;
-    char *YUV;
+    char *RGB;//planes[0] of the last frame read
     ssize_t RgbSz;
-    ssize_t YuvSz;
 protected:
     bool ReadDevice(const char* device, int width, int height);
     bool ReadFromFile(const char *filename, int width, int height);
-    int BytesPerPixel = 3;//get from ioctl device
+    bool AllocRgb(ssize_t bytes);
+    void TrackDamage(int width, int height);
+    void ConvertRect(int x, int y, int w, int h);
+    void ConvertRgb(const uint8_t *src, intptr_t srcStride, int x, int y, int w, int h);
+    void ConvertBlockRow(int blockRow);
+    void BlockRowDone(int blockRow);
+    bool StartThreadPool();
+    void StopThreadPool();
+
+    //the pool's workers only ever run bonded strips, but they need a provider
+    class IdleProvider : public X265_NS::JobProvider
+    {
+    public:
+        void findJob(int) override {}
+    };
+
+    class ConvertGroup : public X265_NS::BondedTaskGroup
+    {
+    public:
+        ConvertGroup(RawImageReader &reader) : _reader(reader) {}
+        void processTasks(int workerThreadID);
+    protected:
+        RawImageReader &_reader;
+    };
+
+    uint32_t _fourcc;
+    RawFrame _frame;//the last frame read
+    char *_rgbPool;//aligned, reused for every frame
+    ssize_t _rgbPoolSz;
+    RgbFileSource _file;
     rgbreader *_rgbreader;
+    RgbDamage _damage;//what changed in the last frame read
+    std::vector<uint32_t> _blockGen;//generation each block last changed in
+    uint32_t _generation;
+    int _threads;
+    X265_NS::ThreadPool *_pool;
+    IdleProvider _idle;
+    bool _gbr;
+    int _matrix;//RGBMatrix
+    RgbScaler _scaler;
+    std::function<void (int rows)> _rowsConverted;
+    X265_NS::Lock _progressLock;
+    std::vector<char> _blockRowDone;//of the frame being converted
+    int _blockRowsDone;//leading block rows converted
+    struct ConvertJob//the frame being converted
+    {
+        int packing;//RGBPacking of RGB formats, -1 for YUV
+        uint8_t *dst;
+        int width, height, csp;
+        int chromaStride, chromaSize;
+        uint32_t *blockGen;
+    } _job;
 };
@@ -4,23 +4,193 @@
 #include <stdio.h>
 #include <string.h>
 
+using namespace X265_NS;
+
 FrameQueue::FrameQueue()
-    : Buffer(nullptr)
-    , Bytes(0)
+    : _buffer(nullptr)
+    , _stamps(nullptr)
+    , _ring(nullptr)
+    , _free(nullptr)
+    , _slotBytes(0)
+    , _slots(0)
+    , _bDropOldest(false)
+    , _tail(0)
+    , _freeHead(0)
+    , _dropped(0)
+    , _producerWaiting(false)
+    , _writing(-1)
+    , _spare(-1)
+    , _head(0)
+    , _freeTail(0)
+    , _popped(0)
+    , _consumerWaiting(false)
+    , _reading(-1)
+    , _closed(false)
 {}
 FrameQueue::~FrameQueue()
 {
-    if(Buffer) { free(Buffer); }
+    X265_FREE(_buffer);
+    X265_FREE(_stamps);
+    delete[] _ring;
+    delete[] _free;
+}
+bool FrameQueue::Init(int slots, size_t slotBytes, bool bDropOldest)
+{
+    X265_FREE(_buffer);
+    X265_FREE(_stamps);
+    delete[] _ring;
+    delete[] _free;
+
+    _slots = slots;
+    _slotBytes = (slotBytes + CACHELINE - 1) & ~(size_t)(CACHELINE - 1);
+    _bDropOldest = bDropOldest;
+    _buffer = X265_MALLOC(char, _slotBytes * Buffers());
+    _stamps = X265_MALLOC(int64_t, Buffers());
+    _ring = new std::atomic<int>[slots];
+    _free = new std::atomic<int>[Buffers()];
+    if (_buffer)
+        memset(_buffer, 0, _slotBytes * Buffers());//callers may keep state in their slots
+
+    /* every buffer starts out free */
+    for (int i = 0; i < Buffers(); i++)
+        _free[i] = i;
+    _freeHead = 0;
+    _freeTail = Buffers();
+    _tail = 0;
+    _head = 0;
+    _writing = _spare = _reading = -1;
+    _dropped = 0;
+    _popped = 0;
+    _closed = false;
+    return _buffer && _stamps;
+}
+void FrameQueue::Close()
+{
+    _closed = true;
+    _readable.trigger();
+    _writable.trigger();
+}
+bool FrameQueue::CanWrite() const
+{
+    return _tail.load() - _head.load() < (uint64_t)_slots && (_spare >= 0 || _freeHead.load() != _freeTail.load());
+}
+bool FrameQueue::Wait(std::atomic<bool>& waiting, Event& event, bool (FrameQueue::*ready)() const)
+{
+    /* the other side only signals once it sees the flag, so look at the ring
+     * again after raising it: whatever it published before that shows here */
+    waiting = true;
+    if (!_closed && !(this->*ready)())
+        event.wait();
+    waiting = false;
+    return !_closed;
+}
+char* FrameQueue::AcquireWrite(bool bBlock)
+{
+    if (_writing >= 0)
+        return Buffer(_writing);
+    for (;;)
+    {
+        if (_closed)
+            return nullptr;
+
+        uint64_t head = _head.load();
+        if (_tail.load(std::memory_order_relaxed) - head >= (uint64_t)_slots)
+        {
+            /* the consumer may claim the frame first, either way room frees up */
+            if (_bDropOldest)
+            {
+                int id = _ring[head % _slots];
+                if (_head.compare_exchange_strong(head, head + 1))
+                {
+                    _spare = id;
+                    _dropped++;
+                }
+                continue;
+            }
+        }
+        else if (_spare >= 0)
+        {
+            _writing = _spare;
+            _spare = -1;
+            return Buffer(_writing);
+        }
+        else if (_freeHead.load(std::memory_order_relaxed) != _freeTail.load())
+        {
+            uint64_t freeHead = _freeHead.load(std::memory_order_relaxed);
+            _writing = _free[freeHead % Buffers()];
+            _freeHead = freeHead + 1;
+            return Buffer(_writing);
+        }
+        if (!bBlock || !Wait(_producerWaiting, _writable, &FrameQueue::CanWrite))
+            return nullptr;
+    }
+}
+void FrameQueue::CommitWrite(int64_t stamp)
+{
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    _stamps[_writing] = stamp;
+    _ring[tail % _slots] = _writing;
+    _writing = -1;
+    _tail = tail + 1;
+    if (_consumerWaiting)
+        _readable.trigger();
+}
+bool FrameQueue::Push(const char* data, size_t sz, bool bBlock)
+{
+    char* slot = AcquireWrite(bBlock);
+    if (!slot)
+        return false;
+    memcpy(slot, data, sz < _slotBytes ? sz : _slotBytes);
+    CommitWrite();
+    return true;
+}
+char* FrameQueue::AcquireRead(bool bBlock)
+{
+    if (_reading >= 0)
+        return Buffer(_reading);
+    for (;;)
+    {
+        uint64_t head = _head.load();
+        if (head != _tail.load())
+        {
+            /* the id is only ours if the claim wins against a dropping producer */
+            int id = _ring[head % _slots];
+            if (_head.compare_exchange_strong(head, head + 1))
+            {
+                _reading = id;
+                if (_producerWaiting)
+                    _writable.trigger();
+                return Buffer(id);
+            }
+            continue;
+        }
+        if (!bBlock || !Wait(_consumerWaiting, _readable, &FrameQueue::CanRead))
+        {
+            /* frames committed just before Close() are still returned */
+            if (_closed && _head.load() != _tail.load())
+                continue;
+            return nullptr;
+        }
+    }
 }
-void FrameQueue::Push(char* data, size_t sz)
+void FrameQueue::ReleaseRead()
 {
-    Buffer = (char*)realloc(Buffer, Bytes + sz);
-    memcpy(Buffer + Bytes, data, sz);
-    Bytes += sz;
+    if (_reading < 0)
+        return;
+    uint64_t freeTail = _freeTail.load(std::memory_order_relaxed);
+    _free[freeTail % Buffers()] = _reading;
+    _freeTail = freeTail + 1;
+    _reading = -1;
+    _popped++;
+    if (_producerWaiting)
+        _writable.trigger();
 }
-void FrameQueue::Pop(char* data, size_t sz)
+bool FrameQueue::Pop(char* data, size_t sz, bool bBlock)
 {
-    memcpy(data, Buffer, sz);
-    memmove(Buffer, Buffer + sz, Bytes - sz);
-    Bytes -= sz;
+    char* slot = AcquireRead(bBlock);
+    if (!slot)
+        return false;
+    memcpy(data, slot, sz < _slotBytes ? sz : _slotBytes);
+    ReleaseRead();
+    return true;
 }
@@ -1,15 +1,88 @@
 #pragma once
 
-#include <memory>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
 
+#include "common.h"
+#include "threading.h"
+
+/* Fixed capacity single producer, single consumer queue of frame buffers.
+ * Frames are written and read in place and neither side takes a lock: the
+ * queue passes buffer ids through a ring, and read buffers come back to the
+ * producer through a second ring. A side that blocks sleeps on an event
+ * which the other side only signals while someone waits. A full queue
+ * either makes the producer wait or, with bDropOldest, lets it take back
+ * the oldest unread frame */
 class FrameQueue
 {
 public:
     FrameQueue();
     ~FrameQueue();
-    void Push(char* data, size_t sz);
-    void Pop(char* data, size_t sz);
+    bool Init(int slots, size_t slotBytes, bool bDropOldest);
+    //wakes both sides, AcquireRead drains the remaining frames first
+    void Close();
+
+    //producer
+    char* AcquireWrite(bool bBlock);
+    void CommitWrite(int64_t stamp = 0);
+    bool Push(const char* data, size_t sz, bool bBlock);
+
+    //consumer, a buffer stays valid until it is released
+    char* AcquireRead(bool bBlock);
+    int64_t ReadStamp() const { return _stamps[_reading]; } //of the acquired buffer
+    void ReleaseRead();
+    bool Pop(char* data, size_t sz, bool bBlock);
+
+    int Capacity() const     { return _slots; }
+    int Occupancy() const    { uint64_t head = _head.load(); return (int)(_tail.load() - head); }
+    uint64_t Pushed() const  { return _tail.load(); }
+    uint64_t Popped() const  { return _popped.load(); }
+    uint64_t Dropped() const { return _dropped.load(); }
+
 protected:
-    char* Buffer;
-    size_t Bytes;
+    enum { CACHELINE = 64 };
+
+    /* one buffer is being written and one read besides the queued ones */
+    int Buffers() const { return _slots + 2; }
+    char* Buffer(int id) const { return _buffer + id * _slotBytes; }
+    bool CanWrite() const;
+    bool CanRead() const { return _head.load() != _tail.load(); }
+    bool Wait(std::atomic<bool>& waiting, X265_NS::Event& event, bool (FrameQueue::*ready)() const);
+
+    char* _buffer;
+    int64_t* _stamps;
+    std::atomic<int>* _ring; //queued buffer ids, oldest at _head
+    std::atomic<int>* _free; //read buffers handed back to the producer
+    size_t _slotBytes;
+    int _slots;
+    bool _bDropOldest;
+
+    /* the padding keeps each side's indices off the other side's cache
+     * lines without needing an over-aligned allocation */
+    char _pad0[CACHELINE];
+
+    //producer owned
+    std::atomic<uint64_t> _tail;
+    std::atomic<uint64_t> _freeHead;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<bool> _producerWaiting;
+    int _writing; //buffer id being filled, or -1
+    int _spare;   //buffer taken back from a dropped frame, or -1
+    char _pad1[CACHELINE];
+
+    //claimed by the consumer, or by the producer when it drops a frame
+    std::atomic<uint64_t> _head;
+    char _pad2[CACHELINE];
+
+    //consumer owned
+    std::atomic<uint64_t> _freeTail;
+    std::atomic<uint64_t> _popped;
+    std::atomic<bool> _consumerWaiting;
+    int _reading; //buffer id lent to the reader, or -1
+    char _pad3[CACHELINE];
+
+    std::atomic<bool> _closed;
+    X265_NS::Event _readable;
+    X265_NS::Event _writable;
 };
@@ -87,6 +87,9 @@ public:
     virtual int getWidth() const = 0;
 
     virtual int getHeight() const = 0;
+
+    /* live inputs are paced by the wall clock and set pic.pts themselves */
+    virtual bool isLive() const { return false; }
 };
 }
 
@@ -1,9 +1,13 @@
 #include "reader.h"
 #include "devicereader.h"
-#include "frameq.h"
 
-Reader::Reader(std::function<int(char **data, ssize_t *bytes, int width, int height)> readRgb888)
-    : _readRgb888(readRgb888)
+Reader::Reader(ReadRawFrame readFrame)
+    : _readFrame(readFrame)
+    , _rawReader(new RawImageReader(readFrame))
+{
+}
+
+Reader::~Reader()
 {
 }
 
@@ -49,14 +53,65 @@ bool Reader::ParseDevicesFromCommandLine(int argc, char** argv)
     return true;
 }
 
-bool Reader::ReadYuvFrame(char *frame, uint32_t framesz, int width, int height)
+bool Reader::ParseCapturePolicy(const char *name, CapturePolicy &policy)
+{
+    if(strcmp(name, "drop-oldest") == 0) policy = CAPTURE_DROP_OLDEST;
+    else if(strcmp(name, "drop-newest") == 0) policy = CAPTURE_DROP_NEWEST;
+    else if(strcmp(name, "duplicate") == 0) policy = CAPTURE_DUPLICATE;
+    else return false;
+    return true;
+}
+
+bool Reader::ParseFormat(const char *name, uint32_t &fourcc)
+{
+    if(strcmp(name, "rgb") == 0) fourcc = RAW_FOURCC_RGB24;
+    else if(strcmp(name, "bgr") == 0) fourcc = RAW_FOURCC_BGR24;
+    else if(strcmp(name, "rgba") == 0) fourcc = RAW_FOURCC_RGBA;
+    else if(strcmp(name, "bgra") == 0) fourcc = RAW_FOURCC_BGRA;
+    else if(strcmp(name, "rgb565") == 0) fourcc = RAW_FOURCC_RGB565;
+    else if(strcmp(name, "nv12") == 0) fourcc = RAW_FOURCC_NV12;
+    else if(strcmp(name, "yuyv") == 0) fourcc = RAW_FOURCC_YUYV;
+    else return false;
+    return true;
+}
+
+bool Reader::Open(int width, int height, int skipFrames, int &frameCount)
+{
+    _rawReader->SetGbr(args.Gbr);
+    if (!args.Gbr)
+    {
+        _rawReader->SetMatrix(args.MatrixCoeffs, args.FullRange);
+    }
+    _rawReader->SetFormat(args.Format);
+    _rawReader->SetThreads(args.Threads);
+    if (args.CaptureWidth > 0 && args.CaptureHeight > 0)
+    {
+        if (!_rawReader->SetScaler(args.CaptureWidth, args.CaptureHeight, width, height, args.ScaleFilter))
+        {
+            return false;
+        }
+        width = args.CaptureWidth;
+        height = args.CaptureHeight;
+    }
+    return _rawReader->Open(args.device.Name.c_str(), width, height, skipFrames, args.Loop, frameCount);
+}
+
+int Reader::DamageBlocks(int width, int height)
+{
+    return RawImageReader::DamageBlocks(width, height);
+}
+
+void Reader::SetRowsConverted(std::function<void (int rows)> rowsConverted)
+{
+    _rawReader->SetRowsConverted(rowsConverted);
+}
+
+bool Reader::ReadYuvFrame(char *frame, uint32_t framesz, int width, int height, int csp, uint32_t *blockGen)
 {
-    RawImageReader reader(_readRgb888);
-    if(!reader.ReadAsYuv(args.device.Name.c_str(), width, height))
+    if(!_rawReader->ReadAsYuv(args.device.Name.c_str(), width, height, csp, frame, framesz, blockGen))
     {
         std::cout << "Failed to read device\n";
         return false;
     }
-    memcpy(frame, reader.YUV, framesz);
     return true;
 }
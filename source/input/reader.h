@@ -6,12 +6,27 @@
 #include <string.h>
 #include <vector>
 
-#include "frameq.h"
+#include "rgbreader.h"
+#include "rgbscaler.h"
 
+namespace X265_NS { class ThreadPool; }
+class RawImageReader;
 class Reader
 {
 public:
-    Reader(std::function<int(char **data, ssize_t *bytes, int width, int height)> _readRgb888);
+    /* what live capture does when the encoder falls behind the clock */
+    enum CapturePolicy
+    {
+        CAPTURE_DROP_OLDEST, //replace the oldest queued frame
+        CAPTURE_DROP_NEWEST, //skip sampling until a slot frees up
+        CAPTURE_DUPLICATE,   //wait for a slot, fill missed ticks with the last frame while there is room
+    };
+    static bool ParseCapturePolicy(const char *name, CapturePolicy &policy);
+    //rgb, bgr, rgba, bgra, rgb565, nv12 or yuyv to a RawFourcc
+    static bool ParseFormat(const char *name, uint32_t &fourcc);
+
+    Reader(ReadRawFrame readFrame);
+    ~Reader();
 
     struct Device {
         std::string Name;
@@ -22,12 +37,31 @@ public:
         Device device;
         std::string Fps;
         int Quality = 80;
+        bool Loop = false;
+        CapturePolicy Policy = CAPTURE_DROP_OLDEST;
+        bool Gbr = false;//planes hold G, B, R for matrix_coefficients 0
+        int MatrixCoeffs = 2;//VUI matrix_coefficients and range RGB is converted to YUV with
+        bool FullRange = false;
+        uint32_t Format = RAW_FOURCC_RGB24;//asked of the capture callback, layout of raw files
+        int CaptureWidth = 0;//when set frames are captured at this size and scaled to the encode size
+        int CaptureHeight = 0;
+        RgbScaler::Filter ScaleFilter = RgbScaler::FILTER_BICUBIC;
+        int Threads = 0;//workers of a pool of the reader sharing the colour conversion, --reader-threads
+        bool Progressive = false;//live frames go to the encoder while they are converted
     };
 
     bool ParseDevicesFromCommandLine(int argc, char** argv);
-    bool ReadYuvFrame(char *frame, uint32_t framesz, int width, int height);
+    bool Open(int width, int height, int skipFrames, int &frameCount);
+    bool IsLive() const { return args.device.Name == "/dev/screen"; }
+    /* blockGen, when given, tracks what the frame buffer holds so only blocks
+     * the source reported changed are converted, see RawImageReader */
+    bool ReadYuvFrame(char *frame, uint32_t framesz, int width, int height, int csp, uint32_t *blockGen = nullptr);
+    static int DamageBlocks(int width, int height);
+    //reports the luma rows ReadYuvFrame has converted so far, see RawImageReader
+    void SetRowsConverted(std::function<void (int rows)> rowsConverted);
 
-    FrameQueue queue;
     CommandLineArs args;
-    std::function<int(char **data, ssize_t *bytes, int width, int height)> _readRgb888;
+    ReadRawFrame _readFrame;
+protected:
+    std::unique_ptr<RawImageReader> _rawReader;//long lived, keeps its buffers between frames
 };
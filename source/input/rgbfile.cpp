@@ -0,0 +1,150 @@
+#include "rgbfile.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+RgbFileSource::RgbFileSource()
+    : _map(nullptr)
+    , _mapSz(0)
+    , _frameBytes(0)
+    , _frameCount(0)
+    , _nextFrame(0)
+    , _loop(false)
+    , _threadActive(false)
+{
+}
+
+RgbFileSource::~RgbFileSource()
+{
+    Close();
+}
+
+bool RgbFileSource::Open(const char *filename, ssize_t frameBytes, int skipFrames, bool loop)
+{
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "Failed to open device " << filename << "\n" ;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < frameBytes)
+    {
+        std::cout << "Device " << filename << " holds less than one " << frameBytes << " byte frame\n" ;
+        close(fd);
+        return false;
+    }
+
+    _frameBytes = frameBytes;
+    _frameCount = (int)(st.st_size / frameBytes);
+    _mapSz = (size_t)_frameCount * frameBytes;
+    void *map = mmap(NULL, _mapSz, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cout << "Failed to map device " << filename << "\n" ;
+        return false;
+    }
+    _map = (char*)map;
+    madvise(_map, _mapSz, MADV_SEQUENTIAL);
+
+    _loop = loop;
+    _nextFrame = _loop ? skipFrames % _frameCount : skipFrames;
+    if (_nextFrame >= _frameCount)
+    {
+        std::cout << "Cannot seek to frame " << skipFrames << " of " << _frameCount << " in " << filename << "\n" ;
+        Close();
+        return false;
+    }
+
+    _prefetchFrame.set(_nextFrame);
+    _threadActive = true;
+    if (!start())
+        _threadActive = false;
+    return true;
+}
+
+void RgbFileSource::Close()
+{
+    if (_threadActive)
+    {
+        _threadActive = false;
+        _prefetchFrame.poke();
+        stop();
+    }
+    if (_map)
+    {
+        munmap(_map, _mapSz);
+        _map = nullptr;
+    }
+    _mapSz = 0;
+    _frameCount = 0;
+}
+
+char *RgbFileSource::NextFrame()
+{
+    if (!_map)
+        return nullptr;
+    if (_nextFrame >= _frameCount)
+    {
+        if (!_loop)
+            return nullptr;
+        _nextFrame = 0;
+    }
+
+    char *frame = _map + (size_t)_nextFrame * _frameBytes;
+    _nextFrame++;
+    if (_threadActive)
+        _prefetchFrame.set(_nextFrame);
+    else
+        madvise(frame, _frameBytes, MADV_WILLNEED);
+    return frame;
+}
+
+void RgbFileSource::Prefetch(int frame)
+{
+    static const long pageSize = sysconf(_SC_PAGESIZE);
+
+    for (int i = 0; i < PREFETCH_FRAMES; i++, frame++)
+    {
+        if (frame >= _frameCount)
+        {
+            if (!_loop)
+                return;
+            frame = 0;
+        }
+        char *start = _map + (size_t)frame * _frameBytes;
+        char *end = start + _frameBytes;
+        char *page = (char*)((uintptr_t)start & ~(uintptr_t)(pageSize - 1));
+        madvise(page, end - page, MADV_WILLNEED);
+
+        /* touch every page so the faults are taken here rather than in the
+         * conversion */
+        volatile char sink = 0;
+        for (char *p = start; p < end; p += pageSize)
+            sink += *p;
+        (void)sink;
+    }
+}
+
+void RgbFileSource::threadMain()
+{
+    THREAD_NAME("RgbPrefetch", 0);
+    int frame = -1;
+    while (_threadActive)
+    {
+        int next = _prefetchFrame.get();
+        if (next == frame)
+        {
+            _prefetchFrame.waitForChange(frame);
+            continue;
+        }
+        frame = next;
+        Prefetch(frame);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include "common.h"
+#include "threading.h"
+
+/* Memory mapped raw RGB clip, walked one frame at a time. A helper thread
+ * keeps the next few frames resident so the reader never waits on page
+ * faults */
+class RgbFileSource : public X265_NS::Thread
+{
+public:
+    RgbFileSource();
+    ~RgbFileSource();
+    bool Open(const char *filename, ssize_t frameBytes, int skipFrames, bool loop);
+    void Close();
+    //returns nullptr once the last frame was read and looping is off
+    char *NextFrame();
+
+    int FrameCount() const { return _frameCount; }
+    bool IsOpen() const { return _map != nullptr; }
+
+protected:
+    void threadMain();
+    void Prefetch(int frame);
+
+    enum { PREFETCH_FRAMES = 2 };
+
+    char *_map;
+    size_t _mapSz;
+    ssize_t _frameBytes;
+    int _frameCount;
+    int _nextFrame;
+    bool _loop;
+    bool _threadActive;
+    X265_NS::ThreadSafeInteger _prefetchFrame;
+};
@@ -1,12 +1,83 @@
 #include "rgbreader.h"
 
-rgbreader::rgbreader(std::function<int(char **rgb, ssize_t *bytes, int width, int height)> readRgb888)
-    : _readRgb888(readRgb888)
+int RawBytesPerPixel(uint32_t fourcc)
+{
+    switch (fourcc)
+    {
+    case RAW_FOURCC_RGB24:
+    case RAW_FOURCC_BGR24:
+        return 3;
+    case RAW_FOURCC_RGBA:
+    case RAW_FOURCC_BGRA:
+        return 4;
+    case RAW_FOURCC_RGB565:
+    case RAW_FOURCC_YUYV:
+        return 2;
+    case RAW_FOURCC_NV12:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+ssize_t RawFrameSize(uint32_t fourcc, int width, int height)
+{
+    ssize_t size = (ssize_t)width * height * RawBytesPerPixel(fourcc);
+    if (fourcc == RAW_FOURCC_NV12)
+    {
+        size += (ssize_t)((width + 1) & ~1) * ((height + 1) >> 1);
+    }
+    return size;
+}
+
+void RawFrameLayout(RawFrame &frame, uint32_t fourcc, int width, int height, char *buffer, ssize_t bytes)
+{
+    frame.fourcc = fourcc;
+    frame.width = width;
+    frame.height = height;
+    frame.planes[0] = (uint8_t *)buffer;
+    frame.strides[0] = (intptr_t)width * RawBytesPerPixel(fourcc);
+    frame.planes[1] = nullptr;
+    frame.strides[1] = 0;
+    frame.bytes = bytes;
+    if (fourcc == RAW_FOURCC_NV12)
+    {
+        frame.planes[1] = frame.planes[0] + (intptr_t)width * height;
+        frame.strides[1] = (width + 1) & ~1;
+    }
+}
+
+ReadRawFrame ReadRawFrameFromRgb888(ReadRgb888Damage readRgb888)
+{
+    if (!readRgb888)
+    {
+        return ReadRawFrame();
+    }
+    return [readRgb888](RawFrame *frame, RgbDamage *damage)
+    {
+        char *data = (char *)frame->planes[0];
+        ssize_t bytes = frame->bytes;
+        if (!readRgb888(&data, &bytes, frame->width, frame->height, damage))
+        {
+            return 0;
+        }
+        if ((uint8_t *)data == frame->planes[0] && frame->fourcc != RAW_FOURCC_RGB24)
+        {
+            return 0;//filled a buffer laid out for another format
+        }
+        RawFrameLayout(*frame, RAW_FOURCC_RGB24, frame->width, frame->height, data, bytes);
+        return 1;
+    };
+}
+
+rgbreader::rgbreader(ReadRawFrame readFrame)
+    : _readFrame(readFrame)
 {
 
 }
 
-int rgbreader::readImage(char **rgb, ssize_t *bytes, int width, int height)
+int rgbreader::readImage(RawFrame *frame, RgbDamage *damage)
 {
-    return _readRgb888(rgb, bytes, width, height);
+    damage->count = -1;
+    return _readFrame(frame, damage);
 }
@@ -1,15 +1,80 @@
 #pragma once
 
 #include <functional>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* pixel formats a capture source can deliver, fourcc codes as in V4L2 */
+#define RAW_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+enum RawFourcc : uint32_t
+{
+    RAW_FOURCC_RGB24  = RAW_FOURCC('R', 'G', 'B', '3'), //R, G, B bytes
+    RAW_FOURCC_BGR24  = RAW_FOURCC('B', 'G', 'R', '3'), //B, G, R bytes
+    RAW_FOURCC_RGBA   = RAW_FOURCC('A', 'B', '2', '4'), //R, G, B, A bytes
+    RAW_FOURCC_BGRA   = RAW_FOURCC('A', 'R', '2', '4'), //B, G, R, A bytes
+    RAW_FOURCC_RGB565 = RAW_FOURCC('R', 'G', 'B', 'P'), //little endian 16bit words, R in the top bits
+    RAW_FOURCC_NV12   = RAW_FOURCC('N', 'V', '1', '2'), //Y plane, then interleaved U, V at half resolution
+    RAW_FOURCC_YUYV   = RAW_FOURCC('Y', 'U', 'Y', 'V'), //Y0, U, Y1, V for each pixel pair
+};
+
+/* a captured frame. Packed formats use planes[0] only, NV12 has its Y plane
+ * in planes[0] and its UV plane in planes[1] */
+struct RawFrame
+{
+    uint32_t fourcc;
+    int width, height;
+    uint8_t *planes[2];
+    intptr_t strides[2];//bytes from one row to the next
+    ssize_t bytes;//size of the buffer planes[0] points at
+};
+
+//bytes per pixel of planes[0]
+int RawBytesPerPixel(uint32_t fourcc);
+//size of a tightly packed frame
+ssize_t RawFrameSize(uint32_t fourcc, int width, int height);
+//points the planes of frame at a tightly packed frame in buffer
+void RawFrameLayout(RawFrame &frame, uint32_t fourcc, int width, int height, char *buffer, ssize_t bytes);
+
+/* a region of the frame that changed since the previous capture */
+struct RgbDirtyRect
+{
+    int x, y, width, height;
+};
+
+/* damage reported along with a frame. count is -1 (the default the reader
+ * passes in) when the source cannot tell what changed, otherwise the first
+ * count rects cover every changed pixel, 0 meaning the frame is unchanged.
+ * A count above MAX_RECTS says more changed than fits and converts it all */
+struct RgbDamage
+{
+    enum { MAX_RECTS = 64 };
+    int count;
+    RgbDirtyRect rects[MAX_RECTS];
+};
+
+/* readFrame is called with frame laid out over a buffer owned by the reader,
+ * in the format the reader asked for, which it should fill in place. It may
+ * instead point the planes at memory of its own, which it keeps ownership
+ * of, and then also pick any format and strides by updating the descriptor.
+ * Either way the whole frame must be valid, damage only tells which parts
+ * need converting again. Returns non-zero on success */
+typedef std::function<int (RawFrame *frame, RgbDamage *damage)> ReadRawFrame;
+
+/* the original packed RGB24 contract. readRgb888 is called with *data
+ * pointing at a buffer of *bytes owned by the reader, which it should fill
+ * in place, or points *data at RGB24 memory of its own */
+typedef std::function<int (char **data, ssize_t *bytes, int width, int height)> ReadRgb888;
+typedef std::function<int (char **data, ssize_t *bytes, int width, int height, RgbDamage *damage)> ReadRgb888Damage;
+//adapts an RGB24 callback to the frame descriptor, the reader must ask for RGB24
+ReadRawFrame ReadRawFrameFromRgb888(ReadRgb888Damage readRgb888);
 
 class rgbreader
 {
 public:
-    rgbreader(std::function<int (char **data, ssize_t *bytes, int width, int height)> readRgb888);
+    rgbreader(ReadRawFrame readFrame);
     virtual ~rgbreader(){}
-    virtual int readImage(char **rgb, ssize_t *bytes, int width, int height);
+    virtual int readImage(RawFrame *frame, RgbDamage *damage);
 
 protected:
-    std::function<int (char **data, ssize_t *bytes, int width, int height)> _readRgb888;
+    ReadRawFrame _readFrame;
 };
-
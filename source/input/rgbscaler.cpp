@@ -0,0 +1,198 @@
+#include "rgbscaler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+#include "common.h"
+#include "primitives.h"
+#include "colorconvert.h"
+
+using namespace X265_NS;
+
+namespace  {
+
+//weight of a source sample t output pixels (in source units, unstretched) from the centre
+double filterWeight(RgbScaler::Filter filter, double t, double stretch)
+{
+    t = fabs(t) / stretch;
+    switch (filter)
+    {
+    case RgbScaler::FILTER_BILINEAR:
+        return t < 1 ? 1 - t : 0;
+    case RgbScaler::FILTER_BICUBIC:
+        //Catmull-Rom, a = -0.5
+        if (t < 1) return (1.5 * t - 2.5) * t * t + 1;
+        if (t < 2) return ((-0.5 * t + 2.5) * t - 4) * t + 2;
+        return 0;
+    case RgbScaler::FILTER_AREA:
+    default:
+        //overlap of the output pixel's footprint with the source pixel
+        return std::max(0.0, std::min(t + 0.5 / stretch, 0.5) - std::max(t - 0.5 / stretch, -0.5)) * stretch;
+    }
+}
+
+double filterSupport(RgbScaler::Filter filter, double stretch)
+{
+    switch (filter)
+    {
+    case RgbScaler::FILTER_BILINEAR: return stretch;
+    case RgbScaler::FILTER_BICUBIC:  return 2 * stretch;
+    case RgbScaler::FILTER_AREA:
+    default:                         return 0.5 * stretch + 0.5;
+    }
+}
+
+/* per thread scratch, grown as needed and reused across frames */
+struct ScaleScratch
+{
+    std::vector<int16_t> ring;//taps rows of horizontally filtered samples
+    std::vector<int> ringRow;//source row each ring slot holds
+    std::vector<uint8_t> out;//group rows of scaled pixels
+};
+thread_local ScaleScratch t_scratch;
+}//namespace
+
+bool RgbScaler::ParseFilter(const char *name, Filter &filter)
+{
+    if(strcmp(name, "bilinear") == 0) filter = FILTER_BILINEAR;
+    else if(strcmp(name, "bicubic") == 0) filter = FILTER_BICUBIC;
+    else if(strcmp(name, "area") == 0) filter = FILTER_AREA;
+    else return false;
+    return true;
+}
+
+RgbScaler::RgbScaler()
+    : _srcWidth(0)
+    , _srcHeight(0)
+    , _dstWidth(0)
+    , _dstHeight(0)
+{
+}
+
+bool RgbScaler::Init(int srcWidth, int srcHeight, int dstWidth, int dstHeight, Filter filter)
+{
+    _dstWidth = _dstHeight = 0;
+    if (!_h.Init(srcWidth, dstWidth, filter) || !_v.Init(srcHeight, dstHeight, filter))
+    {
+        std::cout << "Cannot scale " << srcWidth << "x" << srcHeight << " to " << dstWidth << "x" << dstHeight << "\n";
+        return false;
+    }
+    _srcWidth = srcWidth;
+    _srcHeight = srcHeight;
+    _dstWidth = dstWidth;
+    _dstHeight = dstHeight;
+    return true;
+}
+
+bool RgbScaler::Axis::Init(int src, int dst, Filter filter)
+{
+    if (src <= 0 || dst <= 0)
+    {
+        return false;
+    }
+    double ratio = (double)src / dst;
+    double stretch = std::max(1.0, ratio);//widen the kernel to cover the source when shrinking
+    double support = filterSupport(filter, stretch);
+
+    /* the widest window of any output, rounded up to pairs of taps */
+    taps = 0;
+    for (int i = 0; i < dst; i++)
+    {
+        double centre = (i + 0.5) * ratio - 0.5;
+        taps = std::max(taps, (int)floor(centre + support) - (int)ceil(centre - support) + 1);
+    }
+    taps = (taps + 1) & ~1;
+    if (taps > src || taps > MAX_TAPS)
+    {
+        return false;
+    }
+
+    pos.resize(dst);
+    coeffs.assign((size_t)dst * taps, 0);
+    std::vector<double> weights(taps);
+    for (int i = 0; i < dst; i++)
+    {
+        double centre = (i + 0.5) * ratio - 0.5;
+        int first = (int)ceil(centre - support);
+        int last = (int)floor(centre + support);
+        /* slide windows that cross an edge back inside, the samples beyond
+         * it weigh on the edge sample instead */
+        int start = std::min(std::max(first, 0), src - taps);
+        std::fill(weights.begin(), weights.end(), 0.0);
+        double sum = 0;
+        for (int j = first; j <= last; j++)
+        {
+            double w = filterWeight(filter, j - centre, stretch);
+            weights[std::min(std::max(j, 0), src - 1) - start] += w;
+            sum += w;
+        }
+
+        /* Q14, with rounding error folded into the largest tap so every
+         * window sums to exactly one */
+        int16_t *c = &coeffs[(size_t)i * taps];
+        int total = 0, peak = 0;
+        for (int k = 0; k < taps; k++)
+        {
+            c[k] = (int16_t)lround(weights[k] / sum * (1 << SCALE_COEFF_SHIFT));
+            total += c[k];
+            if (c[k] > c[peak]) peak = k;
+        }
+        c[peak] += (int16_t)((1 << SCALE_COEFF_SHIFT) - total);
+        pos[i] = start;
+    }
+    return true;
+}
+
+void RgbScaler::Axis::OutputSpan(int s0, int s1, int &o0, int &o1) const
+{
+    //windows start in increasing order
+    int dst = (int)pos.size();
+    o0 = 0;
+    while (o0 < dst && pos[o0] + taps <= s0)
+    {
+        o0++;
+    }
+    o1 = o0;
+    while (o1 < dst && pos[o1] < s1)
+    {
+        o1++;
+    }
+}
+
+void RgbScaler::Scale(const uint8_t *src, intptr_t srcStride, int bpp, int x, int y, int w, int h, int group,
+                      const ScaledRows &emit) const
+{
+    ScaleScratch &s = t_scratch;
+    int samples = w * bpp;
+    intptr_t ringStride = samples + 1;//scaleh may write one sample past the row
+    s.ring.resize((size_t)_v.taps * ringStride);
+    s.ringRow.assign(_v.taps, -1);
+    s.out.resize((size_t)group * samples);
+
+    scaleh_t scaleh = primitives.scaleh[bpp - 3];
+    const int16_t *rows[MAX_TAPS];
+    for (int oy = y; oy < y + h; oy += group)
+    {
+        int count = std::min(group, y + h - oy);
+        for (int r = 0; r < count; r++)
+        {
+            int sy = _v.pos[oy + r];
+            for (int k = 0; k < _v.taps; k++)
+            {
+                int slot = (sy + k) % _v.taps;
+                int16_t *ring = &s.ring[slot * ringStride];
+                if (s.ringRow[slot] != sy + k)
+                {
+                    scaleh(src + (sy + k) * srcStride, ring, &_h.pos[x], &_h.coeffs[(size_t)x * _h.taps],
+                           _h.taps, w, _srcWidth);
+                    s.ringRow[slot] = sy + k;
+                }
+                rows[k] = ring;
+            }
+            primitives.scalev(rows, &s.out[(size_t)r * samples], &_v.coeffs[(size_t)(oy + r) * _v.taps], _v.taps, samples);
+        }
+        emit(s.out.data(), samples, oy, count);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+/* Separable polyphase resampler for packed 8bit RGB frames, so a source can
+ * be captured at one size and encoded at another. Each source row is
+ * filtered horizontally once into a small ring of 16bit rows and output rows
+ * are handed on in small groups while they are still in cache, which lets
+ * the caller convert them to YUV straight away */
+class RgbScaler
+{
+public:
+    enum { MAX_TAPS = 64 };//limits shrinking to about 16:1 bicubic, 32:1 bilinear
+
+    enum Filter
+    {
+        FILTER_BILINEAR,
+        FILTER_BICUBIC,  //Catmull-Rom
+        FILTER_AREA,     //box average of the covered source pixels
+    };
+    //bilinear, bicubic or area
+    static bool ParseFilter(const char *name, Filter &filter);
+
+    RgbScaler();
+    bool Init(int srcWidth, int srcHeight, int dstWidth, int dstHeight, Filter filter);
+    bool Active() const { return _dstWidth > 0; }
+    int SrcWidth() const  { return _srcWidth; }
+    int SrcHeight() const { return _srcHeight; }
+    int DstWidth() const  { return _dstWidth; }
+    int DstHeight() const { return _dstHeight; }
+
+    //output columns (or rows) [o0, o1) reading any of source columns (or rows) [s0, s1)
+    void OutputColumns(int s0, int s1, int &o0, int &o1) const { _h.OutputSpan(s0, s1, o0, o1); }
+    void OutputRows(int s0, int s1, int &o0, int &o1) const { _v.OutputSpan(s0, s1, o0, o1); }
+
+    /* called with count scaled rows starting at output row y, each holding
+     * the requested columns packed like the source */
+    typedef std::function<void (const uint8_t *rows, intptr_t stride, int y, int count)> ScaledRows;
+    /* scales output columns [x, x + w) of rows [y, y + h) from src, a frame
+     * of bpp (3 or 4) bytes per pixel, in groups of group rows. Safe to call
+     * from several threads at once */
+    void Scale(const uint8_t *src, intptr_t srcStride, int bpp, int x, int y, int w, int h, int group,
+               const ScaledRows &emit) const;
+
+protected:
+    /* filter taps of one axis, output i reads taps source samples from
+     * pos[i] weighted by the Q14 coeffs[i * taps] */
+    struct Axis
+    {
+        std::vector<int32_t> pos;
+        std::vector<int16_t> coeffs;
+        int taps = 0;
+        bool Init(int src, int dst, Filter filter);
+        void OutputSpan(int s0, int s1, int &o0, int &o1) const;
+    };
+
+    Axis _h, _v;
+    int _srcWidth, _srcHeight;
+    int _dstWidth, _dstHeight;
+};
@@ -26,7 +26,9 @@
 #include "common.h"
 #include "reader.h"
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #define ENABLE_THREADING 1
 
@@ -41,11 +43,15 @@
 using namespace X265_NS;
 using namespace std;
 
-YUVInput::YUVInput(InputFileInfo& info)
+/* microseconds on a clock that never steps, unlike x265_mdate() */
+static int64_t monotonicTime()
 {
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        buf[i] = NULL;
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
 
+YUVInput::YUVInput(InputFileInfo& info)
+{
+    bReading = false;
     depth = info.depth;
     width = info.width;
     height = info.height;
@@ -53,6 +59,16 @@ YUVInput::YUVInput(InputFileInfo& info)
     threadActive = false;
     ifs = NULL;
     reader = info.reader;
+    bLive = reader && reader->IsLive() && info.fpsNum && info.fpsDenom;
+    capturePolicy = reader ? reader->args.Policy : Reader::CAPTURE_DROP_OLDEST;
+    fpsNum = info.fpsNum;
+    fpsDenom = info.fpsDenom;
+    lastFrame = NULL;
+    captureStart = 0;
+    lastPts = -1;
+    framesCaptured = framesSkipped = framesDuplicated = 0;
+    residencyCount = 0;
+    residencySum = residencyMax = 0;
 
     uint32_t pixelbytes = depth > 8 ? 2 : 1;
     framesize = 0;
@@ -62,6 +78,17 @@ YUVInput::YUVInput(InputFileInfo& info)
         uint32_t h = height >> x265_cli_csps[colorSpace].height[i];
         framesize += w * h * pixelbytes;
     }
+    changeOffset = (framesize + 15) & ~15;
+    changeBlocks = bLive ? Reader::DamageBlocks(width, height) : 0;
+    slotsize = changeBlocks ? changeOffset + changeBlocks * sizeof(uint32_t) : framesize;
+    bProgressive = bLive && reader->args.Progressive;
+    rowsOffset = (slotsize + 15) & ~15;
+    if (bProgressive)
+        slotsize = rowsOffset + sizeof(std::atomic<int>);
+    writeSlot = readSlot = NULL;
+    pictureGen = NULL;
+    changeMap = NULL;
+    blocksRead = blocksUnchanged = 0;
 
     if (width == 0 || height == 0 || info.fpsNum == 0 || info.fpsDenom == 0)
     {
@@ -91,18 +118,38 @@ YUVInput::YUVInput(InputFileInfo& info)
         return;
     }
 
-    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+    if (bLive && capturePolicy == Reader::CAPTURE_DUPLICATE)
+        lastFrame = X265_MALLOC(char, slotsize);
+    if (changeBlocks)
     {
-        buf[i] = X265_MALLOC(char, framesize);
-        if (buf[i] == NULL)
-        {
-            x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
-            threadActive = false;
-            return;
-        }
+        pictureGen = X265_MALLOC(uint32_t, changeBlocks);
+        changeMap = X265_MALLOC(uint8_t, changeBlocks);
+        if (pictureGen)
+            memset(pictureGen, 0, changeBlocks * sizeof(uint32_t));
+    }
+    if (!queue.Init(QUEUE_SIZE, slotsize, bLive && capturePolicy == Reader::CAPTURE_DROP_OLDEST) ||
+        (bLive && capturePolicy == Reader::CAPTURE_DUPLICATE && !lastFrame) ||
+        (changeBlocks && !(pictureGen && changeMap)))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
+        threadActive = false;
+        return;
     }
 
     info.frameCount = -1;
+    if (reader)
+    {
+        /* the reader maps its own source and applies the seek itself */
+        if (!reader->Open(width, height, info.skipFrames, info.frameCount))
+            threadActive = false;
+        if (bProgressive)
+            reader->SetRowsConverted([this](int rows)
+            {
+                slotRows(writeSlot)->store(rows);
+                rowsEvent.trigger();
+            });
+        return;
+    }
     /* try to estimate frame count, if this is not stdin */
     if (ifs && ifs != stdin)
     {
@@ -121,24 +168,36 @@ YUVInput::YUVInput(InputFileInfo& info)
         if (ifs != stdin)
             fseeko(ifs, (int64_t)framesize * info.skipFrames, SEEK_CUR);
         else
+        {
+            char* skip = queue.AcquireWrite(false);
             for (int i = 0; i < info.skipFrames; i++)
-                if (fread(buf[0], framesize, 1, ifs) != 1)
+                if (fread(skip, framesize, 1, ifs) != 1)
                     break;
+        }
     }
 }
 YUVInput::~YUVInput()
 {
     if (ifs && ifs != stdin)
         fclose(ifs);
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        X265_FREE(buf[i]);
+    X265_FREE(lastFrame);
+    X265_FREE(pictureGen);
+    X265_FREE(changeMap);
 }
 
 void YUVInput::release()
 {
     threadActive = false;
-    readCount.poke();
+    queue.Close();
     stop();
+    if (bLive)
+        x265_log(NULL, X265_LOG_INFO, "yuv: captured %llu frames, dropped %llu, missed %llu ticks, duplicated %llu, queue residency avg %.1f ms max %.1f ms\n",
+                 (unsigned long long)framesCaptured, (unsigned long long)queue.Dropped(),
+                 (unsigned long long)framesSkipped, (unsigned long long)framesDuplicated,
+                 residencyCount ? (double)residencySum / residencyCount / 1000 : 0.0, (double)residencyMax / 1000);
+    if (blocksRead)
+        x265_log(NULL, X265_LOG_INFO, "yuv: %.1f%% of 16x16 blocks unchanged between pictures\n",
+                 100.0 * blocksUnchanged / blocksRead);
     delete this;
 }
 
@@ -153,39 +212,41 @@ void YUVInput::startReader()
 void YUVInput::threadMain()
 {
     THREAD_NAME("YUVRead", 0);
-    while (threadActive)
+    if (bLive)
+        captureFrames();
+    else
     {
-        if (!populateFrameQueue())
-            break;
+        while (threadActive)
+        {
+            if (!populateFrameQueue())
+                break;
+        }
     }
 
     threadActive = false;
-    writeCount.poke();
+    queue.Close();
 }
 bool YUVInput::populateFrameQueue()
 {
     if (!reader && (!ifs || ferror(ifs)))
         return false;
-    /* wait for room in the ring buffer */
-    int written = writeCount.get();
-    int read = readCount.get();
-    while (written - read > QUEUE_SIZE - 2)
-    {
-        read = readCount.waitForChange(read);
-        if (!threadActive)
-            // release() has been called
-            return false;
-    }
+    /* wait for a free slot, or take the oldest unread one of a live capture */
+    char* slot = queue.AcquireWrite(true);
+    if (!slot)
+        // release() has been called
+        return false;
     ProfileScopeEvent(frameRead);
     if(reader)
     {
-        reader->ReadYuvFrame(buf[written % QUEUE_SIZE], framesize, width, height);
-        writeCount.incr();
+        int64_t stamp = monotonicTime();
+        if (!reader->ReadYuvFrame(slot, framesize, width, height, colorSpace))
+            return false;
+        queue.CommitWrite(stamp);
         return true;
     }
-    else if (fread(buf[written % QUEUE_SIZE], framesize, 1, ifs) == 1)
+    else if (fread(slot, framesize, 1, ifs) == 1)
     {
-        writeCount.incr();
+        queue.CommitWrite(monotonicTime());
         return true;
     }
     else
@@ -194,24 +255,109 @@ bool YUVInput::populateFrameQueue()
     }
 }
 
+/* Samples the live source once per frame period of a monotonic clock, each
+ * frame stamped with the time its capture started */
+void YUVInput::captureFrames()
+{
+    const int64_t period = (int64_t)1000000 * fpsDenom / fpsNum;
+    int64_t next = monotonicTime();
+
+    while (threadActive)
+    {
+        int64_t now = monotonicTime();
+        if (now < next)
+        {
+            this_thread::sleep_for(chrono::microseconds(next - now));
+            continue;
+        }
+
+        /* ticks that passed while the source or a full queue held us up */
+        int64_t missed = (now - next) / period;
+        if (missed)
+        {
+            for (int64_t i = 0; i < missed; i++)
+            {
+                char* dup = capturePolicy == Reader::CAPTURE_DUPLICATE && framesCaptured ? queue.AcquireWrite(false) : NULL;
+                if (dup)
+                {
+                    memcpy(dup, lastFrame, slotsize);
+                    queue.CommitWrite(next + i * period);
+                    framesDuplicated++;
+                }
+                else
+                    framesSkipped++;
+            }
+            next += missed * period;
+        }
+        next += period;
+
+        char* slot = queue.AcquireWrite(capturePolicy != Reader::CAPTURE_DROP_NEWEST);
+        if (!slot)
+        {
+            if (capturePolicy != Reader::CAPTURE_DROP_NEWEST)
+                break; // release() has been called
+            framesSkipped++;
+            continue;
+        }
+
+        int64_t stamp = monotonicTime();
+        ProfileScopeEvent(frameRead);
+        if (bProgressive)
+        {
+            /* queue the slot before converting it, the encoder waits on its rows */
+            slotRows(slot)->store(0);
+            writeSlot = slot;
+            queue.CommitWrite(stamp);
+        }
+        bool bRead = reader->ReadYuvFrame(slot, framesize, width, height, colorSpace, slotGen(slot));
+        if (bProgressive)
+        {
+            /* even a failed read must not leave the encoder waiting */
+            slotRows(slot)->store(height);
+            rowsEvent.trigger();
+        }
+        if (!bRead)
+            break;
+        if (lastFrame)
+            memcpy(lastFrame, slot, slotsize);
+        if (!bProgressive)
+            queue.CommitWrite(stamp);
+        framesCaptured++;
+    }
+}
+
+/* called by the encoder, blocks until the capture thread has converted
+ * rows luma rows of the picture last read */
+int YUVInput::rowsReady(void* opaque, int rows)
+{
+    YUVInput* input = (YUVInput*)opaque;
+    std::atomic<int>* converted = input->slotRows(input->readSlot);
+    int ready;
+    while ((ready = converted->load()) < rows)
+        input->rowsEvent.wait();
+    return ready;
+}
+
 bool YUVInput::readPicture(x265_picture& pic)
 {
-    int read = readCount.get();
-    int written = writeCount.get();
+    /* the encoder has copied the previous picture by now */
+    if (bReading)
+        queue.ReleaseRead();
+    bReading = false;
 
 #if ENABLE_THREADING
 
     /* only wait if the read thread is still active */
-    while (threadActive && read == written)
-        written = writeCount.waitForChange(written);
+    char* slot = queue.AcquireRead(threadActive);
 
 #else
 
     populateFrameQueue();
+    char* slot = queue.AcquireRead(false);
 
 #endif // if ENABLE_THREADING
 
-    if (read < written)
+    if (slot)
     {
         uint32_t pixelbytes = depth > 8 ? 2 : 1;
         pic.colorSpace = colorSpace;
@@ -222,10 +368,46 @@ bool YUVInput::readPicture(x265_picture& pic)
         pic.stride[0] = width * pixelbytes;
         pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
         pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
+        pic.planes[0] = slot;
+        int64_t stamp = queue.ReadStamp();
+        int64_t residency = monotonicTime() - stamp;
+        residencySum += residency;
+        residencyMax = X265_MAX(residencyMax, residency);
+        residencyCount++;
+        if (bLive)
+        {
+            /* capture time in 1/fps units, kept strictly increasing */
+            if (lastPts < 0)
+                captureStart = stamp;
+            int64_t pts = ((stamp - captureStart) * fpsNum + (int64_t)fpsDenom * 500000) / ((int64_t)fpsDenom * 1000000);
+            lastPts = pic.pts = X265_MAX(pts, lastPts + 1);
+        }
+        pic.rowsReady = NULL;
+        pic.rowsOpaque = NULL;
+        if (bProgressive)
+        {
+            /* the generations are only final once the slot is converted, so
+             * there is no change map */
+            readSlot = slot;
+            pic.rowsReady = rowsReady;
+            pic.rowsOpaque = this;
+        }
+        else if (changeBlocks)
+        {
+            /* a block is unchanged if it still holds the same source generation */
+            const uint32_t* gen = slotGen(slot);
+            for (uint32_t i = 0; i < changeBlocks; i++)
+            {
+                changeMap[i] = gen[i] != pictureGen[i];
+                blocksUnchanged += !changeMap[i];
+            }
+            memcpy(pictureGen, gen, changeBlocks * sizeof(uint32_t));
+            blocksRead += changeBlocks;
+            pic.changeMap = changeMap;
+        }
         pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
         pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
-        readCount.incr();
+        bReading = true;
         return true;
     }
     else
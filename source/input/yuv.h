@@ -26,6 +26,8 @@
 
 #include "input.h"
 #include "threading.h"
+#include "frameq.h"
+#include <atomic>
 #include <fstream>
 
 #define QUEUE_SIZE 5
@@ -47,18 +49,56 @@ protected:
 
     uint32_t framesize;
 
+    /* live capture slots carry the source generation of each 16x16 block
+     * after the pixels, from which readPicture derives the change map */
+    uint32_t slotsize;
+    uint32_t changeOffset;
+    uint32_t changeBlocks;
+    uint32_t* pictureGen; //< block generations of the last picture read
+    uint8_t* changeMap;
+    uint64_t blocksRead;
+    uint64_t blocksUnchanged;
+
+    /* progressive live capture queues a slot as soon as its conversion starts.
+     * The slot then carries the luma rows converted so far after the block
+     * generations, which the encoder waits on through x265_picture.rowsReady */
+    bool bProgressive;
+    uint32_t rowsOffset;
+    char* writeSlot; //< slot being converted, capture thread only
+    char* readSlot;
+    Event rowsEvent;
+
     bool threadActive;
 
-    ThreadSafeInteger readCount;
+    FrameQueue queue;
 
-    ThreadSafeInteger writeCount;
-    char* buf[QUEUE_SIZE];
+    bool bReading; //< a queue slot is lent to the encoder
     FILE *ifs;
     Reader *reader;
+
+    /* live capture pacing and statistics */
+    bool bLive;
+    int capturePolicy;
+    uint32_t fpsNum;
+    uint32_t fpsDenom;
+    char* lastFrame; //< copy of the last capture, for duplication
+    int64_t captureStart;
+    int64_t lastPts;
+    uint64_t framesCaptured;
+    uint64_t framesSkipped; //< clock ticks that were not sampled
+    uint64_t framesDuplicated;
+    uint64_t residencyCount;
+    int64_t residencySum;
+    int64_t residencyMax;
+
     int guessFrameCount();
     void threadMain();
 
     bool populateFrameQueue();
+    void captureFrames();
+    uint32_t* slotGen(char* slot) const          { return changeBlocks ? (uint32_t*)(slot + changeOffset) : NULL; }
+    std::atomic<int>* slotRows(char* slot) const { return (std::atomic<int>*)(slot + rowsOffset); }
+    static int rowsReady(void* opaque, int rows);
 
 public:
 
@@ -67,11 +107,13 @@ public:
     virtual ~YUVInput();
     void release();
     bool isEof() const                            { return ifs && feof(ifs); }
-    bool isFail()                                 { return !(ifs && !ferror(ifs) && threadActive); }
+    bool isFail()                                 { return !((reader || (ifs && !ferror(ifs))) && threadActive); }
     void startReader();
 
     bool readPicture(x265_picture&);
 
+    bool isLive() const                           { return bLive; }
+
     const char *getName() const                   { return "yuv"; }
 
     int getWidth() const                          { return width; }
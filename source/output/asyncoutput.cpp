@@ -0,0 +1,226 @@
+#include "asyncoutput.h"
+
+#include <string.h>
+
+using namespace X265_NS;
+
+uint32_t WriterThread::Unit::assign(const x265_nal* nal, uint32_t nalcount, Kind unitKind, const x265_picture *picture, int64_t unitPts)
+{
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        bytes += nal[i].sizeBytes;
+    }
+    payload.resize(bytes);
+    nals.assign(nal, nal + nalcount);
+    uint8_t *dst = payload.data();
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        memcpy(dst, nal[i].payload, nal[i].sizeBytes);
+        nals[i].payload = dst;
+        dst += nal[i].sizeBytes;
+    }
+    kind = unitKind;
+    pts = unitPts;
+    if (picture)
+    {
+        pic = *picture;
+    }
+    return bytes;
+}
+
+WriterThread::WriterThread(OutputFile *output)
+    : _output(output)
+    , _closing(false)
+    , _running(false)
+{
+    memset(&_written, 0, sizeof _written);
+}
+
+bool WriterThread::startWriting()
+{
+    _running = start();
+    return _running;
+}
+
+void WriterThread::threadMain()
+{
+    _lock.acquire();
+    for (;;)
+    {
+        /* the unit stays queued, and untouched by the writing side, until
+         * pop. Wait only on an empty queue, triggers may be merged */
+        const Unit *unit = front();
+        if (!unit)
+        {
+            if (_closing)
+            {
+                _lock.release();
+                return;
+            }
+            _lock.release();
+            _readable.wait();
+            _lock.acquire();
+            continue;
+        }
+        _lock.release();
+
+        int64_t start = x265_mdate();
+        int bytes = 0;
+        uint32_t nalcount = (uint32_t)unit->nals.size();
+        switch (unit->kind)
+        {
+        case HEADERS:
+            bytes = _output->writeHeaders(unit->nals.data(), nalcount);
+            break;
+        case FRAME:
+        {
+            x265_picture pic = unit->pic;
+            bytes = _output->writeFrame(unit->nals.data(), nalcount, pic);
+            break;
+        }
+        case PARTIAL:
+        case LAST_PARTIAL:
+            bytes = _output->writePartial(unit->nals.data(), nalcount, unit->pts, unit->kind == LAST_PARTIAL);
+            break;
+        }
+        int64_t latency = x265_mdate() - start;
+
+        _lock.acquire();
+        pop();
+        _written.units++;
+        _written.bytes += X265_MAX(bytes, 0);
+        _written.latencySum += latency;
+        _written.maxLatency = X265_MAX(_written.maxLatency, latency);
+    }
+}
+
+void WriterThread::drain()
+{
+    if (!_running)
+    {
+        return;
+    }
+    _lock.acquire();
+    _closing = true;
+    _lock.release();
+    _readable.trigger();
+    stop();
+    _running = false;
+}
+
+AsyncOutput::AsyncOutput(OutputFile *output, int depth)
+    : WriterThread(output)
+    , _units(depth)
+    , _depth(depth)
+    , _head(0)
+    , _tail(0)
+    , _stalls(0)
+    , _depthSum(0)
+{
+}
+
+AsyncOutput::~AsyncOutput()
+{
+}
+
+AsyncOutput *AsyncOutput::construct(OutputFile *output, int depth)
+{
+    auto out = new AsyncOutput(output, depth);
+    if (!out->startWriting())
+    {
+        x265_log(NULL, X265_LOG_ERROR, "output: unable to start the writer thread\n");
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+void AsyncOutput::release()
+{
+    drain();
+    if (_output)
+    {
+        _output->release();
+    }
+    delete this;
+}
+
+const WriterThread::Unit *AsyncOutput::front()
+{
+    return _head == _tail ? nullptr : &_units[_head % _depth];
+}
+
+void AsyncOutput::pop()
+{
+    _head++;
+    _writable.trigger();
+}
+
+int AsyncOutput::enqueue(const x265_nal* nal, uint32_t nalcount, Kind kind, const x265_picture *pic, int64_t pts)
+{
+    ScopedLock lock(_lock);
+    if (_tail - _head == (uint64_t)_depth)
+    {
+        _stalls++;
+        while (_tail - _head == (uint64_t)_depth)
+        {
+            _lock.release();
+            _writable.wait();
+            _lock.acquire();
+        }
+    }
+
+    /* the entry is free, the writer thread does not touch it until _tail
+     * moves past it */
+    Unit &unit = _units[_tail % _depth];
+    _lock.release();
+    uint32_t bytes = unit.assign(nal, nalcount, kind, pic, pts);
+    _lock.acquire();
+
+    _tail++;
+    int depth = (int)(_tail - _head);
+    _depthSum += depth;
+    _written.maxDepth = X265_MAX(_written.maxDepth, depth);
+    _readable.trigger();
+    return (int)bytes;
+}
+
+int AsyncOutput::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    return enqueue(nal, nalcount, HEADERS, nullptr, 0);
+}
+
+int AsyncOutput::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    return enqueue(nal, nalcount, FRAME, &pic, pic.pts);
+}
+
+int AsyncOutput::writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast)
+{
+    return enqueue(nal, nalcount, bLast ? LAST_PARTIAL : PARTIAL, nullptr, pts);
+}
+
+void AsyncOutput::closeFile(int64_t largest_pts, int64_t second_largest_pts)
+{
+    drain();
+    _output->closeFile(largest_pts, second_largest_pts);
+
+    Stats stats = GetStats();
+    if (stats.units)
+    {
+        x265_log(NULL, X265_LOG_INFO, "output: wrote %llu units, queue depth avg %.1f max %d of %d, encoder waited %llu times, write latency avg %.2f ms max %.2f ms\n",
+                 (unsigned long long)stats.units, (double)stats.depthSum / stats.units, stats.maxDepth, _depth,
+                 (unsigned long long)stats.stalls, stats.latencySum / 1000.0 / stats.units, stats.maxLatency / 1000.0);
+    }
+}
+
+AsyncOutput::Stats AsyncOutput::GetStats()
+{
+    ScopedLock lock(_lock);
+    Stats stats;
+    static_cast<WriterThread::Stats &>(stats) = _written;
+    stats.stalls = _stalls;
+    stats.depthSum = _depthSum;
+    return stats;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "output.h"
+#include "threading.h"
+
+/* Writes copied access units, or parts of them, to an output on a thread
+ * of its own, in the order they were queued. The subclass keeps the queue
+ * and decides what happens when it is full; front and pop are called with
+ * _lock held, and queueing triggers _readable. drain lets the thread write
+ * what is queued and stops it */
+class WriterThread : public x265::Thread
+{
+public:
+    enum Kind { HEADERS, FRAME, PARTIAL, LAST_PARTIAL };
+
+    struct Unit
+    {
+        std::vector<uint8_t> payload;//capacity kept when the unit is reused
+        std::vector<x265_nal> nals;//pointing into payload
+        x265_picture pic;//FRAME only
+        int64_t pts;//partials only
+        Kind kind;
+
+        //copies the NALs into payload, returns their bytes
+        uint32_t assign(const x265_nal* nal, uint32_t nalcount, Kind unitKind, const x265_picture *picture, int64_t unitPts);
+    };
+
+    struct Stats
+    {
+        uint64_t units;
+        uint64_t bytes;
+        int maxDepth;//units queued, set by the subclass
+        int64_t latencySum;//microseconds in the output's writes
+        int64_t maxLatency;
+    };
+
+    //false if the thread cannot start
+    bool startWriting();
+    void drain();
+    x265::OutputFile *output() const { return _output; }
+    bool running() const { return _running; }
+
+protected:
+    WriterThread(x265::OutputFile *output);
+    virtual void threadMain() override;
+
+    //the oldest unit queued, NULL when there is none
+    virtual const Unit *front() = 0;
+    //the front unit was written
+    virtual void pop() = 0;
+
+    x265::OutputFile *_output;
+    bool _closing;
+    bool _running;
+    Stats _written;
+    x265::Lock _lock;//guards the queue, _closing and _written
+    x265::Event _readable;//triggered for each unit queued, and to close
+};
+
+/* Runs another output's writes on a thread of its own. writeHeaders,
+ * writeFrame and writePartial copy the access unit, or the part of it,
+ * into a ring of depth entries and return,
+ * so socket back-pressure or a slow disk does not hold up encoder_encode.
+ * Only a full ring makes them wait. Units reach the wrapped output in order,
+ * and closeFile drains the ring before closing it */
+class AsyncOutput : public x265::OutputFile, public WriterThread
+{
+public:
+    //takes ownership of output, or returns NULL and leaves it with the caller if the thread cannot start
+    static AsyncOutput *construct(x265::OutputFile *output, int depth);
+
+    virtual bool isFail() const override { return _output->isFail(); }
+    virtual bool needPTS() const override { return _output->needPTS(); }
+    virtual void release() override;
+    virtual const char* getName() const override { return _output->getName(); }
+    virtual void setParam(x265_param* param) override { _output->setParam(param); }
+
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual bool canStream() const override { return _output->canStream(); }
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+    struct Stats : WriterThread::Stats
+    {
+        uint64_t stalls;//writes that waited for a free entry
+        uint64_t depthSum;//entries queued, summed when each unit was queued
+    };
+    Stats GetStats();
+
+protected:
+    AsyncOutput(x265::OutputFile *output, int depth);
+    virtual ~AsyncOutput();
+    virtual const Unit *front() override;
+    virtual void pop() override;
+
+    int enqueue(const x265_nal* nal, uint32_t nalcount, Kind kind, const x265_picture *pic, int64_t pts);
+
+    std::vector<Unit> _units;
+    int _depth;
+    uint64_t _head, _tail;//units written, units queued
+    uint64_t _stalls, _depthSum;
+    x265::Event _writable;
+};
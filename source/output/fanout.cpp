@@ -0,0 +1,243 @@
+#include "fanout.h"
+
+#include <string.h>
+
+#include "common.h"
+#include "rtpwriter.h"
+#include "shmwriter.h"
+#include "tswriter.h"
+
+using namespace X265_NS;
+
+FanOutput::Destination::Destination(OutputFile *output, const std::string &name, int depth)
+    : WriterThread(output)
+    , _name(name)
+    , _depth(depth)
+    , _resync(false)
+    , _dropped(0)
+    , _resyncs(0)
+{
+}
+
+FanOutput::Destination::~Destination()
+{
+    drain();
+    if (_output)
+    {
+        _output->release();
+    }
+}
+
+bool FanOutput::Destination::offer(const std::shared_ptr<const FanOutput::Unit> &unit, bool &overflowed)
+{
+    ScopedLock lock(_lock);
+    overflowed = false;
+    if (_resync && unit->bStart && unit->bIrap)
+    {
+        _resync = false;
+    }
+    if (!_resync && (int)_queue.size() == _depth)
+    {
+        _resync = true;
+        _resyncs++;
+        overflowed = true;
+    }
+    if (_resync)
+    {
+        _dropped++;
+        return false;
+    }
+    _queue.push_back(unit);
+    _written.maxDepth = X265_MAX(_written.maxDepth, (int)_queue.size());
+    _readable.trigger();
+    return true;
+}
+
+const WriterThread::Unit *FanOutput::Destination::front()
+{
+    return _queue.empty() ? nullptr : _queue.front().get();
+}
+
+void FanOutput::Destination::pop()
+{
+    _queue.pop_front();
+}
+
+FanOutput::Stats FanOutput::Destination::GetStats()
+{
+    ScopedLock lock(_lock);
+    FanOutput::Stats stats;
+    static_cast<WriterThread::Stats &>(stats) = _written;
+    stats.dropped = _dropped;
+    stats.resyncs = _resyncs;
+    return stats;
+}
+
+FanOutput::FanOutput()
+    : _bStart(true)
+    , _refresh(false)
+{}
+
+FanOutput::~FanOutput()
+{
+    for (Destination *destination : _destinations)
+    {
+        delete destination;
+    }
+}
+
+bool FanOutput::isDestination(const char *name)
+{
+    return !strncmp(name, UDP, strlen(UDP)) || !strncmp(name, RTP, strlen(RTP)) ||
+           !strncmp(name, UDP_TS, strlen(UDP_TS)) || !strncmp(name, SHM, strlen(SHM));
+}
+
+FanOutput *FanOutput::construct(const char *destinations, InputFileInfo &inputInfo, int depth)
+{
+    auto out = new FanOutput();
+    std::string list = destinations;
+    size_t start = 0;
+    while (start <= list.size())
+    {
+        size_t comma = list.find(',', start);
+        std::string name = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        start = comma == std::string::npos ? list.size() + 1 : comma + 1;
+
+        if (!isDestination(name.c_str()))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "fanout: %s is not a udp://, rtp://, udp+ts:// or shm:// destination\n", name.c_str());
+            delete out;
+            return nullptr;
+        }
+        OutputFile *output = OutputFile::open(name.c_str(), inputInfo);
+        if (!output || output->isFail())
+        {
+            x265_log(NULL, X265_LOG_ERROR, "fanout: unable to open %s\n", name.c_str());
+            if (output)
+            {
+                output->release();
+            }
+            delete out;
+            return nullptr;
+        }
+        auto destination = new Destination(output, name, depth);
+        out->_destinations.push_back(destination);
+        if (!destination->startWriting())
+        {
+            x265_log(NULL, X265_LOG_ERROR, "fanout: unable to start the sending thread of %s\n", name.c_str());
+            delete out;
+            return nullptr;
+        }
+    }
+    return out;
+}
+
+bool FanOutput::isFail() const
+{
+    for (Destination *destination : _destinations)
+    {
+        if (destination->output()->isFail())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FanOutput::needPTS() const
+{
+    for (Destination *destination : _destinations)
+    {
+        if (destination->output()->needPTS())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FanOutput::canStream() const
+{
+    for (Destination *destination : _destinations)
+    {
+        if (!destination->output()->canStream())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FanOutput::release()
+{
+    delete this;
+}
+
+void FanOutput::setParam(x265_param* param)
+{
+    for (Destination *destination : _destinations)
+    {
+        destination->output()->setParam(param);
+    }
+}
+
+int FanOutput::offer(const x265_nal* nal, uint32_t nalcount, WriterThread::Kind kind, const x265_picture *pic, int64_t pts)
+{
+    auto unit = std::make_shared<Unit>();
+    uint32_t bytes = unit->assign(nal, nalcount, kind, pic, pts);
+    unit->bIrap = false;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        unit->bIrap |= (nal[i].type >= NAL_UNIT_CODED_SLICE_BLA_W_LP && nal[i].type <= NAL_UNIT_CODED_SLICE_CRA) ||
+                       (nal[i].type >= NAL_UNIT_VPS && nal[i].type <= NAL_UNIT_PPS);
+    }
+    unit->bStart = _bStart;
+    _bStart = kind != WriterThread::PARTIAL;
+
+    std::shared_ptr<const Unit> shared = unit;
+    for (Destination *destination : _destinations)
+    {
+        bool overflowed;
+        destination->offer(shared, overflowed);
+        if (overflowed)
+        {
+            _refresh = true;
+        }
+    }
+    return (int)bytes;
+}
+
+int FanOutput::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    return offer(nal, nalcount, WriterThread::HEADERS, nullptr, 0);
+}
+
+int FanOutput::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    return offer(nal, nalcount, WriterThread::FRAME, &pic, pic.pts);
+}
+
+int FanOutput::writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast)
+{
+    return offer(nal, nalcount, bLast ? WriterThread::LAST_PARTIAL : WriterThread::PARTIAL, nullptr, pts);
+}
+
+bool FanOutput::takeRefresh()
+{
+    return _refresh.exchange(false);
+}
+
+void FanOutput::closeFile(int64_t largest_pts, int64_t second_largest_pts)
+{
+    for (Destination *destination : _destinations)
+    {
+        destination->drain();
+        destination->output()->closeFile(largest_pts, second_largest_pts);
+
+        Stats stats = destination->GetStats();
+        x265_log(NULL, X265_LOG_INFO, "fanout: %s: %llu units (%llu bytes), %llu dropped in %llu resyncs, queue max %d, write latency avg %.2f ms max %.2f ms\n",
+                 destination->name().c_str(), (unsigned long long)stats.units, (unsigned long long)stats.bytes,
+                 (unsigned long long)stats.dropped, (unsigned long long)stats.resyncs, stats.maxDepth,
+                 stats.units ? stats.latencySum / 1000.0 / stats.units : 0, stats.maxLatency / 1000.0);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "asyncoutput.h"
+#include "output.h"
+
+/* One encode sent to several destinations, -o udp://a:port,rtp://b:port?nack=200,shm://gui.
+ * Every destination is an output of its own with a bounded queue and a
+ * sending thread, so a slow receiver or a blocked socket delays nobody
+ * else and never the encoder. Each access unit, or part of one when
+ * streaming, is copied once into a buffer the queues share by reference
+ * count. A destination whose queue is full drops what it is offered and
+ * then everything up to the start of the next IRAP access unit, where its
+ * receiver can resync; takeRefresh asks the encoder for that picture, an
+ * IDR also with --intra-refresh as a refresh wave has no IRAP */
+class FanOutput : public x265::OutputFile
+{
+public:
+    //NULL if a destination cannot be opened or its thread cannot start
+    static FanOutput *construct(const char *destinations, x265::InputFileInfo &inputInfo, int depth);
+    //true for a udp://, rtp://, udp+ts:// or shm:// name, the outputs that can be fanned out to
+    static bool isDestination(const char *name);
+
+    virtual bool isFail() const override;
+    virtual bool needPTS() const override;
+    virtual void release() override;
+    virtual const char* getName() const override { return "fanout"; }
+    virtual void setParam(x265_param* param) override;
+
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual bool canStream() const override;
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+    //true once after a destination started waiting for an IRAP picture
+    bool takeRefresh();
+
+protected:
+    struct Unit : WriterThread::Unit
+    {
+        bool bStart;//first piece of an access unit
+        bool bIrap;//carries an IRAP slice or parameter sets
+    };
+
+    struct Stats : WriterThread::Stats
+    {
+        uint64_t dropped;//units not queued
+        uint64_t resyncs;//times the queue overflowed
+    };
+
+    class Destination : public WriterThread
+    {
+    public:
+        Destination(x265::OutputFile *output, const std::string &name, int depth);
+        ~Destination();
+
+        //false when the unit was dropped
+        bool offer(const std::shared_ptr<const FanOutput::Unit> &unit, bool &overflowed);
+        FanOutput::Stats GetStats();
+        const std::string &name() const { return _name; }
+
+    protected:
+        virtual const WriterThread::Unit *front() override;
+        virtual void pop() override;
+
+        std::string _name;
+        //the queue keeps its reference until the write is done
+        std::deque<std::shared_ptr<const FanOutput::Unit>> _queue;
+        int _depth;
+        bool _resync;//dropping until the next IRAP access unit
+        uint64_t _dropped, _resyncs;
+    };
+
+    FanOutput();
+    virtual ~FanOutput();
+    int offer(const x265_nal* nal, uint32_t nalcount, WriterThread::Kind kind, const x265_picture *pic, int64_t pts);
+
+    std::vector<Destination *> _destinations;
+    bool _bStart;//the next unit starts an access unit
+    std::atomic<bool> _refresh;//set by whichever thread writes, taken by the encoding loop
+};
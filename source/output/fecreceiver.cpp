@@ -0,0 +1,173 @@
+#include "fecreceiver.h"
+
+#include <string.h>
+
+#include "common.h"
+#include "fec.h"
+
+using namespace X265_NS;
+
+FecReceiver::FecReceiver(std::function<void(const uint8_t *data, size_t bytes)> onData, uint32_t window)
+    : _onData(onData)
+    , _window(window)
+    , _started(false)
+    , _next(0)
+    , _received(0)
+    , _recovered(0)
+    , _lost(0)
+{}
+
+void FecReceiver::push(const uint8_t *datagram, size_t bytes)
+{
+    if (bytes < FEC_HEADER + FEC_LENGTH)
+    {
+        return;
+    }
+    int index = datagram[0], k = datagram[1], m = datagram[2];
+    uint32_t number = (uint32_t)datagram[4] << 24 | datagram[5] << 16 | datagram[6] << 8 | datagram[7];
+    if (!k || index >= k + m)
+    {
+        return;
+    }
+    if (!_started)
+    {
+        _started = true;
+        _next = number;
+    }
+    //serial number arithmetic, blocks behind _next were passed on already
+    if ((int32_t)(number - _next) < 0)
+    {
+        return;
+    }
+
+    Block &block = _blocks[number];
+    if (block.symbols.empty())
+    {
+        block.k = k;
+        block.m = m;
+        block.count = 0;
+        block.symbols.resize(k + m);
+        block.present.resize(k + m, false);
+    }
+    if (block.k != k || block.m != m || block.present[index])
+    {
+        return;
+    }
+    block.symbols[index].assign(datagram + FEC_HEADER, datagram + bytes);
+    block.present[index] = true;
+    block.count++;
+    _received++;
+
+    while ((int32_t)(number - _blocks.begin()->first) >= (int32_t)_window)
+    {
+        //too far behind, stop waiting for the oldest block
+        complete(_blocks.begin()->second);
+        deliver(_blocks.begin()->second);
+        _next = _blocks.begin()->first + 1;
+        _blocks.erase(_blocks.begin());
+    }
+    drain();
+}
+
+void FecReceiver::flush()
+{
+    for (auto &block : _blocks)
+    {
+        complete(block.second);
+        deliver(block.second);
+        _next = block.first + 1;
+    }
+    _blocks.clear();
+}
+
+bool FecReceiver::complete(Block &block)
+{
+    int missing = 0;
+    for (int i = 0; i < block.k; i++)
+    {
+        missing += !block.present[i];
+    }
+    if (!missing)
+    {
+        return true;
+    }
+    if (block.count < block.k)
+    {
+        return false;
+    }
+
+    //media symbols are zero padded to the parity length for the decode
+    size_t size = 0;
+    for (int i = block.k; i < block.k + block.m; i++)
+    {
+        if (block.present[i])
+        {
+            size = block.symbols[i].size();
+        }
+    }
+    uint8_t *data[FEC_MAX_DATA];
+    bool present[FEC_MAX_DATA];
+    const uint8_t *parity[FEC_MAX_PARITY];
+    int parityIndex[FEC_MAX_PARITY];
+    int numParity = 0;
+    for (int i = 0; i < block.k; i++)
+    {
+        if (block.present[i] && block.symbols[i].size() > size)
+        {
+            return false;//not from the same block
+        }
+        block.symbols[i].resize(size, 0);
+        data[i] = block.symbols[i].data();
+        present[i] = block.present[i];
+    }
+    for (int i = block.k; i < block.k + block.m; i++)
+    {
+        if (block.present[i] && block.symbols[i].size() == size)
+        {
+            parity[numParity] = block.symbols[i].data();
+            parityIndex[numParity++] = i - block.k;
+        }
+    }
+    if (!fecRecover(data, present, block.k, parity, parityIndex, numParity, (intptr_t)size))
+    {
+        return false;
+    }
+    for (int i = 0; i < block.k; i++)
+    {
+        if (!block.present[i])
+        {
+            block.present[i] = true;
+            _recovered++;
+        }
+    }
+    return true;
+}
+
+void FecReceiver::deliver(Block &block)
+{
+    for (int i = 0; i < block.k; i++)
+    {
+        if (!block.present[i])
+        {
+            _lost++;
+            continue;
+        }
+        const std::vector<uint8_t> &symbol = block.symbols[i];
+        size_t length = symbol.size() >= FEC_LENGTH ? symbol[0] << 8 | symbol[1] : 0;
+        if (length && FEC_LENGTH + length <= symbol.size())
+        {
+            _onData(symbol.data() + FEC_LENGTH, length);
+        }
+    }
+}
+
+void FecReceiver::drain()
+{
+    auto it = _blocks.begin();
+    while (it != _blocks.end() && it->first == _next && complete(it->second))
+    {
+        deliver(it->second);
+        _next++;
+        it = _blocks.erase(it);
+    }
+}
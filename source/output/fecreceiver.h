@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* Datagram layout of udp://...?fec=. An access unit is cut into symbols
+ * that fill at most one datagram of the sender's mtu, so none is split
+ * into IP fragments, grouped into blocks of up to <media> symbols, each
+ * block followed by its parity datagrams. A datagram
+ * is the FEC_HEADER
+ *   index in block, media count k, parity count m, 0, block number (32 BE)
+ * then for media a 16 bit big endian payload length and the payload, for
+ * parity the parity of the media symbols zero padded to the longest one */
+enum { FEC_HEADER = 8 };
+enum { FEC_LENGTH = 2 };
+
+/* Reassembles the byte stream of a udp://...?fec= sender, recovering lost
+ * media datagrams from parity (common/fec.h, primitives must have been set
+ * up by x265_setup_primitives). onData receives media payloads in stream
+ * order. A block that still misses data when a block window newer one
+ * arrives is given up, what did arrive of it is passed on so the decoder
+ * resyncs at the next start code */
+class FecReceiver
+{
+public:
+    FecReceiver(std::function<void(const uint8_t *data, size_t bytes)> onData, uint32_t window = 8);
+
+    void push(const uint8_t *datagram, size_t bytes);
+    //passes on everything still held, complete or not
+    void flush();
+
+    uint64_t received() const { return _received; }
+    uint64_t recovered() const { return _recovered; }
+    uint64_t lost() const { return _lost; }
+
+protected:
+    struct Block
+    {
+        int k, m;
+        int count;//symbols present
+        std::vector<std::vector<uint8_t>> symbols;//k media then m parity
+        std::vector<bool> present;
+    };
+
+    bool complete(Block &block);
+    void deliver(Block &block);
+    void drain();
+
+    std::function<void(const uint8_t *data, size_t bytes)> _onData;
+    uint32_t _window;
+    bool _started;
+    uint32_t _next;//first block not passed on
+    std::map<uint32_t, Block> _blocks;
+    uint64_t _received, _recovered, _lost;
+};
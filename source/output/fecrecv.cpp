@@ -0,0 +1,119 @@
+/* Test receiver for udp://ip:port?fec=: fecrecv [-drop percent] [-seed n]
+ * port [file.hevc] listens on port and throws away the given share of the
+ * datagrams at random, as a lossy network would, before handing the rest
+ * to FecReceiver. What it recovers goes to file, if given. It stops after
+ * a second without datagrams and prints how many were lost and recovered */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common.h"
+#include "fecreceiver.h"
+
+using namespace X265_NS;
+
+int main(int argc, char **argv)
+{
+    double drop = 0;
+    unsigned int seed = 1;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (!strcmp(argv[arg], "-drop"))
+        {
+            drop = atof(argv[arg + 1]);
+        }
+        else if (!strcmp(argv[arg], "-seed"))
+        {
+            seed = (unsigned int)atoi(argv[arg + 1]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (arg >= argc || argc > arg + 2 || drop < 0 || drop > 100)
+    {
+        fprintf(stderr, "usage: %s [-drop percent] [-seed n] port [file.hevc]\n", argv[0]);
+        return 1;
+    }
+    FILE *out = nullptr;
+    if (argc == arg + 2)
+    {
+        out = fopen(argv[arg + 1], "wb");
+        if (!out)
+        {
+            fprintf(stderr, "unable to open %s\n", argv[arg + 1]);
+            return 1;
+        }
+    }
+
+    //FecReceiver recovers with the gfmuladd primitives
+    x265_param param;
+    x265_param_default(&param);
+    x265_setup_primitives(&param);
+
+    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    sa.sin_port = htons((unsigned short)atoi(argv[arg]));
+    int buffer = 8 << 20;
+    struct timeval timeout = { 1, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof buffer);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    if (sock == -1 || bind(sock, (struct sockaddr *)&sa, sizeof sa))
+    {
+        fprintf(stderr, "unable to listen on port %s: %s\n", argv[arg], strerror(errno));
+        return 1;
+    }
+
+    unsigned long long bytes = 0;
+    FecReceiver receiver([&](const uint8_t *data, size_t len)
+    {
+        bytes += len;
+        if (out)
+        {
+            fwrite(data, 1, len, out);
+        }
+    });
+    unsigned long long datagrams = 0, dropped = 0;
+    std::vector<uint8_t> datagram(65536);
+    for (;;)
+    {
+        ssize_t len = recv(sock, datagram.data(), datagram.size(), 0);
+        if (len < 0)
+        {
+            //wait as long as it takes for the first datagram
+            if (errno == EINTR || ((errno == EAGAIN || errno == EWOULDBLOCK) && !datagrams))
+            {
+                continue;
+            }
+            break;
+        }
+        datagrams++;
+        if (rand_r(&seed) < drop / 100 * RAND_MAX)
+        {
+            dropped++;
+            continue;
+        }
+        receiver.push(datagram.data(), (size_t)len);
+    }
+    receiver.flush();
+    close(sock);
+    printf("%llu datagrams, %llu dropped, %llu symbols received, %llu recovered, %llu lost, %llu bytes\n",
+           datagrams, dropped, (unsigned long long)receiver.received(), (unsigned long long)receiver.recovered(),
+           (unsigned long long)receiver.lost(), bytes);
+    if (out)
+    {
+        fclose(out);
+    }
+    return 0;
+}
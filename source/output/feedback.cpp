@@ -0,0 +1,349 @@
+#include "feedback.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace X265_NS;
+
+enum { RTCP_SR = 200, RTCP_RR = 201, RTCP_PSFB = 206 };
+enum { RTCP_PLI_FMT = 1, RTCP_FIR_FMT = 4, RTCP_REMB_FMT = 15 };
+enum { RTP_CLOCK = 90000 };//the video clock RtpWriter stamps with, jitter is in its units
+
+constexpr double CongestionController::LOSS_OVERUSE;
+constexpr double CongestionController::LOSS_UNDERUSE;
+constexpr double CongestionController::INCREASE_PER_SECOND;
+constexpr double CongestionController::JITTER_MARGIN;
+constexpr int64_t CongestionController::REFRESH_INTERVAL;
+constexpr double FeedbackListener::CHANGE_THRESHOLD;
+
+CongestionController::CongestionController(double initial, double minimum, double maximum)
+    : _target(initial)
+    , _min(minimum)
+    , _max(maximum)
+    , _jitterFloor(-1)
+    , _lastReport(0)
+    , _lastRefresh(-REFRESH_INTERVAL)
+    , _refresh(false)
+{}
+
+void CongestionController::onReport(const FeedbackReport &report, int64_t now)
+{
+    double seconds = _lastReport ? std::min((now - _lastReport) / 1e6, 1.0) : 0;
+    _lastReport = now;
+
+    bool overuse = report.loss > LOSS_OVERUSE;
+    if (report.jitter >= 0)
+    {
+        //the floor creeps up so a path that became slower becomes the norm
+        if (_jitterFloor < 0 || report.jitter < _jitterFloor)
+        {
+            _jitterFloor = report.jitter;
+        }
+        else
+        {
+            _jitterFloor += (report.jitter - _jitterFloor) * 0.05 * seconds;
+        }
+        overuse |= report.jitter > 2 * _jitterFloor + JITTER_MARGIN;
+    }
+
+    if (overuse)
+    {
+        _target *= 1 - 0.5 * std::max(report.loss, LOSS_OVERUSE);
+        if (report.receiveRate > 0)
+        {
+            _target = std::min(_target, report.receiveRate);
+        }
+    }
+    else if (report.loss >= LOSS_UNDERUSE)
+    {
+        //some loss, settle at what gets through
+        if (report.receiveRate > 0)
+        {
+            _target = std::min(_target, report.receiveRate);
+        }
+    }
+    else if (report.loss >= 0)
+    {
+        double grown = _target * pow(INCREASE_PER_SECOND, seconds);
+        if (report.receiveRate > 0)
+        {
+            grown = std::min(grown, std::max(_target, 1.5 * report.receiveRate));
+        }
+        _target = grown;
+    }
+    if (report.estimate > 0)
+    {
+        _target = std::min(_target, report.estimate);
+    }
+    _target = std::max(_min, std::min(_target, _max));
+
+    if (report.pictureLoss && now - _lastRefresh >= REFRESH_INTERVAL)
+    {
+        _refresh = true;
+        _lastRefresh = now;
+    }
+}
+
+bool CongestionController::takeRefresh()
+{
+    bool refresh = _refresh;
+    _refresh = false;
+    return refresh;
+}
+
+FeedbackListener::FeedbackListener(double initial, double minimum, double maximum)
+    : _sock(-1)
+    , _stopping(false)
+    , _controller(initial, minimum, maximum)
+    , _applied(initial)
+{
+    memset(&_stats, 0, sizeof _stats);
+}
+
+FeedbackListener::~FeedbackListener()
+{
+    if (_sock != -1)
+    {
+        _lock.acquire();
+        _stopping = true;
+        _lock.release();
+        stop();
+        close(_sock);
+    }
+}
+
+FeedbackListener *FeedbackListener::construct(const char *address, double initial, double minimum, double maximum)
+{
+    std::string ip = "0.0.0.0";
+    const char *port = address;
+    const char *colon = strrchr(address, ':');
+    if (colon)
+    {
+        ip.assign(address, colon - address);
+        port = colon + 1;
+    }
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((unsigned short)atoi(port));
+    if (!atoi(port) || inet_pton(AF_INET, ip.c_str(), &sa.sin_addr) != 1)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "feedback: invalid address %s, expected [ip:]port\n", address);
+        return nullptr;
+    }
+
+    auto listener = new FeedbackListener(initial, minimum, maximum);
+    listener->_sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (listener->_sock == -1 || bind(listener->_sock, (struct sockaddr *)&sa, sizeof sa))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "feedback: unable to listen on %s: %s\n", address, strerror(errno));
+        if (listener->_sock != -1)
+        {
+            close(listener->_sock);
+            listener->_sock = -1;
+        }
+        delete listener;
+        return nullptr;
+    }
+    if (!listener->start())
+    {
+        x265_log(NULL, X265_LOG_ERROR, "feedback: unable to start the listener thread\n");
+        close(listener->_sock);
+        listener->_sock = -1;
+        delete listener;
+        return nullptr;
+    }
+    return listener;
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+bool FeedbackListener::parseReport(const uint8_t *data, size_t bytes, FeedbackReport &report, std::map<uint32_t, uint32_t> &cumulativeLost)
+{
+    report.loss = report.jitter = report.receiveRate = report.estimate = -1;
+    report.lost = -1;
+    report.lostPicture = -1;
+    report.pictureLoss = false;
+    bool known = false;
+
+    if (bytes >= 4 && (data[0] & 0xC0) == 0x80)
+    {
+        //RTCP compound packet, version 2
+        for (size_t offset = 0; offset + 4 <= bytes; )
+        {
+            const uint8_t *p = data + offset;
+            int count = p[0] & 0x1F;
+            int type = p[1];
+            size_t length = ((size_t)(p[2] << 8 | p[3]) + 1) * 4;
+            if ((p[0] & 0xC0) != 0x80 || offset + length > bytes)
+            {
+                break;
+            }
+            if (type == RTCP_SR || type == RTCP_RR)
+            {
+                size_t block = type == RTCP_SR ? 28 : 8;
+                for (int b = 0; b < count && block + 24 <= length; b++, block += 24)
+                {
+                    const uint8_t *rb = p + block;
+                    uint32_t ssrc = read32(rb);
+                    uint32_t cumulative = (uint32_t)rb[5] << 16 | rb[6] << 8 | rb[7];
+                    auto previous = cumulativeLost.find(ssrc);
+                    int64_t lost = previous == cumulativeLost.end() ? 0 : std::max<int64_t>((int64_t)cumulative - previous->second, 0);
+                    cumulativeLost[ssrc] = cumulative;
+
+                    report.loss = std::max(report.loss, rb[4] / 256.0);
+                    report.jitter = std::max(report.jitter, read32(rb + 12) * 1000.0 / RTP_CLOCK);
+                    report.lost = std::max(report.lost, lost);
+                    known = true;
+                }
+            }
+            else if (type == RTCP_PSFB && count == RTCP_REMB_FMT && length >= 20 && !memcmp(p + 12, "REMB", 4))
+            {
+                int exponent = p[17] >> 2;
+                uint32_t mantissa = (uint32_t)(p[17] & 3) << 16 | p[18] << 8 | p[19];
+                report.estimate = ldexp(mantissa, exponent) / 1000;
+                known = true;
+            }
+            else if (type == RTCP_PSFB && (count == RTCP_PLI_FMT || count == RTCP_FIR_FMT) && length >= 12)
+            {
+                report.pictureLoss = true;
+                known = true;
+            }
+            offset += length;
+        }
+        return known;
+    }
+
+    std::string text((const char *)data, bytes);
+    size_t start = 0;
+    while ((start = text.find_first_not_of(" \t\r\n", start)) != std::string::npos)
+    {
+        size_t end = text.find_first_of(" \t\r\n", start);
+        std::string pair = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end;
+        size_t eq = pair.find('=');
+        if (eq == std::string::npos)
+        {
+            return false;
+        }
+        std::string key = pair.substr(0, eq);
+        double value = atof(pair.c_str() + eq + 1);
+        if (key == "loss")
+        {
+            report.loss = value;
+        }
+        else if (key == "jitter")
+        {
+            report.jitter = value;
+        }
+        else if (key == "rate")
+        {
+            report.receiveRate = value;
+        }
+        else if (key == "estimate")
+        {
+            report.estimate = value;
+        }
+        else if (key == "lost")
+        {
+            report.lost = (int64_t)value;
+        }
+        else if (key == "lostpoc")
+        {
+            report.lostPicture = atoi(pair.c_str() + eq + 1);
+        }
+        else if (key == "pli")
+        {
+            report.pictureLoss = value != 0;
+        }
+        else
+        {
+            continue;
+        }
+        known = true;
+    }
+    return known;
+}
+
+void FeedbackListener::threadMain()
+{
+    std::vector<uint8_t> buffer(2048);
+    for (;;)
+    {
+        {
+            ScopedLock lock(_lock);
+            if (_stopping)
+            {
+                return;
+            }
+        }
+        //wake up now and then to notice _stopping
+        struct pollfd fd = { _sock, POLLIN, 0 };
+        if (::poll(&fd, 1, 100) <= 0)
+        {
+            continue;
+        }
+        ssize_t bytes = recv(_sock, buffer.data(), buffer.size(), 0);
+        if (bytes <= 0)
+        {
+            continue;
+        }
+
+        FeedbackReport report;
+        ScopedLock lock(_lock);
+        if (!parseReport(buffer.data(), (size_t)bytes, report, _cumulativeLost))
+        {
+            _stats.invalid++;
+            continue;
+        }
+        _stats.reports++;
+        _controller.onReport(report, x265_mdate());
+        if (report.lostPicture >= 0)
+        {
+            _lostPictures.push_back(report.lostPicture);
+            _stats.lostPictures++;
+        }
+    }
+}
+
+bool FeedbackListener::poll(double &target, bool &refresh)
+{
+    ScopedLock lock(_lock);
+    refresh = _controller.takeRefresh();
+    target = _controller.target();
+    _stats.refreshes += refresh;
+    return fabs(target - _applied) > _applied * CHANGE_THRESHOLD;
+}
+
+void FeedbackListener::applied(double target)
+{
+    ScopedLock lock(_lock);
+    _applied = target;
+    _stats.changes++;
+}
+
+bool FeedbackListener::takeLostPictures(std::vector<int> &pocs)
+{
+    ScopedLock lock(_lock);
+    pocs.swap(_lostPictures);
+    _lostPictures.clear();
+    return !pocs.empty();
+}
+
+FeedbackListener::Stats FeedbackListener::GetStats()
+{
+    ScopedLock lock(_lock);
+    return _stats;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "common.h"
+#include "threading.h"
+
+/* One receiver report. Fields the report did not carry are negative */
+struct FeedbackReport
+{
+    double loss;//fraction of packets lost since the previous report
+    double jitter;//interarrival jitter, milliseconds
+    double receiveRate;//kbps arriving at the receiver
+    double estimate;//kbps the receiver believes the path carries, REMB
+    int64_t lost;//packets lost since the previous report and not recovered
+    int lostPicture;//POC of a picture the receiver could not decode
+    bool pictureLoss;//the receiver cannot decode on, RTCP PLI or FIR
+};
+
+/* Turns receiver reports into a target bitrate and intra refresh requests.
+ * Loss above LOSS_OVERUSE, or jitter well above its running floor, is
+ * overuse and cuts the target by half the loss, never keeping it above
+ * what the receiver sees arrive. Loss below LOSS_UNDERUSE grows it by
+ * INCREASE_PER_SECOND, up to 1.5 times the receive rate so an encoder that
+ * undershoots does not build up headroom it never tested. In between the
+ * target holds, at most at the receive rate, and so it does for reports
+ * without a loss figure. A REMB estimate caps the target, which stays
+ * within [min, max]. Lost packets alone are left to FEC, retransmission and
+ * reference invalidation, only picture loss asks for a refresh, at most
+ * one per REFRESH_INTERVAL */
+class CongestionController
+{
+public:
+    CongestionController(double initial, double minimum, double maximum);
+
+    void onReport(const FeedbackReport &report, int64_t now);
+    double target() const { return _target; }
+    //true once per requested refresh
+    bool takeRefresh();
+
+protected:
+    static constexpr double LOSS_OVERUSE = 0.10;
+    static constexpr double LOSS_UNDERUSE = 0.02;
+    static constexpr double INCREASE_PER_SECOND = 2;
+    static constexpr double JITTER_MARGIN = 10;//milliseconds over twice the floor
+    static constexpr int64_t REFRESH_INTERVAL = 1000000;//microseconds
+
+    double _target, _min, _max;
+    double _jitterFloor;//slowly rising minimum, -1 before the first jitter
+    int64_t _lastReport;//microseconds, 0 before the first report
+    int64_t _lastRefresh;
+    bool _refresh;
+};
+
+/* Back channel of the udp and rtp outputs, --feedback [ip:]port. A thread
+ * receives reports there and feeds a CongestionController, the encoding
+ * loop polls it between pictures. Reports are RTCP compound packets, of
+ * which receiver and sender report blocks give loss and jitter, REMB gives
+ * the estimate and PLI or FIR picture loss, or text of space separated
+ * key=value pairs, loss=<fraction> jitter=<ms> rate=<kbps> estimate=<kbps>
+ * lost=<packets> lostpoc=<picture number> pli=1. Lost pictures are queued
+ * for the encoder to stop referencing rather than turned into refresh
+ * requests */
+class FeedbackListener : public x265::Thread
+{
+public:
+    //NULL if the address cannot be bound or the thread does not start
+    static FeedbackListener *construct(const char *address, double initial, double minimum, double maximum);
+    ~FeedbackListener();
+
+    //true when the target moved by more than CHANGE_THRESHOLD from the one
+    //last applied. refresh tells whether the receiver asked for one
+    bool poll(double &target, bool &refresh);
+    //the encoder took target, poll compares with it from now on
+    void applied(double target);
+    //moves the lost pictures reported since the last call into pocs
+    bool takeLostPictures(std::vector<int> &pocs);
+
+    static bool parseReport(const uint8_t *data, size_t bytes, FeedbackReport &report, std::map<uint32_t, uint32_t> &cumulativeLost);
+
+    struct Stats
+    {
+        uint64_t reports;
+        uint64_t invalid;//datagrams that were no report
+        uint64_t changes;//targets applied
+        uint64_t refreshes;
+        uint64_t lostPictures;
+    };
+    Stats GetStats();
+
+protected:
+    static constexpr double CHANGE_THRESHOLD = 0.05;
+
+    FeedbackListener(double initial, double minimum, double maximum);
+    virtual void threadMain() override;
+
+    int _sock;
+    bool _stopping;
+    CongestionController _controller;
+    double _applied;
+    std::map<uint32_t, uint32_t> _cumulativeLost;//per reported SSRC
+    std::vector<int> _lostPictures;
+    Stats _stats;
+    x265::Lock _lock;//guards _controller, _stopping and _stats
+};
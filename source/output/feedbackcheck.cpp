@@ -0,0 +1,287 @@
+/* Test driver for --feedback: feedbackcheck [-drop percent] [-seed n] [port]
+ * parses RTCP receiver reports, REMB, PLI and text reports, then runs a
+ * FeedbackListener on the loopback port against a receiver stub. The stub
+ * plays a link whose capacity steps down and back up, drops what the
+ * sender puts over capacity plus the given share of packets at random, and
+ * reports loss, receive rate and lost packets every REPORT_INTERVAL. The
+ * target must follow the capacity within a second and lost packets must
+ * not ask for refreshes, PLIs do, at most one a second. Prints every check
+ * and returns the number that failed */
+#include <algorithm>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common.h"
+#include "feedback.h"
+
+using namespace X265_NS;
+
+enum { REPORT_INTERVAL = 100000 };//microseconds
+enum { PACKET_BYTES = 300 };
+
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+    failures += !ok;
+}
+
+//receiver report with one block for SSRC 9.9.9.9, and REMB
+static std::vector<uint8_t> rtcpReport(uint8_t fraction, uint32_t cumulative, uint32_t jitter, uint32_t remb)
+{
+    std::vector<uint8_t> p = { 0x81, 201, 0, 7, 1, 2, 3, 4, 9, 9, 9, 9, fraction,
+                               (uint8_t)(cumulative >> 16), (uint8_t)(cumulative >> 8), (uint8_t)cumulative,
+                               0, 0, 0, 100,
+                               (uint8_t)(jitter >> 24), (uint8_t)(jitter >> 16), (uint8_t)(jitter >> 8), (uint8_t)jitter,
+                               0, 0, 0, 0, 0, 0, 0, 0 };
+    if (remb)
+    {
+        int exponent = 0;
+        while (remb >> exponent > 0x3FFFF)
+        {
+            exponent++;
+        }
+        uint32_t mantissa = remb >> exponent;
+        std::vector<uint8_t> psfb = { 0x8f, 206, 0, 4, 1, 2, 3, 4, 0, 0, 0, 0, 'R', 'E', 'M', 'B', 1,
+                                      (uint8_t)(exponent << 2 | mantissa >> 16), (uint8_t)(mantissa >> 8), (uint8_t)mantissa };
+        p.insert(p.end(), psfb.begin(), psfb.end());
+    }
+    return p;
+}
+
+//picture loss indication, PSFB fmt 1, or full intra request, fmt 4
+static std::vector<uint8_t> rtcpPictureLoss(bool fir)
+{
+    std::vector<uint8_t> p = { 0x81, 206, 0, 2, 1, 2, 3, 4, 9, 9, 9, 9 };
+    if (fir)
+    {
+        std::vector<uint8_t> entry = { 9, 9, 9, 9, 1, 0, 0, 0 };
+        p[0] = 0x84;
+        p[3] = 4;
+        p[11] = 0;
+        p.insert(p.end(), entry.begin(), entry.end());
+    }
+    return p;
+}
+
+static void checkParse()
+{
+    FeedbackReport report;
+    std::map<uint32_t, uint32_t> cumulativeLost;
+
+    //25% lost, 3600 ticks of jitter, 1024000 bps
+    std::vector<uint8_t> rtcp = rtcpReport(64, 5, 3600, 1024000);
+    check(FeedbackListener::parseReport(rtcp.data(), rtcp.size(), report, cumulativeLost), "receiver report and REMB parse");
+    check(report.loss == 0.25 && report.jitter == 40 && report.estimate == 1024, "loss, jitter in ms and estimate in kbps");
+    check(report.lost == 0 && !report.pictureLoss, "first report has no lost packets to compare with");
+    rtcp = rtcpReport(0, 9, 0, 0);
+    FeedbackListener::parseReport(rtcp.data(), rtcp.size(), report, cumulativeLost);
+    check(report.lost == 4 && report.estimate < 0, "lost packets counted from the cumulative number");
+    rtcp = rtcpPictureLoss(false);
+    check(FeedbackListener::parseReport(rtcp.data(), rtcp.size(), report, cumulativeLost) && report.pictureLoss &&
+          report.loss < 0, "PLI parses as picture loss alone");
+    rtcp = rtcpPictureLoss(true);
+    check(FeedbackListener::parseReport(rtcp.data(), rtcp.size(), report, cumulativeLost) && report.pictureLoss, "FIR parses as picture loss");
+
+    const char *text = "loss=0.3 jitter=7 rate=1000 estimate=900 lost=4 lostpoc=12";
+    check(FeedbackListener::parseReport((const uint8_t *)text, strlen(text), report, cumulativeLost), "text report parses");
+    check(report.loss == 0.3 && report.jitter == 7 && report.receiveRate == 1000 && report.estimate == 900 &&
+          report.lost == 4 && report.lostPicture == 12 && !report.pictureLoss, "text report fields");
+    check(FeedbackListener::parseReport((const uint8_t *)"pli=1", 5, report, cumulativeLost) && report.pictureLoss, "text picture loss");
+    check(!FeedbackListener::parseReport((const uint8_t *)"hello", 5, report, cumulativeLost), "text without key=value rejected");
+}
+
+struct Stub
+{
+    int sock;
+    struct sockaddr_in listener;
+
+    void send(const void *data, size_t bytes)
+    {
+        sendto(sock, data, bytes, 0, (struct sockaddr *)&listener, sizeof listener);
+    }
+};
+
+//waits for the listener thread to take reports datagrams
+static bool settle(FeedbackListener &listener, uint64_t datagrams)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        FeedbackListener::Stats stats = listener.GetStats();
+        if (stats.reports + stats.invalid >= datagrams)
+        {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+static void checkListener(Stub &stub, const char *address)
+{
+    FeedbackListener *listener = FeedbackListener::construct(address, 4000, 250, 4000);
+    check(listener, "listener binds");
+    if (!listener)
+    {
+        return;
+    }
+    double target;
+    bool refresh;
+    check(!listener->poll(target, refresh) && target == 4000, "no change before any report");
+
+    //a quarter lost is overuse, REMB caps what is left. The first report
+    //only sets where the cumulative count starts
+    std::vector<uint8_t> rtcp = rtcpReport(0, 0, 0, 0);
+    stub.send(rtcp.data(), rtcp.size());
+    rtcp = rtcpReport(64, 5, 0, 1024000);
+    stub.send(rtcp.data(), rtcp.size());
+    stub.send("junk", 4);
+    settle(*listener, 3);
+    check(listener->poll(target, refresh) && target == 1024 && !refresh, "receiver report with REMB cuts the target, lost packets ask for no refresh");
+    listener->applied(target);
+    check(!listener->poll(target, refresh), "nothing new once applied");
+
+    //a refresh alone is no new target
+    rtcp = rtcpPictureLoss(false);
+    stub.send(rtcp.data(), rtcp.size());
+    settle(*listener, 4);
+    check(!listener->poll(target, refresh) && target == 1024 && refresh, "PLI asks for a refresh and leaves the target");
+
+    //the next refresh waits for REFRESH_INTERVAL
+    const char *text = "loss=0.3 rate=800 lost=4 lostpoc=12 pli=1";
+    stub.send(text, strlen(text));
+    settle(*listener, 5);
+    check(listener->poll(target, refresh) && target == 800 && !refresh, "text report lowers the target to the receive rate, no second refresh yet");
+    listener->applied(target);
+    std::vector<int> pocs;
+    check(listener->takeLostPictures(pocs) && pocs.size() == 1 && pocs[0] == 12, "lost picture queued");
+
+    //without a loss figure nothing says the path has room
+    usleep(200000);
+    text = "jitter=5 rate=800";
+    stub.send(text, strlen(text));
+    settle(*listener, 6);
+    check(!listener->poll(target, refresh) && target == 800, "report without loss holds the target");
+
+    FeedbackListener::Stats stats = listener->GetStats();
+    check(stats.reports == 5 && stats.invalid == 1 && stats.refreshes == 1 && stats.lostPictures == 1 && stats.changes == 2,
+          "listener statistics");
+    delete listener;
+}
+
+static void checkTracking(Stub &stub, const char *address, double drop, unsigned int seed)
+{
+    FeedbackListener *listener = FeedbackListener::construct(address, 4000, 250, 4000);
+    if (!listener)
+    {
+        check(false, "listener binds");
+        return;
+    }
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    //capacity drops to 1500 kbps at 1 s and rises to 3000 kbps at 3 s
+    const int reports = 50;
+    double sending = 4000;
+    int refreshes = 0;
+    bool followedDown = true, followedUp = false;
+    int64_t start = x265_mdate();
+    for (int i = 1; i <= reports; i++)
+    {
+        double capacity = i <= 10 ? 4000 : i <= 30 ? 1500 : 3000;
+        int packets = (int)(sending * REPORT_INTERVAL / 1000 / (PACKET_BYTES * 8));
+        double overflow = std::max(0.0, 1 - capacity / sending);
+        int lost = 0;
+        for (int p = 0; p < packets; p++)
+        {
+            lost += uniform(rng) < overflow || uniform(rng) < drop / 100;
+        }
+        double rate = (packets - lost) * PACKET_BYTES * 8 * 1000.0 / REPORT_INTERVAL;
+        char text[128];
+        snprintf(text, sizeof text, "loss=%.3f rate=%.0f lost=%d jitter=5", packets ? (double)lost / packets : 0, rate, lost);
+
+        int64_t due = start + (int64_t)i * REPORT_INTERVAL;
+        int64_t now = x265_mdate();
+        if (due > now)
+        {
+            usleep((useconds_t)(due - now));
+        }
+        stub.send(text, strlen(text));
+        settle(*listener, (uint64_t)i);
+
+        //as the encoding loop does between pictures
+        double target;
+        bool refresh;
+        if (listener->poll(target, refresh))
+        {
+            listener->applied(target);
+            sending = target;
+        }
+        refreshes += refresh;
+        if (i > 20 && i <= 30)
+        {
+            followedDown &= sending <= 1.1 * capacity;
+        }
+        if (i > 30 && i <= 40)
+        {
+            followedUp |= sending >= 0.8 * capacity;
+        }
+        printf("%4.1fs capacity %4.0f sending %4.0f lost %3d%s\n", i / 10.0, capacity, sending, lost, refresh ? " refresh" : "");
+    }
+    check(followedDown, "target within 10% of the lower capacity a second after the drop");
+    check(followedUp, "target reaches 80% of the higher capacity within a second of the rise");
+    check(!refreshes, "lost packets alone ask for no refresh");
+    delete listener;
+}
+
+int main(int argc, char **argv)
+{
+    double drop = 1;
+    unsigned int seed = 1;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (!strcmp(argv[arg], "-drop"))
+        {
+            drop = atof(argv[arg + 1]);
+        }
+        else if (!strcmp(argv[arg], "-seed"))
+        {
+            seed = (unsigned int)atoi(argv[arg + 1]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (argc > arg + 1 || drop < 0 || drop > 100 || (argc == arg + 1 && !atoi(argv[arg])))
+    {
+        fprintf(stderr, "usage: %s [-drop percent] [-seed n] [port]\n", argv[0]);
+        return 1;
+    }
+    int port = argc == arg + 1 ? atoi(argv[arg]) : 17990;
+    char address[32];
+    snprintf(address, sizeof address, "127.0.0.1:%d", port);
+
+    Stub stub;
+    stub.sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    memset(&stub.listener, 0, sizeof stub.listener);
+    stub.listener.sin_family = AF_INET;
+    stub.listener.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    stub.listener.sin_port = htons((unsigned short)port);
+
+    checkParse();
+    checkListener(stub, address);
+    checkTracking(stub, address, drop, seed);
+    close(stub.sock);
+    printf("%d failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,551 @@
+#include "mp4.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+
+using namespace X265_NS;
+
+namespace {
+//trun sample flags: depends on others or not, and whether it is a sync sample
+enum
+{
+    SAMPLE_SYNC = 0x02000000,
+    SAMPLE_NON_SYNC = 0x01010000,
+};
+
+const uint8_t MATRIX[36] =
+{
+    0, 1, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+    0, 0, 0, 0,  0, 1, 0, 0,  0, 0, 0, 0,
+    0, 0, 0, 0,  0, 0, 0, 0,  0x40, 0, 0, 0,
+};
+
+bool isIrap(int type)
+{
+    return type >= NAL_UNIT_CODED_SLICE_BLA_W_LP && type <= NAL_UNIT_CODED_SLICE_CRA;
+}
+}//namespace
+
+Mp4Writer::Mp4Writer()
+    : _fd(-1)
+    , _bGop(true)
+    , _offset(0)
+    , _fragmentStart(0)
+    , _capacity(0)
+    , _mdatBytes(0)
+    , _decodeTime(0)
+    , _sequence(0)
+    , _started(false)
+    , _firstDts(0)
+    , _firstPts(0)
+    , _width(0)
+    , _height(0)
+    , _fpsNum(0)
+    , _fpsDenom(0)
+    , _chroma(X265_CSP_I420)
+    , _bitDepth(8)
+    , _keyframeMax(250)
+    , _bRepeatHeaders(false)
+{}
+
+Mp4Writer::~Mp4Writer()
+{
+    if (_fd != -1 && _fd != STDOUT_FILENO)
+    {
+        close(_fd);
+    }
+}
+
+Mp4Writer *Mp4Writer::construct(const char* fname)
+{
+    std::string path = strncmp(fname, MP4, strlen(MP4)) ? fname : fname + strlen(MP4);
+    auto out = new Mp4Writer();
+    std::size_t query = path.find('?');
+    if (query != std::string::npos)
+    {
+        std::string option = path.substr(query + 1);
+        path.resize(query);
+        if (option == "fragment=frame")
+        {
+            out->_bGop = false;
+        }
+        else if (option != "fragment=gop")
+        {
+            std::cout << "Invalid mp4 option " << option << ", expected fragment=gop or fragment=frame\n";
+            delete out;
+            return nullptr;
+        }
+    }
+    if (path == "-")
+    {
+        if (out->_bGop)
+        {
+            std::cout << "mp4 to a pipe needs fragment=frame, GOP fragments are completed in place\n";
+            delete out;
+            return nullptr;
+        }
+        out->_fd = STDOUT_FILENO;
+        return out;
+    }
+    out->_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out->_fd == -1)
+    {
+        std::cout << "Unable to open " << path << ": " << strerror(errno) << "\n";
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+void Mp4Writer::setParam(x265_param* param)
+{
+    //MP4 samples are length prefixed NAL units, have the encoder write them so
+    param->bAnnexB = false;
+    _width = param->sourceWidth;
+    _height = param->sourceHeight;
+    _fpsNum = param->fpsNum ? param->fpsNum : 25;
+    _fpsDenom = param->fpsDenom ? param->fpsDenom : 1;
+    _chroma = param->internalCsp;
+    _bitDepth = param->internalBitDepth;
+    _keyframeMax = param->keyframeMax > 0 ? param->keyframeMax : 250;
+    _bRepeatHeaders = !!param->bRepeatHeaders;
+}
+
+void Mp4Writer::put16(uint32_t v)
+{
+    put8(v >> 8);
+    put8(v);
+}
+
+void Mp4Writer::put32(uint32_t v)
+{
+    put16(v >> 16);
+    put16(v);
+}
+
+void Mp4Writer::put64(uint64_t v)
+{
+    put32((uint32_t)(v >> 32));
+    put32((uint32_t)v);
+}
+
+void Mp4Writer::putFourcc(const char *fourcc)
+{
+    _box.insert(_box.end(), fourcc, fourcc + 4);
+}
+
+void Mp4Writer::begin(const char *type)
+{
+    _open.push_back(_box.size());
+    put32(0);
+    putFourcc(type);
+}
+
+void Mp4Writer::end()
+{
+    size_t start = _open.back();
+    _open.pop_back();
+    uint32_t size = (uint32_t)(_box.size() - start);
+    _box[start] = (uint8_t)(size >> 24);
+    _box[start + 1] = (uint8_t)(size >> 16);
+    _box[start + 2] = (uint8_t)(size >> 8);
+    _box[start + 3] = (uint8_t)size;
+}
+
+void Mp4Writer::putHvcC(const x265_nal* nal, uint32_t nalcount)
+{
+    /* profile_tier_level follows the first byte of the SPS RBSP, unescape
+     * enough of it for the 12 bytes of general profile and level */
+    uint8_t ptl[13] = { 0 };
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        if (nal[i].type != NAL_UNIT_SPS)
+        {
+            continue;
+        }
+        const uint8_t *p = nal[i].payload + 4 + 2;
+        const uint8_t *last = nal[i].payload + nal[i].sizeBytes;
+        int zeros = 0;
+        for (size_t n = 0; n < sizeof ptl && p < last; p++)
+        {
+            if (zeros >= 2 && *p == 3)
+            {
+                zeros = 0;
+                continue;
+            }
+            zeros = *p ? 0 : zeros + 1;
+            ptl[n++] = *p;
+        }
+    }
+    int subLayers = ((ptl[0] >> 1) & 7) + 1;
+
+    begin("hvcC");
+    put8(1);//configurationVersion
+    _box.insert(_box.end(), ptl + 1, ptl + 13);//profile, compatibility, constraints, level
+    put16(0xf000);//min_spatial_segmentation_idc
+    put8(0xfc);//parallelismType
+    put8(0xfc | _chroma);
+    put8(0xf8 | (_bitDepth - 8));
+    put8(0xf8 | (_bitDepth - 8));
+    put16(0);//avgFrameRate
+    put8((subLayers << 3) | ((ptl[0] & 1) << 2) | 3);//4 byte NAL lengths
+    static const int types[] = { NAL_UNIT_VPS, NAL_UNIT_SPS, NAL_UNIT_PPS, NAL_UNIT_PREFIX_SEI };
+    int arrays = 0;
+    for (int type : types)
+    {
+        for (uint32_t i = 0; i < nalcount; i++)
+        {
+            if (nal[i].type == (uint32_t)type)
+            {
+                arrays++;
+                break;
+            }
+        }
+    }
+    put8(arrays);
+    for (int type : types)
+    {
+        size_t count = _box.size() + 1;
+        uint32_t nalus = 0;
+        for (uint32_t i = 0; i < nalcount; i++)
+        {
+            if (nal[i].type != (uint32_t)type)
+            {
+                continue;
+            }
+            if (!nalus)
+            {
+                //complete unless the samples repeat them
+                put8((type == NAL_UNIT_PREFIX_SEI || _bRepeatHeaders ? 0 : 0x80) | type);
+                put16(0);
+            }
+            nalus++;
+            put16(nal[i].sizeBytes - 4);
+            _box.insert(_box.end(), nal[i].payload + 4, nal[i].payload + nal[i].sizeBytes);
+        }
+        if (nalus)
+        {
+            _box[count] = (uint8_t)(nalus >> 8);
+            _box[count + 1] = (uint8_t)nalus;
+        }
+    }
+    end();
+}
+
+int Mp4Writer::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    _box.clear();
+    begin("ftyp");
+    putFourcc("iso6");
+    put32(0);
+    putFourcc("iso6");
+    putFourcc("cmfc");
+    putFourcc("mp41");
+    end();
+
+    begin("moov");
+    begin("mvhd");
+    put32(0);//version and flags
+    put32(0);
+    put32(0);
+    put32(1000);//timescale
+    put32(0);//duration, fragments to come
+    put32(0x00010000);//rate
+    put16(0x0100);//volume
+    _box.insert(_box.end(), 10, 0);
+    _box.insert(_box.end(), MATRIX, MATRIX + sizeof MATRIX);
+    _box.insert(_box.end(), 24, 0);
+    put32(TRACK_ID + 1);//next_track_ID
+    end();
+
+    begin("trak");
+    begin("tkhd");
+    put32(3);//enabled, in movie
+    put32(0);
+    put32(0);
+    put32(TRACK_ID);
+    put32(0);
+    put32(0);//duration
+    _box.insert(_box.end(), 8, 0);
+    put16(0);//layer
+    put16(0);//alternate_group
+    put16(0);//volume
+    put16(0);
+    _box.insert(_box.end(), MATRIX, MATRIX + sizeof MATRIX);
+    put32(_width << 16);
+    put32(_height << 16);
+    end();
+
+    begin("mdia");
+    begin("mdhd");
+    put32(0);
+    put32(0);
+    put32(0);
+    put32(_fpsNum);//timescale, a picture lasts _fpsDenom
+    put32(0);
+    put16(0x55c4);//und
+    put16(0);
+    end();
+    begin("hdlr");
+    put32(0);
+    put32(0);
+    putFourcc("vide");
+    _box.insert(_box.end(), 12, 0);
+    const char name[] = "x265";
+    _box.insert(_box.end(), name, name + sizeof name);
+    end();
+
+    begin("minf");
+    begin("vmhd");
+    put32(1);
+    _box.insert(_box.end(), 8, 0);
+    end();
+    begin("dinf");
+    begin("dref");
+    put32(0);
+    put32(1);
+    begin("url ");
+    put32(1);//media in this file
+    end();
+    end();
+    end();
+
+    begin("stbl");
+    begin("stsd");
+    put32(0);
+    put32(1);
+    //hev1 when parameter sets come in band too
+    begin(_bRepeatHeaders ? "hev1" : "hvc1");
+    _box.insert(_box.end(), 6, 0);
+    put16(1);//data_reference_index
+    _box.insert(_box.end(), 16, 0);
+    put16(_width);
+    put16(_height);
+    put32(0x00480000);//72 dpi
+    put32(0x00480000);
+    put32(0);
+    put16(1);//frame_count
+    _box.insert(_box.end(), 32, 0);//compressorname
+    put16(0x0018);
+    put16(0xffff);
+    putHvcC(nal, nalcount);
+    end();
+    end();
+    //the samples are all in fragments
+    const char *empty[] = { "stts", "stsc", "stco" };
+    for (const char *type : empty)
+    {
+        begin(type);
+        put32(0);
+        put32(0);
+        end();
+    }
+    begin("stsz");
+    put32(0);
+    put32(0);
+    put32(0);
+    end();
+    end();//stbl
+    end();//minf
+    end();//mdia
+    end();//trak
+
+    begin("mvex");
+    begin("trex");
+    put32(0);
+    put32(TRACK_ID);
+    put32(1);//sample description
+    put32(_fpsDenom);//sample duration
+    put32(0);
+    put32(0);
+    end();
+    end();
+    end();//moov
+
+    struct iovec iov = { _box.data(), _box.size() };
+    if (!writeAll(&iov, 1, -1))
+    {
+        return 0;
+    }
+    return (int)_box.size();
+}
+
+bool Mp4Writer::writeAll(struct iovec *iov, int iovcnt, int64_t offset)
+{
+    bool append = offset < 0;
+    if (append)
+    {
+        offset = _offset;
+    }
+    while (iovcnt)
+    {
+        int count = std::min(iovcnt, IOV_MAX);
+        ssize_t written = _fd == STDOUT_FILENO ? writev(_fd, iov, count) : pwritev(_fd, iov, count, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            x265_log(NULL, X265_LOG_ERROR, "mp4: write failed: %s\n", strerror(errno));
+            return false;
+        }
+        offset += written;
+        while (iovcnt && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    if (append)
+    {
+        _offset = offset;
+    }
+    return true;
+}
+
+void Mp4Writer::buildMoof()
+{
+    _box.clear();
+    begin("moof");
+    begin("mfhd");
+    put32(0);
+    put32(++_sequence);
+    end();
+    begin("traf");
+    begin("tfhd");
+    put32(0x020000);//default-base-is-moof
+    put32(TRACK_ID);
+    end();
+    begin("tfdt");
+    put32(0x01000000);//version 1
+    put64(_decodeTime);
+    end();
+    begin("trun");
+    put32(0x01000000 | 0x000001 | 0x000200 | 0x000400 | 0x000800);//signed offsets; data offset, sizes, flags, offsets
+    put32((uint32_t)_samples.size());
+    put32((uint32_t)(MOOF_SIZE + TRUN_SAMPLE * _samples.size() + BOX_HEADER));
+    for (const Sample &sample : _samples)
+    {
+        put32(sample.size);
+        put32(sample.flags);
+        put32((uint32_t)sample.compositionOffset);
+    }
+    end();
+    end();
+    end();
+    begin("mdat");
+    end();
+    //mdat stays open, its size counts the samples that follow
+    uint32_t mdat = (uint32_t)(BOX_HEADER + _mdatBytes);
+    size_t at = _box.size() - BOX_HEADER;
+    _box[at] = (uint8_t)(mdat >> 24);
+    _box[at + 1] = (uint8_t)(mdat >> 16);
+    _box[at + 2] = (uint8_t)(mdat >> 8);
+    _box[at + 3] = (uint8_t)mdat;
+}
+
+bool Mp4Writer::flushFragment()
+{
+    if (_samples.empty())
+    {
+        return true;
+    }
+    buildMoof();
+    //the room left over goes to a free box ahead of the moof, 12 bytes or more
+    size_t room = MOOF_SIZE + TRUN_SAMPLE * _capacity + BOX_HEADER;
+    size_t gap = room - _box.size();
+    uint8_t pad[BOX_HEADER] = { (uint8_t)(gap >> 24), (uint8_t)(gap >> 16), (uint8_t)(gap >> 8), (uint8_t)gap, 'f', 'r', 'e', 'e' };
+    struct iovec iov[2] = { { pad, sizeof pad }, { _box.data(), _box.size() } };
+    bool ok = (!gap || writeAll(&iov[0], 1, _fragmentStart)) && writeAll(&iov[1], 1, _fragmentStart + gap);
+    _samples.clear();
+    _mdatBytes = 0;
+    return ok;
+}
+
+int Mp4Writer::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    if (!_started)
+    {
+        _started = true;
+        _firstDts = pic.dts;
+        _firstPts = pic.pts;
+    }
+    bool sync = false;
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        sync |= isIrap(nal[i].type);
+        size += nal[i].sizeBytes;
+    }
+    if (_bGop && !_samples.empty() &&
+        (sync || _samples.size() == _capacity || _mdatBytes + size > MAX_MDAT))
+    {
+        if (!flushFragment())
+        {
+            return 0;
+        }
+    }
+
+    uint64_t decodeTime = (uint64_t)(pic.dts - _firstDts) * _fpsDenom;
+    if (_samples.empty())
+    {
+        _decodeTime = decodeTime;
+        _fragmentStart = _offset;
+        _capacity = _bGop ? (size_t)_keyframeMax : 1;
+        if (_bGop)
+        {
+            _offset += MOOF_SIZE + TRUN_SAMPLE * _capacity + BOX_HEADER;
+        }
+    }
+    int64_t composition = (pic.pts - _firstPts) * (int64_t)_fpsDenom;
+    uint64_t sampleDecodeTime = _decodeTime + (uint64_t)_samples.size() * _fpsDenom;
+    _samples.push_back({ size, sync ? (uint32_t)SAMPLE_SYNC : (uint32_t)SAMPLE_NON_SYNC,
+                         (int32_t)(composition - (int64_t)sampleDecodeTime) });
+    _mdatBytes += size;
+
+    //the NAL payloads go to the file as they are, behind the moof when it is known
+    _iov.resize(nalcount + 1);
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        _iov[i + 1].iov_base = nal[i].payload;
+        _iov[i + 1].iov_len = nal[i].sizeBytes;
+    }
+    if (_bGop)
+    {
+        return writeAll(&_iov[1], (int)nalcount, -1) ? (int)size : 0;
+    }
+    buildMoof();
+    _iov[0].iov_base = _box.data();
+    _iov[0].iov_len = _box.size();
+    bool ok = writeAll(_iov.data(), (int)nalcount + 1, -1);
+    _samples.clear();
+    _mdatBytes = 0;
+    return ok ? (int)(size + _box.size()) : 0;
+}
+
+void Mp4Writer::closeFile(int64_t, int64_t)
+{
+    if (_bGop)
+    {
+        flushFragment();
+    }
+    if (_fd != -1 && _fd != STDOUT_FILENO)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+}
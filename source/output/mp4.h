@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+#include "output.h"
+
+constexpr char MP4[] = "mp4://";
+
+/* Fragmented MP4 for recording and HTTP delivery, CMAF style: file.mp4 or
+ * mp4://file[?fragment=gop|frame]. ftyp and moov, with an hvc1 sample entry
+ * (hev1 with --repeat-headers) whose hvcC holds the VPS, SPS, PPS and SEI
+ * of writeHeaders, then one
+ * moof and mdat per fragment. The encoder is switched to length prefixed
+ * NAL units, which is what MP4 samples are, so the payloads go to the file
+ * as they are, gathered by pwritev. fragment=frame writes each picture as
+ * a fragment of its own in a single call, also to a pipe with -. A GOP
+ * fragment, the default, ends before the next IRAP picture: its samples
+ * are written as they come behind room left for the moof, which is filled
+ * in once the fragment is complete, behind a free box taking up what the
+ * moof did not need. A GOP of more than keyframeMax pictures is cut there */
+class Mp4Writer : public x265::OutputFile
+{
+public:
+    Mp4Writer();
+    ~Mp4Writer();
+    static Mp4Writer *construct(const char* fname);
+
+    virtual bool isFail() const override { return _fd == -1; }
+    //decoding and composition times come from pic_out.dts and pts
+    virtual bool needPTS() const override { return true; }
+    virtual void release() override { delete this; }
+    virtual const char* getName() const override { return "mp4"; }
+    virtual void setParam(x265_param* param) override;
+
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+protected:
+    enum { TRACK_ID = 1 };
+    enum { MOOF_SIZE = 88 };//moof, mfhd, traf, tfhd, tfdt and trun without samples
+    enum { TRUN_SAMPLE = 12 };//size, flags and composition offset, durations are the trex default
+    enum { BOX_HEADER = 8 };
+    enum { MAX_MDAT = 1 << 30 };//a fragment is cut before its mdat outgrows 32 bit sizes
+
+    struct Sample
+    {
+        uint32_t size;
+        uint32_t flags;
+        int32_t compositionOffset;
+    };
+
+    void begin(const char *type);
+    void end();
+    void put8(uint32_t v) { _box.push_back((uint8_t)v); }
+    void put16(uint32_t v);
+    void put32(uint32_t v);
+    void put64(uint64_t v);
+    void putFourcc(const char *fourcc);
+    void putHvcC(const x265_nal* nal, uint32_t nalcount);
+    void buildMoof();
+    //all of iov at offset, or appended when offset is -1
+    bool writeAll(struct iovec *iov, int iovcnt, int64_t offset);
+    bool flushFragment();
+
+    int _fd;
+    bool _bGop;
+    int64_t _offset;//end of the file written so far
+    std::vector<uint8_t> _box;
+    std::vector<size_t> _open;//starts of the boxes being built
+    std::vector<struct iovec> _iov;
+    std::vector<Sample> _samples;//of the open fragment
+    int64_t _fragmentStart;//offset of the room left for its moof
+    size_t _capacity;//samples its moof has room for
+    uint64_t _mdatBytes;
+    uint64_t _decodeTime;//of the fragment's first sample
+    uint32_t _sequence;
+    bool _started;
+    int64_t _firstDts, _firstPts;
+    uint32_t _width, _height;
+    uint32_t _fpsNum, _fpsDenom;
+    int _chroma, _bitDepth;
+    int _keyframeMax;
+    bool _bRepeatHeaders;
+};
@@ -0,0 +1,181 @@
+#include "nackreceiver.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "retransmit.h"
+
+NackReceiver::NackReceiver(std::function<void(const uint8_t *packet, size_t bytes)> onPacket,
+                           std::function<void(const uint8_t *rtcp, size_t bytes)> sendFeedback,
+                           double loss, int burst, int waitMs, int renackMs)
+    : _onPacket(onPacket)
+    , _sendFeedback(sendFeedback)
+    , _burstStart(loss / std::max(burst, 1))
+    , _burst(std::max(burst, 1))
+    , _dropping(0)
+    , _wait((int64_t)waitMs * 1000)
+    , _renack((int64_t)renackMs * 1000)
+    , _rng(0x4e41434b)
+    , _started(false)
+    , _ssrc(0)
+    , _next(0)
+    , _highest(0)
+{
+    memset(&_stats, 0, sizeof _stats);
+}
+
+bool NackReceiver::inject()
+{
+    if (_dropping)
+    {
+        _dropping--;
+        return true;
+    }
+    if (_burstStart > 0 && std::uniform_real_distribution<double>(0, 1)(_rng) < _burstStart)
+    {
+        _dropping = _burst - 1;
+        return true;
+    }
+    return false;
+}
+
+void NackReceiver::push(const uint8_t *packet, size_t bytes, int64_t now)
+{
+    if (bytes < 12 || (packet[0] & 0xC0) != 0x80)
+    {
+        return;
+    }
+    if (inject())
+    {
+        _stats.dropped++;
+        return;
+    }
+    uint16_t seq = (uint16_t)(packet[2] << 8 | packet[3]);
+    if (!_started)
+    {
+        _started = true;
+        _ssrc = (uint32_t)packet[8] << 24 | packet[9] << 16 | packet[10] << 8 | packet[11];
+        //start a wrap in, so packets from just before the first still extend below it
+        _next = 0x10000 + seq;
+        _highest = _next - 1;
+    }
+    uint32_t ext = _highest + (int16_t)(seq - (uint16_t)_highest);
+    if ((int32_t)(ext - _next) < 0 || _packets.count(ext))
+    {
+        _stats.duplicates++;
+        return;
+    }
+    _stats.received++;
+
+    auto gap = _gaps.find(ext);
+    if (gap != _gaps.end())
+    {
+        _stats.recovered++;
+        _stats.recoveryDelaySum += now - gap->second.seen;
+        _gaps.erase(gap);
+    }
+    if ((int32_t)(ext - _highest) > 0)
+    {
+        if (ext - _highest > 1024)
+        {
+            //the sender restarted or a long outage, nothing to ask for
+            flush();
+            _next = ext;
+        }
+        for (uint32_t missing = std::max(_highest + 1, _next); missing != ext; missing++)
+        {
+            _gaps[missing] = { now, 0 };
+        }
+        _highest = ext;
+    }
+    _packets[ext].assign(packet, packet + bytes);
+
+    sendNacks(now);
+    deliver(now);
+}
+
+void NackReceiver::tick(int64_t now)
+{
+    sendNacks(now);
+    deliver(now);
+}
+
+void NackReceiver::sendNacks(int64_t now)
+{
+    _rtcp.assign(12, 0);
+    uint32_t count = 0;
+    bool open = false;
+    uint32_t pid = 0;//extended sequence number of the open FCI entry
+    for (auto &gap : _gaps)
+    {
+        if (gap.second.nacked && now - gap.second.nacked < _renack)
+        {
+            continue;
+        }
+        gap.second.nacked = now;
+        count++;
+        if (open && gap.first - pid <= 16)
+        {
+            size_t blp = _rtcp.size() - 2;
+            uint16_t mask = (uint16_t)(_rtcp[blp] << 8 | _rtcp[blp + 1]) | (uint16_t)(1 << (gap.first - pid - 1));
+            _rtcp[blp] = (uint8_t)(mask >> 8);
+            _rtcp[blp + 1] = (uint8_t)mask;
+            continue;
+        }
+        open = true;
+        pid = gap.first;
+        _rtcp.push_back((uint8_t)(gap.first >> 8));
+        _rtcp.push_back((uint8_t)gap.first);
+        _rtcp.push_back(0);
+        _rtcp.push_back(0);
+    }
+    if (!count)
+    {
+        return;
+    }
+    size_t words = _rtcp.size() / 4 - 1;
+    _rtcp[0] = 0x80 | RTCP_FMT_NACK;
+    _rtcp[1] = RTCP_RTPFB;
+    _rtcp[2] = (uint8_t)(words >> 8);
+    _rtcp[3] = (uint8_t)words;
+    //sender SSRC stays 0, the receiver sends no media
+    _rtcp[8] = (uint8_t)(_ssrc >> 24);
+    _rtcp[9] = (uint8_t)(_ssrc >> 16);
+    _rtcp[10] = (uint8_t)(_ssrc >> 8);
+    _rtcp[11] = (uint8_t)_ssrc;
+    _stats.nacks++;
+    _stats.nacked += count;
+    _sendFeedback(_rtcp.data(), _rtcp.size());
+}
+
+void NackReceiver::deliver(int64_t now)
+{
+    while (_started && (int32_t)(_highest - _next) >= 0)
+    {
+        auto packet = _packets.find(_next);
+        if (packet != _packets.end())
+        {
+            _onPacket(packet->second.data(), packet->second.size());
+            _packets.erase(packet);
+        }
+        else
+        {
+            auto gap = _gaps.find(_next);
+            if (gap != _gaps.end() && now - gap->second.seen < _wait)
+            {
+                break;
+            }
+            if (gap != _gaps.end())
+            {
+                _gaps.erase(gap);
+            }
+            _stats.lost++;
+        }
+        _next++;
+    }
+}
+
+void NackReceiver::flush()
+{
+    deliver(INT64_MAX);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <random>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* Receiving end of rtp://...?nack= for benchmarking retransmission on
+ * loopback. It drops incoming packets on purpose, in bursts of burst
+ * packets that start often enough to lose the loss fraction of them,
+ * retransmissions included. Gaps in the sequence numbers are NACKed
+ * through sendFeedback as RTCP generic NACKs (retransmit.h), again every
+ * renack milliseconds while they stay open. Packets go to onPacket in
+ * sequence order; one still missing wait milliseconds after its gap was
+ * seen is given up. The caller owns the socket: it passes datagrams to
+ * push, sends what sendFeedback gets back to their source address and
+ * calls tick now and then so gaps time out without new packets */
+class NackReceiver
+{
+public:
+    NackReceiver(std::function<void(const uint8_t *packet, size_t bytes)> onPacket,
+                 std::function<void(const uint8_t *rtcp, size_t bytes)> sendFeedback,
+                 double loss = 0, int burst = 1, int waitMs = 200, int renackMs = 40);
+
+    //now is x265_mdate() microseconds
+    void push(const uint8_t *packet, size_t bytes, int64_t now);
+    void tick(int64_t now);
+    //passes on everything still held, gaps given up
+    void flush();
+
+    struct Stats
+    {
+        uint64_t received;//packets that got through, retransmissions included
+        uint64_t dropped;//by the loss injection
+        uint64_t duplicates;
+        uint64_t nacks;//feedback messages sent
+        uint64_t nacked;//sequence numbers asked for, repeats counted
+        uint64_t recovered;//gaps filled by a retransmission
+        uint64_t lost;//gaps given up
+        int64_t recoveryDelaySum;//microseconds from gap to retransmission
+    };
+    Stats GetStats() const { return _stats; }
+
+protected:
+    struct Gap
+    {
+        int64_t seen;//when the gap was noticed
+        int64_t nacked;//when it was last asked for
+    };
+
+    bool inject();
+    void sendNacks(int64_t now);
+    void deliver(int64_t now);
+
+    std::function<void(const uint8_t *packet, size_t bytes)> _onPacket;
+    std::function<void(const uint8_t *rtcp, size_t bytes)> _sendFeedback;
+    double _burstStart;//probability a packet starts a burst of drops
+    int _burst, _dropping;
+    int64_t _wait, _renack;//microseconds
+    std::mt19937 _rng;
+    bool _started;
+    uint32_t _ssrc;
+    uint32_t _next;//extended sequence number of the next packet to pass on
+    uint32_t _highest;//extended, highest received
+    std::map<uint32_t, std::vector<uint8_t>> _packets;//received, not passed on
+    std::map<uint32_t, Gap> _gaps;
+    std::vector<uint8_t> _rtcp;
+    Stats _stats;
+};
@@ -0,0 +1,140 @@
+/* Loopback benchmark receiver for rtp://ip:port?nack=: nackrecv [-loss
+ * percent] [-burst n] [-wait ms] [-renack ms] port listens on port and
+ * hands the packets to NackReceiver, which throws away the given share of
+ * them in bursts of n and NACKs the gaps back to the sender. Every NACK is
+ * read back with Retransmitter::parseNack before it is sent, the sequence
+ * numbers it carries must be the ones NackReceiver asked for. It stops
+ * after a second without packets and prints how many were dropped,
+ * recovered and lost and how long recovery took; it fails if a NACK did
+ * not parse */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common.h"
+#include "nackreceiver.h"
+#include "retransmit.h"
+
+using namespace X265_NS;
+
+int main(int argc, char **argv)
+{
+    double loss = 0;
+    int burst = 1, waitMs = 200, renackMs = 40;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (!strcmp(argv[arg], "-loss"))
+        {
+            loss = atof(argv[arg + 1]);
+        }
+        else if (!strcmp(argv[arg], "-burst"))
+        {
+            burst = atoi(argv[arg + 1]);
+        }
+        else if (!strcmp(argv[arg], "-wait"))
+        {
+            waitMs = atoi(argv[arg + 1]);
+        }
+        else if (!strcmp(argv[arg], "-renack"))
+        {
+            renackMs = atoi(argv[arg + 1]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (arg + 1 != argc || loss < 0 || loss > 100 || burst < 1 || waitMs < 1 || renackMs < 1)
+    {
+        fprintf(stderr, "usage: %s [-loss percent] [-burst n] [-wait ms] [-renack ms] port\n", argv[0]);
+        return 1;
+    }
+
+    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    sa.sin_port = htons((unsigned short)atoi(argv[arg]));
+    int buffer = 8 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof buffer);
+    if (sock == -1 || bind(sock, (struct sockaddr *)&sa, sizeof sa))
+    {
+        fprintf(stderr, "unable to listen on port %s: %s\n", argv[arg], strerror(errno));
+        return 1;
+    }
+
+    //NACKs go back to where the packets come from, the sender's socket
+    struct sockaddr_in sender;
+    memset(&sender, 0, sizeof sender);
+    uint32_t ssrc = 0;
+    unsigned long long packets = 0, bytes = 0, badNacks = 0, parsed = 0;
+    NackReceiver receiver([&](const uint8_t *, size_t len)
+    {
+        packets++;
+        bytes += len;
+    },
+    [&](const uint8_t *rtcp, size_t len)
+    {
+        std::vector<uint16_t> seqs;
+        if (!Retransmitter::parseNack(rtcp, len, ssrc, seqs))
+        {
+            badNacks++;
+        }
+        parsed += seqs.size();
+        sendto(sock, rtcp, len, 0, (struct sockaddr *)&sender, sizeof sender);
+    }, loss / 100, burst, waitMs, renackMs);
+
+    std::vector<uint8_t> datagram(65536);
+    int64_t last = 0;
+    for (;;)
+    {
+        struct pollfd fd = { sock, POLLIN, 0 };
+        int ready = poll(&fd, 1, renackMs);
+        int64_t now = x265_mdate();
+        if (ready > 0)
+        {
+            socklen_t fromLen = sizeof sender;
+            ssize_t len = recvfrom(sock, datagram.data(), datagram.size(), 0, (struct sockaddr *)&sender, &fromLen);
+            if (len >= 12)
+            {
+                ssrc = (uint32_t)datagram[8] << 24 | datagram[9] << 16 | datagram[10] << 8 | datagram[11];
+                receiver.push(datagram.data(), (size_t)len, now);
+                last = now;
+            }
+        }
+        else if (ready < 0 && errno != EINTR)
+        {
+            break;
+        }
+        receiver.tick(now);
+        //wait as long as it takes for the first packet
+        if (last && now - last > 1000000)
+        {
+            break;
+        }
+    }
+    receiver.flush();
+    close(sock);
+
+    NackReceiver::Stats stats = receiver.GetStats();
+    printf("%llu packets, %llu bytes, %llu dropped, %llu duplicates, %llu nacks for %llu packets, %llu recovered in %.2f ms on average, %llu lost\n",
+           packets, bytes, (unsigned long long)stats.dropped, (unsigned long long)stats.duplicates,
+           (unsigned long long)stats.nacks, (unsigned long long)stats.nacked, (unsigned long long)stats.recovered,
+           stats.recovered ? stats.recoveryDelaySum / 1000.0 / stats.recovered : 0, (unsigned long long)stats.lost);
+    if (badNacks || parsed != stats.nacked)
+    {
+        fprintf(stderr, "%llu nacks did not parse, %llu of %llu sequence numbers read back\n",
+                badNacks, parsed, (unsigned long long)stats.nacked);
+        return 1;
+    }
+    return 0;
+}
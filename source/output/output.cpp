@@ -26,9 +26,14 @@
 #include "yuv.h"
 #include "y4m.h"
 #include "writer.h"
+#include "rtpwriter.h"
+#include "shmwriter.h"
+#include "tswriter.h"
+#include "mp4.h"
 
 #include "raw.h"
 
+#include <iostream>
 #include <vector>
 
 using namespace X265_NS;
@@ -49,9 +54,62 @@ OutputFile* OutputFile::open(const char *fname, InputFileInfo& inputInfo, std::f
     {
         return UdpWriter::construct(fname);
     }
+    else if(strncmp(fname, RTP, strlen(RTP)) == 0)
+    {
+        return RtpWriter::construct(fname);
+    }
+    else if(strncmp(fname, UDP_TS, strlen(UDP_TS)) == 0)
+    {
+        return UdpTsWriter::construct(fname);
+    }
+    else if(strncmp(fname, TS, strlen(TS)) == 0)
+    {
+        return TsWriter::construct(fname);
+    }
+    else if(strncmp(fname, SHM, strlen(SHM)) == 0)
+    {
+        return ShmWriter::construct(fname);
+    }
     else if(strncmp(fname, BUFFER, strlen(BUFFER)) == 0)
     {
         return BufferWriter::construct(writeEncodedFrame);
     }
+    const char *s = strrchr(fname, '.');
+    if (strncmp(fname, MP4, strlen(MP4)) == 0 || (s && !strcmp(s, ".mp4")))
+    {
+        return Mp4Writer::construct(fname);
+    }
     return new RAWOutput(fname, inputInfo);
 }
+
+bool OutputFile::parseUrl(const char* url, std::string &location, std::map<std::string, std::string> &options)
+{
+    const char *scheme = strstr(url, "://");
+    location = scheme ? scheme + 3 : url;
+    std::size_t query = location.find('?');
+    if (query == std::string::npos)
+    {
+        return true;
+    }
+    std::string rest = location.substr(query + 1);
+    location.resize(query);
+    std::size_t previous = 0;
+    while (previous <= rest.size())
+    {
+        std::size_t current = rest.find('&', previous);
+        std::string option = rest.substr(previous, current == std::string::npos ? std::string::npos : current - previous);
+        std::size_t eq = option.find('=');
+        if (eq == std::string::npos)
+        {
+            std::cout << "Invalid option " << option << " in " << url << "\n";
+            return false;
+        }
+        options[option.substr(0, eq)] = option.substr(eq + 1);
+        if (current == std::string::npos)
+        {
+            break;
+        }
+        previous = current + 1;
+    }
+    return true;
+}
@@ -26,6 +26,8 @@
 #define X265_OUTPUT_H
 
 #include <functional>
+#include <map>
+#include <string>
 
 #include "x265.h"
 #include "input/input.h"
@@ -81,7 +83,26 @@ public:
 
     virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) = 0;
 
+    /* Outputs that can send an access unit in pieces, as the encoder's NAL
+     * callback delivers them while the picture is still being coded, return
+     * true and take the pieces through writePartial instead of writeFrame */
+    virtual bool canStream() const { return false; }
+
+    virtual int writePartial(const x265_nal* /*nal*/, uint32_t /*nalcount*/, int64_t /*pts*/, bool /*bLast*/) { return 0; }
+
+    /* Outputs that hold writes back to a send rate, and so sleep in them,
+     * return true; they must not run on the encoding thread or the encoder
+     * workers that stream slices */
+    virtual bool isPaced() const { return false; }
+
     virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) = 0;
+
+protected:
+
+    /* Splits scheme://location?key=value&key=value, the names of the network
+     * and shared memory outputs, into location and options. Prints what is
+     * wrong and returns false for an option without a value */
+    static bool parseUrl(const char* url, std::string &location, std::map<std::string, std::string> &options);
 };
 }
 
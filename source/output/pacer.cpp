@@ -0,0 +1,87 @@
+#include "pacer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+Pacer::Pacer()
+    : _rate(0)
+    , _depth(0)
+    , _tokens(0)
+    , _last(0)
+    , _unitDelay(0)
+{
+    memset(&_stats, 0, sizeof _stats);
+}
+
+void Pacer::configure(double rate, double depth)
+{
+    _rate = rate;
+    _depth = depth;
+    _tokens = depth;
+    _last = now();
+}
+
+int64_t Pacer::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void Pacer::refill(int64_t time)
+{
+    _tokens += (time - _last) * _rate / 1e9;
+    if (_tokens > _depth)
+    {
+        _tokens = _depth;
+    }
+    _last = time;
+}
+
+void Pacer::wait(size_t bytes)
+{
+    refill(now());
+    if (_tokens < 0)
+    {
+        int64_t start = _last;
+        int64_t deadline = _last + (int64_t)(-_tokens * 1e9 / _rate) + 1;
+        struct timespec ts = { (time_t)(deadline / 1000000000), (long)(deadline % 1000000000) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        {}
+        refill(now());
+        _unitDelay += _last - start;
+    }
+    _tokens -= bytes;
+}
+
+bool Pacer::take(size_t bytes)
+{
+    refill(now());
+    if (_tokens < bytes)
+    {
+        return false;
+    }
+    _tokens -= bytes;
+    return true;
+}
+
+void Pacer::refund(size_t bytes)
+{
+    _tokens += bytes;
+    if (_tokens > _depth)
+    {
+        _tokens = _depth;
+    }
+}
+
+void Pacer::endUnit()
+{
+    int64_t delay = _unitDelay / 1000;
+    _stats.units++;
+    _stats.pacedUnits += delay > 0;
+    _stats.delaySum += delay;
+    _stats.maxDelay = delay > _stats.maxDelay ? delay : _stats.maxDelay;
+    _stats.lastDelay = delay;
+    _unitDelay = 0;
+}
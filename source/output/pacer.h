@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Token bucket of the udp and rtp outputs. Tokens are bytes that accrue at
+ * rate bytes per second up to depth. A send waits until the bucket is out
+ * of debt and then takes its bytes, so a message larger than depth still
+ * goes out, followed by a longer wait. Waits sleep on CLOCK_MONOTONIC to an
+ * absolute deadline so timer slack does not add up into drift */
+class Pacer
+{
+public:
+    Pacer();
+    void configure(double rate, double depth);
+    bool enabled() const { return _rate > 0; }
+    double rate() const { return _rate; }
+
+    //waits for the bucket, then takes bytes
+    void wait(size_t bytes);
+    //takes bytes if the bucket holds them now
+    bool take(size_t bytes);
+    //gives back the bytes of messages the socket did not accept
+    void refund(size_t bytes);
+    //ends an access unit, its waits go into the counters
+    void endUnit();
+
+    struct Stats
+    {
+        uint64_t units;
+        uint64_t pacedUnits;//units that waited at all
+        int64_t delaySum;//microseconds waited
+        int64_t maxDelay;
+        int64_t lastDelay;//of the last unit
+    };
+    Stats GetStats() const { return _stats; }
+
+protected:
+    static int64_t now();
+    void refill(int64_t time);
+
+    double _rate, _depth;
+    double _tokens;
+    int64_t _last;//nanoseconds, when _tokens was current
+    int64_t _unitDelay;//nanoseconds
+    Stats _stats;
+};
@@ -0,0 +1,182 @@
+#include "retransmit.h"
+
+#include <algorithm>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+
+using namespace X265_NS;
+
+Retransmitter::Retransmitter()
+    : _sock(-1)
+    , _ssrc(0)
+    , _keep(0)
+    , _mask(0)
+    , _maxPacket(0)
+    , _stopping(false)
+{
+    memset(&_destination, 0, sizeof _destination);
+    memset(&_stats, 0, sizeof _stats);
+}
+
+Retransmitter::~Retransmitter()
+{
+    if (_sock != -1)
+    {
+        _lock.acquire();
+        _stopping = true;
+        _lock.release();
+        stop();
+    }
+}
+
+bool Retransmitter::start(int sock, const struct sockaddr_in &destination, uint32_t ssrc, int keepMs, size_t slots, size_t maxPacket)
+{
+    size_t size = 1;
+    while (size < slots && size < 32768)
+    {
+        size <<= 1;
+    }
+    _destination = destination;
+    _ssrc = ssrc;
+    _keep = (int64_t)keepMs * 1000;
+    _mask = size - 1;
+    _maxPacket = maxPacket;
+    _slots.assign(size, Slot());
+    _packets.resize(size * maxPacket);
+    _sock = sock;
+    if (!x265::Thread::start())
+    {
+        _sock = -1;
+        return false;
+    }
+    return true;
+}
+
+void Retransmitter::store(const struct iovec *iov, int iovcnt)
+{
+    if (_sock == -1 || !iovcnt || iov[0].iov_len < 4)
+    {
+        return;
+    }
+    const uint8_t *header = (const uint8_t *)iov[0].iov_base;
+    uint16_t seq = (uint16_t)(header[2] << 8 | header[3]);
+
+    ScopedLock lock(_lock);
+    Slot &slot = _slots[seq & _mask];
+    uint8_t *packet = &_packets[(seq & _mask) * _maxPacket];
+    size_t bytes = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        size_t len = std::min(iov[i].iov_len, _maxPacket - bytes);
+        memcpy(packet + bytes, iov[i].iov_base, len);
+        bytes += len;
+    }
+    slot.time = x265_mdate();
+    slot.bytes = bytes;
+    slot.seq = seq;
+    slot.valid = true;
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+bool Retransmitter::parseNack(const uint8_t *data, size_t bytes, uint32_t ssrc, std::vector<uint16_t> &seqs)
+{
+    bool found = false;
+    size_t offset = 0;
+    while (offset + 4 <= bytes)
+    {
+        const uint8_t *packet = data + offset;
+        size_t length = ((size_t)(packet[2] << 8 | packet[3]) + 1) * 4;
+        if ((packet[0] & 0xC0) != 0x80 || offset + length > bytes)
+        {
+            break;
+        }
+        if (packet[1] == RTCP_RTPFB && (packet[0] & 0x1F) == RTCP_FMT_NACK && length >= 12 && read32(packet + 8) == ssrc)
+        {
+            //FCI entries, a packet ID and a bitmask of the 16 following it
+            for (size_t fci = 12; fci + 4 <= length; fci += 4)
+            {
+                uint16_t pid = (uint16_t)(packet[fci] << 8 | packet[fci + 1]);
+                uint16_t blp = (uint16_t)(packet[fci + 2] << 8 | packet[fci + 3]);
+                seqs.push_back(pid);
+                for (int bit = 0; bit < 16; bit++)
+                {
+                    if (blp & (1 << bit))
+                    {
+                        seqs.push_back((uint16_t)(pid + bit + 1));
+                    }
+                }
+            }
+            found = true;
+        }
+        offset += length;
+    }
+    return found;
+}
+
+void Retransmitter::resend(uint16_t seq, int64_t now)
+{
+    _stats.requested++;
+    const Slot &slot = _slots[seq & _mask];
+    if (!slot.valid || slot.seq != seq || now - slot.time > _keep)
+    {
+        _stats.expired++;
+        return;
+    }
+    const uint8_t *packet = &_packets[(seq & _mask) * _maxPacket];
+    if (sendto(_sock, packet, slot.bytes, 0, (const struct sockaddr *)&_destination, sizeof _destination) == (ssize_t)slot.bytes)
+    {
+        _stats.resent++;
+        _stats.resentBytes += slot.bytes;
+    }
+}
+
+void Retransmitter::threadMain()
+{
+    std::vector<uint8_t> buffer(2048);
+    std::vector<uint16_t> seqs;
+    for (;;)
+    {
+        {
+            ScopedLock lock(_lock);
+            if (_stopping)
+            {
+                return;
+            }
+        }
+        //wake up now and then to notice _stopping
+        struct pollfd fd = { _sock, POLLIN, 0 };
+        if (::poll(&fd, 1, 100) <= 0)
+        {
+            continue;
+        }
+        ssize_t bytes = recv(_sock, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (bytes <= 0)
+        {
+            continue;
+        }
+        seqs.clear();
+        if (!parseNack(buffer.data(), (size_t)bytes, _ssrc, seqs))
+        {
+            continue;
+        }
+
+        ScopedLock lock(_lock);
+        _stats.nacks++;
+        int64_t now = x265_mdate();
+        for (uint16_t seq : seqs)
+        {
+            resend(seq, now);
+        }
+    }
+}
+
+Retransmitter::Stats Retransmitter::GetStats()
+{
+    ScopedLock lock(_lock);
+    return _stats;
+}
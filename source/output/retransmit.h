@@ -0,0 +1,71 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include "common.h"
+#include "threading.h"
+
+//RTCP transport layer feedback, generic NACK, RFC 4585 section 6.2.1
+enum { RTCP_RTPFB = 205 };
+enum { RTCP_FMT_NACK = 1 };
+
+/* Selective retransmission of rtp://...?nack=ms. Every packet sent is
+ * copied into a ring indexed by its sequence number, and a thread waits on
+ * the sending socket for RTCP generic NACKs, which receivers send back to
+ * the address the packets came from. Requested packets still in the ring
+ * and younger than keep milliseconds are sent again unchanged, same
+ * sequence number and SSRC, to the destination of the stream. Nothing is
+ * encoded again and recovery costs only the lost bytes */
+class Retransmitter : public x265::Thread
+{
+public:
+    Retransmitter();
+    ~Retransmitter();
+
+    //slots is rounded up to a power of two, at most 32768
+    bool start(int sock, const struct sockaddr_in &destination, uint32_t ssrc, int keepMs, size_t slots, size_t maxPacket);
+    bool enabled() const { return _sock != -1; }
+    //one packet as sent, its RTP header at the start of iov[0]
+    void store(const struct iovec *iov, int iovcnt);
+
+    //appends the sequence numbers a compound RTCP packet NACKs for ssrc
+    static bool parseNack(const uint8_t *data, size_t bytes, uint32_t ssrc, std::vector<uint16_t> &seqs);
+
+    struct Stats
+    {
+        uint64_t nacks;//feedback messages
+        uint64_t requested;//packets asked for
+        uint64_t resent;
+        uint64_t resentBytes;
+        uint64_t expired;//asked for after leaving the ring or keep
+    };
+    Stats GetStats();
+
+protected:
+    struct Slot
+    {
+        int64_t time;//x265_mdate() when stored
+        size_t bytes;
+        uint16_t seq;
+        bool valid;
+    };
+
+    virtual void threadMain() override;
+    void resend(uint16_t seq, int64_t now);
+
+    int _sock;
+    struct sockaddr_in _destination;
+    uint32_t _ssrc;
+    int64_t _keep;//microseconds
+    size_t _mask;//slots - 1
+    size_t _maxPacket;
+    std::vector<Slot> _slots;
+    std::vector<uint8_t> _packets;//_maxPacket bytes per slot
+    bool _stopping;
+    Stats _stats;
+    x265::Lock _lock;//guards the ring, _stopping and _stats
+};
@@ -0,0 +1,344 @@
+#include "rtpwriter.h"
+
+#include <chrono>
+#include <random>
+
+using namespace X265_NS;
+
+namespace {
+//HEVC NAL unit types, RFC 7798 section 4.4
+enum
+{
+    NAL_VPS = 32,
+    NAL_SPS = 33,
+    NAL_PPS = 34,
+    NAL_AUD = 35,
+    NAL_PREFIX_SEI = 39,
+    NAL_SUFFIX_SEI = 40,
+    NAL_AP = 48,
+    NAL_FU = 49,
+};
+
+int nalType(const uint8_t *nal)  { return (nal[0] >> 1) & 0x3f; }
+int nalLayer(const uint8_t *nal) { return ((nal[0] & 1) << 5) | (nal[1] >> 3); }
+int nalTid(const uint8_t *nal)   { return nal[1] & 7; }
+
+//the NAL unit without its start code or length prefix
+void nalUnit(const x265_nal &nal, bool annexB, const uint8_t *&data, size_t &len)
+{
+    data = nal.payload;
+    len = nal.sizeBytes;
+    size_t prefix = 4;
+    if (annexB && len >= 3 && !data[0] && !data[1] && data[2] == 1)
+    {
+        prefix = 3;
+    }
+    prefix = std::min(prefix, len);
+    data += prefix;
+    len -= prefix;
+}
+}//namespace
+
+RtpWriter::RtpWriter()
+    : _maxPayload(1500 - IP_UDP_HEADERS - RTP_HEADER)
+    , _payloadType(96)
+    , _annexB(true)
+    , _fpsNum(0)
+    , _fpsDenom(0)
+    , _nackKeep(0)
+{
+    std::mt19937 rng((uint32_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    _seq = (uint16_t)rng();
+    _ssrc = rng();
+    _tsOffset = rng();
+    _lastTimestamp = _tsOffset;
+}
+
+RtpWriter *RtpWriter::construct(const char* fname)
+{
+    std::string ip;
+    unsigned short port;
+    std::map<std::string, std::string> options;
+    if (!parseUrl(fname, ip, port, options))
+    {
+        return nullptr;
+    }
+    auto out = new RtpWriter();
+    if(!out->initialize())
+    {
+        delete out;
+        return nullptr;
+    }
+    //every packet has its own headers, there is nothing to segment
+    out->disableGso();
+    out->setendpoint(ip.c_str(), port);
+    if (!out->applyOptions(options))
+    {
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+bool RtpWriter::applyOptions(std::map<std::string, std::string> &options)
+{
+    auto mtu = options.find("mtu");
+    if (mtu != options.end())
+    {
+        int bytes = atoi(mtu->second.c_str());
+        //leave room for a fragment's headers and at least a byte of payload
+        if (bytes < IP_UDP_HEADERS + RTP_HEADER + NAL_HEADER + FU_HEADER + 1 || bytes > 65535)
+        {
+            std::cout << "Invalid rtp mtu " << mtu->second << "\n";
+            return false;
+        }
+        _maxPayload = bytes - IP_UDP_HEADERS - RTP_HEADER;
+        options.erase(mtu);
+    }
+    auto pt = options.find("pt");
+    if (pt != options.end())
+    {
+        _payloadType = atoi(pt->second.c_str());
+        if (_payloadType < 0 || _payloadType > 127)
+        {
+            std::cout << "Invalid rtp payload type " << pt->second << "\n";
+            return false;
+        }
+        options.erase(pt);
+    }
+    auto nack = options.find("nack");
+    if (nack != options.end())
+    {
+        _nackKeep = atoi(nack->second.c_str());
+        if (_nackKeep < 1 || _nackKeep > 10000)
+        {
+            std::cout << "Invalid rtp nack " << nack->second << ", expected the milliseconds to keep packets for\n";
+            return false;
+        }
+        options.erase(nack);
+    }
+    if (options.count("fec"))
+    {
+        std::cout << "fec is an option of udp outputs, not rtp\n";
+        return false;
+    }
+    return UdpWriter::applyOptions(options);
+}
+
+void RtpWriter::setParam(x265_param* param)
+{
+    UdpWriter::setParam(param);
+    _annexB = param->bAnnexB != 0;
+    _fpsNum = param->fpsNum;
+    _fpsDenom = param->fpsDenom;
+
+    if (_nackKeep)
+    {
+        //enough slots for keep milliseconds of full packets at the peak rate, twice over
+        size_t packet = RTP_HEADER + _maxPayload;
+        double rate = param->rc.vbvMaxBitrate > 0 ? param->rc.vbvMaxBitrate : param->rc.bitrate;
+        size_t slots = rate > 0 ? (size_t)(2 * rate * 1000 / 8 * _nackKeep / 1000 / packet) + 256 : (size_t)NACK_SLOTS;
+        if (!_retransmit.start(sock, sa, _ssrc, _nackKeep, slots, packet))
+        {
+            x265_log(NULL, X265_LOG_WARNING, "rtp: unable to start the retransmission thread, nack= is off\n");
+        }
+    }
+}
+
+bool RtpWriter::aggregatable(int type)
+{
+    return type == NAL_VPS || type == NAL_SPS || type == NAL_PPS || type == NAL_AUD ||
+           type == NAL_PREFIX_SEI || type == NAL_SUFFIX_SEI;
+}
+
+void RtpWriter::addPacket(uint32_t timestamp, const uint8_t *payload, size_t payloadLen)
+{
+    Packet packet = { _head.size(), RTP_HEADER, payload, payloadLen };
+    uint8_t header[RTP_HEADER] =
+    {
+        0x80, (uint8_t)_payloadType,//V=2, no padding, extension or CSRCs, marker set later
+        (uint8_t)(_seq >> 8), (uint8_t)_seq,
+        (uint8_t)(timestamp >> 24), (uint8_t)(timestamp >> 16), (uint8_t)(timestamp >> 8), (uint8_t)timestamp,
+        (uint8_t)(_ssrc >> 24), (uint8_t)(_ssrc >> 16), (uint8_t)(_ssrc >> 8), (uint8_t)_ssrc,
+    };
+    _seq++;
+    _head.insert(_head.end(), header, header + RTP_HEADER);
+    _packets.push_back(packet);
+}
+
+int RtpWriter::packetize(const x265_nal* nal, uint32_t nalcount, uint32_t timestamp, bool marker, bool holdLast)
+{
+    _head.clear();
+    _packets.clear();
+    for (uint32_t i = 0; i < nalcount;)
+    {
+        const uint8_t *data;
+        size_t len;
+        nalUnit(nal[i], _annexB, data, len);
+        if (len <= NAL_HEADER)
+        {
+            i++;
+            continue;
+        }
+        int type = nalType(data);
+
+        /* aggregate a run of small parameter set and SEI NALs */
+        uint32_t end = i;
+        size_t apSize = NAL_HEADER;
+        int layer = 63, tid = 7, forbidden = 0;
+        while (end < nalcount)
+        {
+            const uint8_t *next;
+            size_t nextLen;
+            nalUnit(nal[end], _annexB, next, nextLen);
+            if (nextLen <= NAL_HEADER || !aggregatable(nalType(next)) || apSize + AP_LENGTH + nextLen > (size_t)_maxPayload)
+            {
+                break;
+            }
+            apSize += AP_LENGTH + nextLen;
+            layer = std::min(layer, nalLayer(next));
+            tid = std::min(tid, nalTid(next));
+            forbidden |= next[0] & 0x80;
+            end++;
+        }
+        if (end - i >= 2)
+        {
+            addPacket(timestamp, nullptr, 0);
+            _head.push_back((uint8_t)(forbidden | (NAL_AP << 1) | (layer >> 5)));
+            _head.push_back((uint8_t)(((layer & 31) << 3) | tid));
+            for (; i < end; i++)
+            {
+                nalUnit(nal[i], _annexB, data, len);
+                _head.push_back((uint8_t)(len >> 8));
+                _head.push_back((uint8_t)len);
+                _head.insert(_head.end(), data, data + len);
+            }
+            _packets.back().headLen = _head.size() - _packets.back().head;
+            continue;
+        }
+
+        if (len <= (size_t)_maxPayload)
+        {
+            addPacket(timestamp, data, len);
+        }
+        else
+        {
+            /* fragmentation units carry the NAL header in their payload
+             * header and FU header instead of the payload */
+            size_t chunk = _maxPayload - NAL_HEADER - FU_HEADER;
+            for (size_t offset = NAL_HEADER; offset < len; offset += chunk)
+            {
+                size_t part = std::min(chunk, len - offset);
+                addPacket(timestamp, data + offset, part);
+                _head.push_back((uint8_t)((data[0] & 0x81) | (NAL_FU << 1)));
+                _head.push_back(data[1]);
+                _head.push_back((uint8_t)((offset == NAL_HEADER ? 0x80 : 0) | (offset + part == len ? 0x40 : 0) | type));
+                _packets.back().headLen += NAL_HEADER + FU_HEADER;
+            }
+        }
+        i++;
+    }
+    if (marker)
+    {
+        if (!_packets.empty())
+        {
+            _head[_packets.back().head + 1] |= 0x80;
+        }
+        else if (!_held.empty())
+        {
+            _held[1] |= 0x80;
+        }
+    }
+    _nextHeld.clear();
+    if (holdLast && !_packets.empty())
+    {
+        const Packet &last = _packets.back();
+        _nextHeld.assign(_head.begin() + last.head, _head.begin() + last.head + last.headLen);
+        _nextHeld.insert(_nextHeld.end(), last.payload, last.payload + last.payloadLen);
+        _packets.pop_back();
+    }
+
+    /* _head has stopped growing, point the messages at it, behind the packet
+     * held back from the previous part */
+    size_t first = _held.empty() ? 0 : 1;
+    size_t count = first + _packets.size();
+    _msgIov.resize(2 * count);
+    _msgs.resize(count);
+    int bytes = 0;
+    for (size_t p = 0; p < count; p++)
+    {
+        if (p < first)
+        {
+            _msgIov[2 * p].iov_base = _held.data();
+            _msgIov[2 * p].iov_len = _held.size();
+            _msgIov[2 * p + 1].iov_len = 0;
+        }
+        else
+        {
+            const Packet &packet = _packets[p - first];
+            _msgIov[2 * p].iov_base = &_head[packet.head];
+            _msgIov[2 * p].iov_len = packet.headLen;
+            _msgIov[2 * p + 1].iov_base = (void *)packet.payload;
+            _msgIov[2 * p + 1].iov_len = packet.payloadLen;
+        }
+        memset(&_msgs[p], 0, sizeof _msgs[p]);
+        _msgs[p].msg_hdr.msg_name = &sa;
+        _msgs[p].msg_hdr.msg_namelen = sizeof sa;
+        _msgs[p].msg_hdr.msg_iov = &_msgIov[2 * p];
+        _msgs[p].msg_hdr.msg_iovlen = _msgIov[2 * p + 1].iov_len ? 2 : 1;
+        bytes += (int)(_msgIov[2 * p].iov_len + _msgIov[2 * p + 1].iov_len);
+    }
+    //stored before sending, a NACK may race the last packet of a run
+    for (size_t p = 0; p < count && _retransmit.enabled(); p++)
+    {
+        _retransmit.store(_msgs[p].msg_hdr.msg_iov, (int)_msgs[p].msg_hdr.msg_iovlen);
+    }
+    bool sent = !count || sendAll(_msgs.data(), (int)count);
+    _held.swap(_nextHeld);
+    return sent ? bytes : 0;
+}
+
+uint32_t RtpWriter::timestamp(int64_t pts) const
+{
+    if (_fpsNum && _fpsDenom)
+    {
+        return _tsOffset + (uint32_t)(pts * 90000 * _fpsDenom / _fpsNum);
+    }
+    return _lastTimestamp;
+}
+
+int RtpWriter::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    //parameter sets ahead of the first picture share its timestamp
+    int bytes = packetize(nal, nalcount, _lastTimestamp, false, false);
+    teeNals(nal, nalcount, bytes);
+    return bytes;
+}
+
+int RtpWriter::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    _lastTimestamp = timestamp(pic.pts);
+    int bytes = packetize(nal, nalcount, _lastTimestamp, true, false);
+    teeNals(nal, nalcount, bytes);
+    return bytes;
+}
+
+int RtpWriter::writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast)
+{
+    _lastTimestamp = timestamp(pts);
+    int bytes = packetize(nal, nalcount, _lastTimestamp, bLast, !bLast);
+    teeNals(nal, nalcount, bytes, bLast);
+    return bytes;
+}
+
+void RtpWriter::closeFile(int64_t largest_pts, int64_t second_largest_pts)
+{
+    UdpWriter::closeFile(largest_pts, second_largest_pts);
+    if (_retransmit.enabled())
+    {
+        Retransmitter::Stats stats = _retransmit.GetStats();
+        x265_log(NULL, X265_LOG_INFO, "rtp: %llu NACKs for %llu packets, %llu resent (%llu bytes), %llu no longer held\n",
+                 (unsigned long long)stats.nacks, (unsigned long long)stats.requested, (unsigned long long)stats.resent,
+                 (unsigned long long)stats.resentBytes, (unsigned long long)stats.expired);
+    }
+}
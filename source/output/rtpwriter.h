@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "retransmit.h"
+#include "writer.h"
+
+constexpr char RTP[] = "rtp://";
+
+/* rtp://ip:port[?mtu=bytes&pt=type&tee=file&pace=percent&nack=ms], RTP
+ * packetization of HEVC per RFC 7798, paced as udp:// is. NALs that fit
+ * the MTU go out as single NAL unit packets, larger ones as fragmentation
+ * units and runs of small parameter set and SEI NALs share aggregation
+ * packets. Timestamps are pic.pts on the 90kHz clock and
+ * the marker bit ends each access unit, also when it is streamed a slice at
+ * a time. There is no DONL, receivers should assume sprop-max-don-diff=0.
+ * nack= keeps the packets of the last ms milliseconds for receivers to ask
+ * for again with RTCP NACKs, see retransmit.h */
+class RtpWriter : public UdpWriter
+{
+public:
+    RtpWriter();
+    static RtpWriter *construct(const char* fname);
+
+    virtual const char* getName() const override{ return "rtp"; }
+    virtual void setParam(x265_param* param) override;
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+protected:
+    enum { RTP_HEADER = 12 };
+    enum { NAL_HEADER = 2 };
+    enum { FU_HEADER = 1 };
+    enum { AP_LENGTH = 2 };
+    enum { NACK_SLOTS = 8192 };//packets kept without a rate to size them from
+
+    /* a packet is its headers in _head followed by a stretch of NAL payload.
+     * Aggregation packets copy their small NALs into _head instead */
+    struct Packet
+    {
+        size_t head, headLen;//into _head
+        const uint8_t *payload;
+        size_t payloadLen;
+    };
+
+    virtual bool applyOptions(std::map<std::string, std::string> &options) override;
+    int packetize(const x265_nal* nal, uint32_t nalcount, uint32_t timestamp, bool marker, bool holdLast);
+    uint32_t timestamp(int64_t pts) const;
+    void addPacket(uint32_t timestamp, const uint8_t *payload, size_t payloadLen);
+    static bool aggregatable(int type);
+
+    int _maxPayload;//RTP payload bytes per packet
+    int _payloadType;
+    bool _annexB;
+    uint16_t _seq;
+    uint32_t _ssrc;
+    uint32_t _tsOffset;//random start, RFC 3550
+    uint32_t _fpsNum, _fpsDenom;
+    uint32_t _lastTimestamp;
+    std::vector<uint8_t> _head;
+    std::vector<Packet> _packets;
+    /* the last packet of a partial access unit, copied out and sent with
+     * the next part so the marker can go on whichever packet ends up last */
+    std::vector<uint8_t> _held, _nextHeld;
+    int _nackKeep;//milliseconds, 0 without retransmission
+    Retransmitter _retransmit;
+};
@@ -0,0 +1,63 @@
+/* Test reader for shm://name: shmcat [-v] name [file.hevc] waits for an
+ * encoder to create the ring, then writes what it reads to file, if given,
+ * and prints a line per record with -v and a summary at the end */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shmreader.h"
+
+int main(int argc, char **argv)
+{
+    bool verbose = argc > 1 && !strcmp(argv[1], "-v");
+    if (argc < 2 + verbose || argc > 3 + verbose)
+    {
+        fprintf(stderr, "usage: %s [-v] name [file.hevc]\n", argv[0]);
+        return 1;
+    }
+    const char *name = argv[1 + verbose];
+    FILE *out = nullptr;
+    if (argc == 3 + verbose)
+    {
+        out = fopen(argv[2 + verbose], "wb");
+        if (!out)
+        {
+            fprintf(stderr, "unable to open %s\n", argv[2 + verbose]);
+            return 1;
+        }
+    }
+
+    ShmReader reader;
+    while (!reader.open(name))
+    {
+        usleep(100000);
+    }
+    unsigned long long records = 0, units = 0, irap = 0, bytes = 0;
+    ShmReader::Au au;
+    while (reader.read(au))
+    {
+        records++;
+        units += !!(au.flags & SHM_AU_END);
+        irap += !!(au.flags & SHM_AU_IRAP);
+        bytes += au.size;
+        if (verbose)
+        {
+            printf("%s%s%s type %d pts %lld dts %lld %u bytes\n", au.flags & SHM_AU_HEADERS ? "headers" : "slices",
+                   au.flags & SHM_AU_IRAP ? " irap" : "", au.flags & SHM_AU_END ? " end" : "",
+                   au.type, (long long)au.pts, (long long)au.dts, au.size);
+        }
+        if (out && fwrite(au.payload, 1, au.size, out) != au.size)
+        {
+            fprintf(stderr, "write error\n");
+            break;
+        }
+        reader.release();
+    }
+    printf("%llu records, %llu access units (%llu IRAP), %llu bytes at %d/%d fps\n",
+           records, units, irap, bytes, reader.fpsNum(), reader.fpsDenom());
+    if (out)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "shmreader.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+int64_t nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+}//namespace
+
+ShmReader::ShmReader()
+    : _fd(-1)
+    , _ring(nullptr)
+    , _data(nullptr)
+    , _mapped(0)
+    , _tail(0)
+    , _pending(0)
+    , _attached(false)
+    , _synced(false)
+    , _auStart(false)
+{}
+
+ShmReader::~ShmReader()
+{
+    close();
+}
+
+bool ShmReader::open(const char *name)
+{
+    close();
+    if (!strncmp(name, SHM, strlen(SHM)))
+    {
+        name += strlen(SHM);
+    }
+    std::string path = std::string("/") + name;
+    _fd = shm_open(path.c_str(), O_RDWR, 0);
+    if (_fd == -1)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(_fd, &st) || st.st_size <= SHM_DATA_OFFSET)
+    {
+        //created, not sized yet
+        close();
+        return false;
+    }
+    _mapped = (size_t)st.st_size;
+    void *base = mmap(nullptr, _mapped, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (base == MAP_FAILED)
+    {
+        _mapped = 0;
+        close();
+        return false;
+    }
+    _ring = static_cast<ShmRing *>(base);
+    _data = static_cast<const uint8_t *>(base) + SHM_DATA_OFFSET;
+    if (_ring->magic != SHM_MAGIC)
+    {
+        close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_ring->version != SHM_VERSION || SHM_DATA_OFFSET + _ring->capacity != _mapped)
+    {
+        close();
+        return false;
+    }
+    //take the place of a reader that crashed while attached
+    uint32_t expected = 0;
+    if (!_ring->attached.compare_exchange_strong(expected, (uint32_t)getpid()) &&
+        (shmAlive(expected) || !_ring->attached.compare_exchange_strong(expected, (uint32_t)getpid())))
+    {
+        close();
+        return false;
+    }
+    _attached = true;
+    _pending = 0;
+
+    /* join at new data, everything before it is the encoder's past. While
+     * only the headers are written they are kept, they start the stream */
+    _tail = _ring->head.load(std::memory_order_acquire);
+    const ShmAu *first = reinterpret_cast<const ShmAu *>(_data);
+    if (_tail && _tail <= _ring->capacity && (first->flags & SHM_AU_HEADERS) && _tail == shmRecordBytes(first->size))
+    {
+        _tail = 0;
+    }
+    _synced = false;
+    _auStart = !_tail;
+    //the room a reader that left, or none, held back is free again
+    advance(0);
+    return true;
+}
+
+void ShmReader::close()
+{
+    if (_attached)
+    {
+        if (_pending)
+        {
+            release();
+        }
+        //unless the writer took it for gone
+        uint32_t self = (uint32_t)getpid();
+        _ring->attached.compare_exchange_strong(self, 0);
+        //a writer blocked on us drops instead from now on
+        _ring->consumed.fetch_add(1);
+        shmFutexWake(_ring->consumed);
+        _attached = false;
+    }
+    if (_ring)
+    {
+        munmap(_ring, _mapped);
+        _ring = nullptr;
+    }
+    if (_fd != -1)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void ShmReader::advance(uint64_t bytes)
+{
+    _tail += bytes;
+    _ring->tail.store(_tail, std::memory_order_release);
+    _ring->consumed.fetch_add(1);
+    if (_ring->writerWaiting.exchange(0))
+    {
+        shmFutexWake(_ring->consumed);
+    }
+}
+
+bool ShmReader::read(Au &au, int timeoutMs)
+{
+    if (!_ring)
+    {
+        return false;
+    }
+    if (_pending)
+    {
+        release();
+    }
+    int64_t deadline = timeoutMs < 0 ? 0 : nowMs() + timeoutMs;
+    for (;;)
+    {
+        //taken before head, a record published after it fails the futex wait
+        uint32_t published = _ring->published.load();
+        if (_ring->head.load(std::memory_order_acquire) != _tail)
+        {
+            const ShmAu *header = reinterpret_cast<const ShmAu *>(_data + (_tail & (_ring->capacity - 1)));
+            if (header->flags & SHM_AU_SKIP)
+            {
+                advance(sizeof *header + header->size);
+                continue;
+            }
+            //joined mid-stream, decoding starts at headers or an IRAP access unit
+            if (!_synced)
+            {
+                bool start = (header->flags & SHM_AU_HEADERS) || ((header->flags & SHM_AU_IRAP) && _auStart);
+                if (!start)
+                {
+                    _auStart = !!(header->flags & SHM_AU_END);
+                    advance(shmRecordBytes(header->size));
+                    continue;
+                }
+                _synced = true;
+            }
+            au.payload = reinterpret_cast<const uint8_t *>(header + 1);
+            au.size = header->size;
+            au.type = header->type;
+            au.flags = header->flags;
+            au.pts = header->pts;
+            au.dts = header->dts;
+            _pending = shmRecordBytes(header->size);
+            return true;
+        }
+        if (_ring->closed.load())
+        {
+            //closed after the last record, which the head above may have missed
+            if (_ring->head.load(std::memory_order_acquire) != _tail)
+            {
+                continue;
+            }
+            return false;
+        }
+        int timeout = SHM_CHECK_MS;
+        if (timeoutMs >= 0)
+        {
+            timeout = (int)(deadline - nowMs());
+            if (timeout <= 0)
+            {
+                return false;
+            }
+            timeout = std::min(timeout, (int)SHM_CHECK_MS);
+        }
+        _ring->readerWaiting.store(1);
+        if (!shmFutexWait(_ring->published, published, timeout) && !shmAlive(_ring->writer.load()))
+        {
+            //the encoder crashed, nothing more will come
+            return false;
+        }
+    }
+}
+
+void ShmReader::release()
+{
+    if (_pending)
+    {
+        uint64_t bytes = _pending;
+        _pending = 0;
+        advance(bytes);
+    }
+}
+
+bool ShmReader::closed() const
+{
+    return !_ring || ((_ring->closed.load() || !shmAlive(_ring->writer.load())) && _ring->head.load() == _tail);
+}
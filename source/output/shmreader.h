@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "shmring.h"
+
+/* Consumer of shm://name (shmwriter.h), for a viewer on the same host. It
+ * needs nothing from libx265. read hands out the next record in place in
+ * the ring, valid until release or the next read, which give its room back
+ * to the encoder; until then the encoder may block on a full ring. One
+ * reader at a time. open joins at the newest record, or at the headers if
+ * no picture followed them yet, and read skips to the first headers or
+ * IRAP access unit from there */
+class ShmReader
+{
+public:
+    struct Au
+    {
+        const uint8_t *payload;//Annex B NAL units
+        uint32_t size;
+        int type;//X265_TYPE_* of the picture, 0 for headers and streamed slices
+        int flags;//SHM_AU_*
+        int64_t pts;
+        int64_t dts;
+    };
+
+    ShmReader();
+    ~ShmReader();
+
+    //name with or without shm://, false while no encoder has created it
+    bool open(const char *name);
+    void close();
+    //false on timeout, -1 waits, or once the encoder closed or exited and all is read
+    bool read(Au &au, int timeoutMs = -1);
+    void release();
+    bool closed() const;
+    int fpsNum() const { return _ring ? _ring->fpsNum : 0; }
+    int fpsDenom() const { return _ring ? _ring->fpsDenom : 0; }
+
+protected:
+    void advance(uint64_t bytes);
+
+    int _fd;
+    ShmRing *_ring;
+    const uint8_t *_data;
+    size_t _mapped;
+    uint64_t _tail;
+    uint64_t _pending;//bytes of the record handed out
+    bool _attached;
+    bool _synced;//read reached headers or an IRAP access unit
+    bool _auStart;//the record at _tail starts an access unit
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <errno.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Layout of the shared memory object behind shm://name, shared by
+ * ShmWriter (shmwriter.h) and ShmReader (shmreader.h). /dev/shm/name starts
+ * with a ShmRing page and is followed by capacity bytes of ring. The ring
+ * holds records, a ShmAu header and then its payload, each padded to
+ * SHM_ALIGN so a record never splits a header at the end of the ring; one
+ * that does not fit before the end is preceded by an SHM_AU_SKIP record
+ * filling the rest. head and tail count bytes since the start: the single
+ * writer advances head once a record is complete, the single reader
+ * advances tail once it is done with the payload, which it reads in place,
+ * and moves it up to head when it attaches.
+ * Whoever finds the ring empty or full sleeps on the other side's futex
+ * counter, and is woken only when it said it sleeps. Both sides record
+ * their pid and wake every SHM_CHECK_MS while they sleep, so one that
+ * crashed does not hold up the other or keep the name */
+constexpr char SHM[] = "shm://";
+
+enum
+{
+    SHM_MAGIC = 0x35363278,//"x265"
+    SHM_VERSION = 2,
+    SHM_ALIGN = 32,
+    SHM_DATA_OFFSET = 4096,
+    SHM_CHECK_MS = 100,//longest sleep before looking whether the other side still runs
+};
+
+//ShmAu::flags
+enum
+{
+    SHM_AU_HEADERS = 1,//VPS, SPS and PPS from encoder_headers
+    SHM_AU_END = 2,//ends an access unit, unset on the slices of --stream-slices but the last
+    SHM_AU_IRAP = 4,
+    SHM_AU_SKIP = 8,//padding up to the end of the ring
+};
+
+struct ShmAu
+{
+    uint32_t size;//payload bytes following the header, Annex B NAL units
+    uint16_t type;//X265_TYPE_* of the picture, 0 for headers and streamed slices
+    uint16_t flags;
+    uint32_t reserved[2];
+    int64_t pts;
+    int64_t dts;
+};
+static_assert(sizeof(ShmAu) == SHM_ALIGN, "ShmAu pads records to SHM_ALIGN");
+
+struct ShmRing
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;//ring bytes, a power of two
+    int32_t fpsNum, fpsDenom;
+
+    //written by the writer
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> published;//futex word, bumped per record
+    std::atomic<uint32_t> readerWaiting;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> writer;//pid of the encoder
+
+    //written by the reader
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> consumed;//futex word, bumped per record
+    std::atomic<uint32_t> writerWaiting;
+    std::atomic<uint32_t> attached;//pid of the reader that has the ring open, 0 for none
+};
+static_assert(sizeof(ShmRing) <= SHM_DATA_OFFSET, "ShmRing fits the first page");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "the ring is shared between processes");
+
+//shared, not FUTEX_PRIVATE_FLAG: the words are in memory of two processes
+inline bool shmFutexWait(std::atomic<uint32_t> &word, uint32_t value, int timeoutMs)
+{
+    struct timespec timeout = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000 };
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, value,
+                       timeoutMs < 0 ? nullptr : &timeout, nullptr, 0);
+    return !ret || errno != ETIMEDOUT;
+}
+
+inline void shmFutexWake(std::atomic<uint32_t> &word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+//false once the process with pid exited, also for 0
+inline bool shmAlive(uint32_t pid)
+{
+    return pid && (!kill((pid_t)pid, 0) || errno != ESRCH);
+}
+
+inline uint64_t shmRecordBytes(uint32_t size)
+{
+    return (sizeof(ShmAu) + size + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1);
+}
@@ -0,0 +1,287 @@
+#include "shmwriter.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+using namespace X265_NS;
+
+ShmWriter::ShmWriter()
+    : _fd(-1)
+    , _ring(nullptr)
+    , _data(nullptr)
+    , _mapped(0)
+    , _wait(-1)
+{
+    memset(&_stats, 0, sizeof _stats);
+}
+
+ShmWriter::~ShmWriter()
+{
+    if (_ring)
+    {
+        munmap(_ring, _mapped);
+    }
+    if (_fd != -1)
+    {
+        close(_fd);
+        //a reader keeps its mapping, the name is free for the next encode
+        shm_unlink(_name.c_str());
+    }
+}
+
+ShmWriter *ShmWriter::construct(const char* fname)
+{
+    std::string name;
+    std::map<std::string, std::string> options;
+    if (!parseUrl(fname, name, options))
+    {
+        return nullptr;
+    }
+    if (name.empty() || name.find('/') != std::string::npos)
+    {
+        std::cout << "Invalid shared memory name in " << fname << "\n";
+        return nullptr;
+    }
+
+    auto out = new ShmWriter();
+    uint64_t mib = 16;
+    for (auto &option : options)
+    {
+        int value = atoi(option.second.c_str());
+        if (option.first == "size" && value >= 1 && value <= 4096)
+        {
+            mib = (uint64_t)value;
+        }
+        else if (option.first == "wait" && value >= 1)
+        {
+            out->_wait = value;
+        }
+        else
+        {
+            std::cout << "Invalid shm option " << option.first << "=" << option.second << "\n";
+            delete out;
+            return nullptr;
+        }
+    }
+    //a power of two, so positions wrap with a mask
+    uint64_t capacity = 1;
+    while (capacity < (mib << 20))
+    {
+        capacity <<= 1;
+    }
+    if (!out->create("/" + name, capacity))
+    {
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+bool ShmWriter::create(const std::string &name, uint64_t capacity)
+{
+    /* a ring left by an encode that crashed has nobody writing to it and
+     * can go, one whose encoder still runs is not ours */
+    int existing = shm_open(name.c_str(), O_RDONLY, 0);
+    if (existing != -1)
+    {
+        bool ours = false;
+        uint32_t writer = 0;
+        struct stat st;
+        if (!fstat(existing, &st) && st.st_size >= SHM_DATA_OFFSET)
+        {
+            void *base = mmap(nullptr, SHM_DATA_OFFSET, PROT_READ, MAP_SHARED, existing, 0);
+            if (base != MAP_FAILED)
+            {
+                const ShmRing *ring = static_cast<const ShmRing *>(base);
+                ours = ring->magic == SHM_MAGIC && ring->version == SHM_VERSION;
+                writer = ring->writer.load();
+                munmap(base, SHM_DATA_OFFSET);
+            }
+        }
+        close(existing);
+        if (!ours)
+        {
+            std::cout << "Shared memory " << name << " exists and is no ring of this encoder, remove /dev/shm" << name << "\n";
+            return false;
+        }
+        if (shmAlive(writer))
+        {
+            std::cout << "Shared memory " << name << " is in use by the encoder with pid " << writer << "\n";
+            return false;
+        }
+        shm_unlink(name.c_str());
+    }
+    _fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (_fd == -1)
+    {
+        std::cout << "Unable to create shared memory " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    _name = name;
+    _mapped = SHM_DATA_OFFSET + capacity;
+    if (ftruncate(_fd, (off_t)_mapped))
+    {
+        std::cout << "Unable to size shared memory " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    void *base = mmap(nullptr, _mapped, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (base == MAP_FAILED)
+    {
+        std::cout << "Unable to map shared memory " << name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    //ftruncate zeroed it, every counter starts at 0
+    _ring = static_cast<ShmRing *>(base);
+    _data = static_cast<uint8_t *>(base) + SHM_DATA_OFFSET;
+    _ring->capacity = capacity;
+    _ring->version = SHM_VERSION;
+    _ring->writer.store((uint32_t)getpid());
+    std::atomic_thread_fence(std::memory_order_release);
+    _ring->magic = SHM_MAGIC;
+    return true;
+}
+
+void ShmWriter::setParam(x265_param* param)
+{
+    _ring->fpsNum = (int32_t)param->fpsNum;
+    _ring->fpsDenom = (int32_t)param->fpsDenom;
+}
+
+bool ShmWriter::waitForRoom(uint64_t head, uint64_t bytes)
+{
+    int64_t start = 0;
+    bool room = true;
+    for (;;)
+    {
+        //taken before tail, a record released after it fails the futex wait
+        uint32_t consumed = _ring->consumed.load();
+        if (_ring->capacity - (head - _ring->tail.load()) >= bytes)
+        {
+            break;
+        }
+        uint32_t reader = _ring->attached.load();
+        if (!reader)
+        {
+            room = false;
+            break;
+        }
+        if (!start)
+        {
+            start = x265_mdate();
+            _stats.waits++;
+        }
+        int timeout = SHM_CHECK_MS;
+        if (_wait > 0)
+        {
+            timeout = _wait - (int)((x265_mdate() - start) / 1000);
+            if (timeout <= 0)
+            {
+                room = false;
+                break;
+            }
+            timeout = std::min(timeout, (int)SHM_CHECK_MS);
+        }
+        _ring->writerWaiting.store(1);
+        if (!shmFutexWait(_ring->consumed, consumed, timeout) && !shmAlive(reader))
+        {
+            //detach a reader that crashed, the next pass drops
+            x265_log(NULL, X265_LOG_WARNING, "shm: %s: reader %u exited without detaching\n", _name.c_str() + 1, reader);
+            _ring->attached.compare_exchange_strong(reader, 0);
+        }
+    }
+    if (start)
+    {
+        _stats.waitTime += x265_mdate() - start;
+    }
+    return room;
+}
+
+int ShmWriter::write(const x265_nal* nal, uint32_t nalcount, int type, int flags, int64_t pts, int64_t dts)
+{
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        size += nal[i].sizeBytes;
+        if (nal[i].type >= NAL_UNIT_CODED_SLICE_BLA_W_LP && nal[i].type <= NAL_UNIT_CODED_SLICE_CRA)
+        {
+            flags |= SHM_AU_IRAP;
+        }
+    }
+    uint64_t bytes = shmRecordBytes(size);
+    uint64_t head = _ring->head.load(std::memory_order_relaxed);
+    uint64_t mask = _ring->capacity - 1;
+    //records are contiguous, one that would wrap starts the ring over
+    uint64_t skip = (head & mask) + bytes > _ring->capacity ? _ring->capacity - (head & mask) : 0;
+    if (bytes > _ring->capacity || !waitForRoom(head, skip + bytes))
+    {
+        _stats.dropped++;
+        return 0;
+    }
+    if (skip)
+    {
+        ShmAu *pad = reinterpret_cast<ShmAu *>(_data + (head & mask));
+        memset(pad, 0, sizeof *pad);
+        pad->size = (uint32_t)(skip - sizeof *pad);
+        pad->flags = SHM_AU_SKIP;
+        head += skip;
+    }
+
+    ShmAu *au = reinterpret_cast<ShmAu *>(_data + (head & mask));
+    memset(au, 0, sizeof *au);
+    au->size = size;
+    au->type = (uint16_t)type;
+    au->flags = (uint16_t)flags;
+    au->pts = pts;
+    au->dts = dts;
+    uint8_t *dst = reinterpret_cast<uint8_t *>(au + 1);
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        memcpy(dst, nal[i].payload, nal[i].sizeBytes);
+        dst += nal[i].sizeBytes;
+    }
+
+    _ring->head.store(head + bytes, std::memory_order_release);
+    _ring->published.fetch_add(1);
+    if (_ring->readerWaiting.exchange(0))
+    {
+        shmFutexWake(_ring->published);
+    }
+    _stats.records++;
+    _stats.bytes += size;
+    return (int)size;
+}
+
+int ShmWriter::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    return write(nal, nalcount, 0, SHM_AU_HEADERS, 0, 0);
+}
+
+int ShmWriter::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    return write(nal, nalcount, pic.sliceType, SHM_AU_END, pic.pts, pic.dts);
+}
+
+int ShmWriter::writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast)
+{
+    return write(nal, nalcount, 0, bLast ? SHM_AU_END : 0, pts, pts);
+}
+
+void ShmWriter::closeFile(int64_t, int64_t)
+{
+    _ring->closed.store(1);
+    _ring->published.fetch_add(1);
+    if (_ring->readerWaiting.exchange(0))
+    {
+        shmFutexWake(_ring->published);
+    }
+    x265_log(NULL, X265_LOG_INFO, "shm: %s: %llu records (%llu bytes), %llu dropped, ring full %llu times for %.1f ms\n",
+             _name.c_str() + 1, (unsigned long long)_stats.records, (unsigned long long)_stats.bytes,
+             (unsigned long long)_stats.dropped, (unsigned long long)_stats.waits, _stats.waitTime / 1000.0);
+}
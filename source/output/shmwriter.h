@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "output.h"
+#include "shmring.h"
+
+/* shm://name[?size=MiB&wait=ms], access units for a reader on the same
+ * host, in a ring in /dev/shm/name laid out as shmring.h describes and read
+ * with ShmReader. Each access unit, or slice when streaming, is written
+ * once into the ring and read in place, no socket in between. size= is the
+ * ring, 16 MiB by default. While a reader is attached a full ring blocks
+ * the encoder until the reader catches up or exits; wait= gives up after
+ * ms and drops the access unit instead. Without a reader access units that
+ * do not fit are dropped. A reader attaching later joins at new data, from
+ * the next IRAP access unit, which needs --repeat-headers to decode */
+class ShmWriter : public x265::OutputFile
+{
+public:
+    ShmWriter();
+    ~ShmWriter();
+    static ShmWriter *construct(const char* fname);
+
+    virtual bool isFail() const override { return !_ring; }
+    virtual bool needPTS() const override { return false; }
+    virtual void release() override { delete this; }
+    virtual const char* getName() const override { return "shm"; }
+    virtual void setParam(x265_param* param) override;
+
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual bool canStream() const override { return true; }
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+protected:
+    struct Stats
+    {
+        uint64_t records;
+        uint64_t bytes;
+        uint64_t dropped;
+        uint64_t waits;//times the ring was full
+        int64_t waitTime;//microseconds blocked on the reader
+    };
+
+    bool create(const std::string &name, uint64_t capacity);
+    //false when the reader did not make room in time or there is none
+    bool waitForRoom(uint64_t head, uint64_t bytes);
+    int write(const x265_nal* nal, uint32_t nalcount, int type, int flags, int64_t pts, int64_t dts);
+
+    std::string _name;
+    int _fd;
+    ShmRing *_ring;
+    uint8_t *_data;
+    size_t _mapped;
+    int _wait;//ms, -1 waits as long as the attached reader runs
+    Stats _stats;
+};
@@ -0,0 +1,249 @@
+#include "tsmux.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+//an access unit delimiter, pic_type 2 allows any slice type
+const uint8_t AUD[] = { 0, 0, 0, 1, NAL_UNIT_ACCESS_UNIT_DELIMITER << 1, 1, 0x50 };
+
+//CRC-32/MPEG-2 of PSI sections, only computed when they are built
+uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void writeTimestamp(uint8_t *p, int prefix, int64_t ts)
+{
+    p[0] = (uint8_t)(prefix << 4 | ((ts >> 29) & 0x0e) | 1);
+    p[1] = (uint8_t)(ts >> 22);
+    p[2] = (uint8_t)(((ts >> 14) & 0xfe) | 1);
+    p[3] = (uint8_t)(ts >> 7);
+    p[4] = (uint8_t)(((ts << 1) & 0xfe) | 1);
+}
+
+bool isIrap(int type)
+{
+    return type >= NAL_UNIT_CODED_SLICE_BLA_W_LP && type <= NAL_UNIT_CODED_SLICE_CRA;
+}
+}//namespace
+
+TsMuxer::TsMuxer()
+    : _patCc(0)
+    , _pmtCc(0)
+    , _videoCc(0)
+    , _size(0)
+    , _fpsNum(0)
+    , _fpsDenom(0)
+    , _pcrDelay(90000 / 2)
+    , _lastPsi(-1)
+{
+    //one program, its PMT on PID_PMT and its PCR on the video PID
+    const uint8_t pat[] =
+    {
+        0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0x00, 0x01, 0xe0 | PID_PMT >> 8, PID_PMT & 0xff,
+    };
+    const uint8_t pmt[] =
+    {
+        0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0xe0 | PID_VIDEO >> 8, PID_VIDEO & 0xff, 0xf0, 0x00,
+        0x24, 0xe0 | PID_VIDEO >> 8, PID_VIDEO & 0xff, 0xf0, 0x00,
+    };
+    psiPacket(_pat, PID_PAT, pat, sizeof pat);
+    psiPacket(_pmt, PID_PMT, pmt, sizeof pmt);
+    _buffer.resize(PACKET_SIZE * 1024);
+}
+
+void TsMuxer::psiPacket(uint8_t *packet, uint16_t pid, const uint8_t *section, size_t len)
+{
+    memset(packet, 0xff, PACKET_SIZE);
+    packet[0] = 0x47;
+    packet[1] = (uint8_t)(0x40 | pid >> 8);
+    packet[2] = (uint8_t)pid;
+    packet[3] = 0x10;
+    packet[4] = 0;//pointer field
+    memcpy(packet + 5, section, len);
+    uint32_t crc = crc32(section, len);
+    packet[5 + len] = (uint8_t)(crc >> 24);
+    packet[6 + len] = (uint8_t)(crc >> 16);
+    packet[7 + len] = (uint8_t)(crc >> 8);
+    packet[8 + len] = (uint8_t)crc;
+}
+
+void TsMuxer::setParam(const x265_param* param)
+{
+    _fpsNum = param->fpsNum;
+    _fpsDenom = param->fpsDenom;
+    //a decoder buffer's worth ahead of the decoding time, as VBV models it
+    if (param->rc.vbvMaxBitrate > 0 && param->rc.vbvBufferSize > 0)
+    {
+        _pcrDelay = std::min<int64_t>((int64_t)param->rc.vbvBufferSize * 90000 / param->rc.vbvMaxBitrate, CLOCK_OFFSET / 2);
+    }
+}
+
+void TsMuxer::setHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    _headers.clear();
+    _parameterSets.clear();
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        _headers.insert(_headers.end(), nal[i].payload, nal[i].payload + nal[i].sizeBytes);
+        //the SEI only goes out once
+        if (nal[i].type >= NAL_UNIT_VPS && nal[i].type <= NAL_UNIT_PPS)
+        {
+            _parameterSets.insert(_parameterSets.end(), nal[i].payload, nal[i].payload + nal[i].sizeBytes);
+        }
+    }
+}
+
+int64_t TsMuxer::clock(int64_t pts) const
+{
+    int64_t ticks = _fpsNum && _fpsDenom ? pts * 90000 * _fpsDenom / _fpsNum : pts;
+    return (ticks + CLOCK_OFFSET) & ((1LL << 33) - 1);
+}
+
+void TsMuxer::writePsi()
+{
+    uint8_t *out = _buffer.data() + _size;
+    memcpy(out, _pat, PACKET_SIZE);
+    out[3] = (uint8_t)(0x10 | (_patCc++ & 0x0f));
+    memcpy(out + PACKET_SIZE, _pmt, PACKET_SIZE);
+    out[PACKET_SIZE + 3] = (uint8_t)(0x10 | (_pmtCc++ & 0x0f));
+    _size += 2 * PACKET_SIZE;
+}
+
+void TsMuxer::mux(const x265_nal* nal, uint32_t nalcount, const x265_picture& pic)
+{
+    bool irap = false, parameterSets = false;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        irap |= isIrap(nal[i].type);
+        parameterSets |= nal[i].type == NAL_UNIT_VPS;
+    }
+    _chunks.clear();
+    if (!nalcount || nal[0].type != NAL_UNIT_ACCESS_UNIT_DELIMITER)
+    {
+        _chunks.push_back({ AUD, sizeof AUD });
+    }
+    if (!_headers.empty())
+    {
+        _chunks.push_back({ _headers.data(), _headers.size() });
+    }
+    else if (irap && !parameterSets && !_parameterSets.empty())
+    {
+        _chunks.push_back({ _parameterSets.data(), _parameterSets.size() });
+    }
+    size_t left = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        _chunks.push_back({ nal[i].payload, nal[i].sizeBytes });
+    }
+    for (const Chunk &chunk : _chunks)
+    {
+        left += chunk.len;
+    }
+
+    //PAT, PMT and the PES packet, its first TS packet holding the PCR and PES headers
+    size_t packets = 2 + 1 + (left + PCR_FIELD + PES_HEADER + PAYLOAD_SIZE - 1) / PAYLOAD_SIZE;
+    if (_buffer.size() < packets * PACKET_SIZE)
+    {
+        _buffer.resize(packets * PACKET_SIZE);
+    }
+    _size = 0;
+
+    int64_t pts = clock(pic.pts);
+    int64_t dts = clock(pic.dts);
+    if (irap || _lastPsi < 0 || ((dts - _lastPsi) & ((1LL << 33) - 1)) >= PSI_INTERVAL)
+    {
+        writePsi();
+        _lastPsi = dts;
+    }
+
+    uint8_t pes[PES_HEADER] = { 0, 0, 1, 0xe0, 0, 0, 0x84 };//unbounded video PES, data aligned
+    size_t pesLen;
+    if (pts != dts)
+    {
+        pes[7] = 0xc0;
+        pes[8] = 10;
+        writeTimestamp(pes + 9, 3, pts);
+        writeTimestamp(pes + 14, 1, dts);
+        pesLen = 19;
+    }
+    else
+    {
+        pes[7] = 0x80;
+        pes[8] = 5;
+        writeTimestamp(pes + 9, 2, pts);
+        pesLen = 14;
+    }
+    int64_t pcr = (dts - _pcrDelay) & ((1LL << 33) - 1);
+
+    size_t chunk = 0, offset = 0;
+    for (bool first = true; first || left; first = false)
+    {
+        uint8_t *out = _buffer.data() + _size;
+        size_t header = first ? PCR_FIELD + pesLen : 0;
+        size_t take = std::min(left, (size_t)PAYLOAD_SIZE - header);
+        size_t stuffing = PAYLOAD_SIZE - header - take;
+        bool adaptation = first || stuffing;
+
+        out[0] = 0x47;
+        out[1] = (uint8_t)((first ? 0x40 : 0) | PID_VIDEO >> 8);
+        out[2] = (uint8_t)(PID_VIDEO & 0xff);
+        out[3] = (uint8_t)((adaptation ? 0x30 : 0x10) | (_videoCc++ & 0x0f));
+        uint8_t *p = out + 4;
+        if (first)
+        {
+            p[0] = (uint8_t)(PCR_FIELD - 1 + stuffing);
+            p[1] = (uint8_t)(0x10 | (irap ? 0x40 : 0));//PCR, random access
+            p[2] = (uint8_t)(pcr >> 25);
+            p[3] = (uint8_t)(pcr >> 17);
+            p[4] = (uint8_t)(pcr >> 9);
+            p[5] = (uint8_t)(pcr >> 1);
+            p[6] = (uint8_t)((pcr & 1) << 7 | 0x7e);
+            p[7] = 0;
+            memset(p + PCR_FIELD, 0xff, stuffing);
+            p += PCR_FIELD + stuffing;
+            memcpy(p, pes, pesLen);
+            p += pesLen;
+        }
+        else if (stuffing)
+        {
+            //a lone length byte is one byte of stuffing, then flags and 0xff
+            p[0] = (uint8_t)(stuffing - 1);
+            if (stuffing > 1)
+            {
+                p[1] = 0;
+                memset(p + 2, 0xff, stuffing - 2);
+            }
+            p += stuffing;
+        }
+
+        left -= take;
+        while (take)
+        {
+            size_t n = std::min(take, _chunks[chunk].len - offset);
+            memcpy(p, _chunks[chunk].data + offset, n);
+            p += n;
+            take -= n;
+            offset += n;
+            if (offset == _chunks[chunk].len)
+            {
+                chunk++;
+                offset = 0;
+            }
+        }
+        _size += PACKET_SIZE;
+    }
+    _headers.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "x265.h"
+
+/* MPEG-2 transport stream muxer for one HEVC program, ISO/IEC 13818-1.
+ * Each access unit becomes a PES packet on PID_VIDEO, stream type 0x24,
+ * with PTS and DTS on the 90kHz clock from pic.pts and pic.dts. Its first
+ * TS packet carries the PCR, DTS minus the VBV buffer duration, and is
+ * flagged random access on IRAP pictures. PAT and PMT come before every
+ * IRAP picture and at least every PSI_INTERVAL. IRAP pictures without
+ * parameter sets get those of setHeaders again, and an access unit delimiter is
+ * added to access units without one, both as the standard wants for
+ * receivers joining late. Packets are laid out in one pass into a buffer
+ * that only grows to the largest access unit so far */
+class TsMuxer
+{
+public:
+    enum { PACKET_SIZE = 188 };
+    enum { PID_PAT = 0, PID_PMT = 0x1000, PID_VIDEO = 0x100, PID_NULL = 0x1fff };
+
+    TsMuxer();
+
+    void setParam(const x265_param* param);
+    //sent with the next access unit, the parameter sets again ahead of IRAP pictures that lack them
+    void setHeaders(const x265_nal* nal, uint32_t nalcount);
+    //replaces the packets of the previous access unit in data()
+    void mux(const x265_nal* nal, uint32_t nalcount, const x265_picture& pic);
+
+    const uint8_t *data() const { return _buffer.data(); }
+    size_t size() const { return _size; }
+
+protected:
+    enum { PAYLOAD_SIZE = PACKET_SIZE - 4 };
+    enum { PCR_FIELD = 8 };//adaptation field length, flags and PCR
+    enum { PES_HEADER = 19 };//with PTS and DTS
+    enum { PSI_INTERVAL = 90000 / 10 };
+    enum { CLOCK_OFFSET = 90000 };//first DTS, room for the PCR delay and B-frame reordering
+
+    struct Chunk
+    {
+        const uint8_t *data;
+        size_t len;
+    };
+
+    static void psiPacket(uint8_t *packet, uint16_t pid, const uint8_t *section, size_t len);
+    int64_t clock(int64_t pts) const;
+    void writePsi();
+
+    uint8_t _pat[PACKET_SIZE], _pmt[PACKET_SIZE];
+    uint8_t _patCc, _pmtCc, _videoCc;//continuity counters
+    std::vector<uint8_t> _buffer;
+    size_t _size;
+    std::vector<uint8_t> _headers;//until the next access unit
+    std::vector<uint8_t> _parameterSets;
+    std::vector<Chunk> _chunks;
+    uint32_t _fpsNum, _fpsDenom;
+    int64_t _pcrDelay;//90kHz ticks
+    int64_t _lastPsi;//DTS, -1 before the first
+};
@@ -0,0 +1,131 @@
+#include "tswriter.h"
+
+#include "common.h"
+
+using namespace X265_NS;
+
+TsWriter::TsWriter()
+    : _fp(nullptr)
+{}
+
+TsWriter::~TsWriter()
+{
+    if (_fp && _fp != stdout)
+    {
+        fclose(_fp);
+    }
+}
+
+TsWriter *TsWriter::construct(const char* fname)
+{
+    const char *path = fname + strlen(TS);
+    auto out = new TsWriter();
+    out->_fp = strcmp(path, "-") ? x265_fopen(path, "wb") : stdout;
+    if (!out->_fp)
+    {
+        std::cout << "Unable to open " << path << ": " << strerror(errno) << "\n";
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+void TsWriter::setParam(x265_param* param)
+{
+    param->bAnnexB = true;
+    _mux.setParam(param);
+}
+
+int TsWriter::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    //they go out in the PES packet of the first picture
+    _mux.setHeaders(nal, nalcount);
+    return 0;
+}
+
+int TsWriter::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    _mux.mux(nal, nalcount, pic);
+    if (fwrite(_mux.data(), 1, _mux.size(), _fp) != _mux.size())
+    {
+        return 0;
+    }
+    return (int)_mux.size();
+}
+
+void TsWriter::closeFile(int64_t, int64_t)
+{
+    fflush(_fp);
+}
+
+UdpTsWriter *UdpTsWriter::construct(const char* fname)
+{
+    std::string ip;
+    unsigned short port;
+    std::map<std::string, std::string> options;
+    if (!parseUrl(fname, ip, port, options))
+    {
+        return nullptr;
+    }
+    auto out = new UdpTsWriter();
+    if(!out->initialize())
+    {
+        delete out;
+        return nullptr;
+    }
+    //the datagrams are cut at packet boundaries here, not by the kernel
+    out->disableGso();
+    out->setendpoint(ip.c_str(), port);
+    if (!out->applyOptions(options))
+    {
+        delete out;
+        return nullptr;
+    }
+    return out;
+}
+
+bool UdpTsWriter::applyOptions(std::map<std::string, std::string> &options)
+{
+    if (options.count("fec") || options.count("mtu"))
+    {
+        std::cout << "fec and mtu are options of udp outputs, udp+ts sends " << (int)TS_DATAGRAM << " TS packets a datagram\n";
+        return false;
+    }
+    return UdpWriter::applyOptions(options);
+}
+
+void UdpTsWriter::setParam(x265_param* param)
+{
+    param->bAnnexB = true;
+    UdpWriter::setParam(param);
+    _mux.setParam(param);
+}
+
+int UdpTsWriter::writeHeaders(const x265_nal* nal, uint32_t nalcount)
+{
+    _mux.setHeaders(nal, nalcount);
+    teeNals(nal, nalcount, 0, false);
+    return 0;
+}
+
+int UdpTsWriter::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    _mux.mux(nal, nalcount, pic);
+    size_t datagram = TS_DATAGRAM * TsMuxer::PACKET_SIZE;
+    size_t count = (_mux.size() + datagram - 1) / datagram;
+    _msgIov.resize(count);
+    _msgs.resize(count);
+    for (size_t m = 0; m < count; m++)
+    {
+        _msgIov[m].iov_base = (void *)(_mux.data() + m * datagram);
+        _msgIov[m].iov_len = std::min(datagram, _mux.size() - m * datagram);
+        memset(&_msgs[m], 0, sizeof _msgs[m]);
+        _msgs[m].msg_hdr.msg_name = &sa;
+        _msgs[m].msg_hdr.msg_namelen = sizeof sa;
+        _msgs[m].msg_hdr.msg_iov = &_msgIov[m];
+        _msgs[m].msg_hdr.msg_iovlen = 1;
+    }
+    bool sent = sendAll(_msgs.data(), (int)count);
+    teeNals(nal, nalcount, sent ? (ssize_t)_mux.size() : 0);
+    return sent ? (int)_mux.size() : 0;
+}
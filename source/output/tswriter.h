@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "tsmux.h"
+#include "writer.h"
+
+constexpr char TS[] = "ts://";
+constexpr char UDP_TS[] = "udp+ts://";
+
+/* ts://file, the MPEG-TS of tsmux.h written to a file, - for stdout */
+class TsWriter : public x265::OutputFile
+{
+public:
+    TsWriter();
+    ~TsWriter();
+    static TsWriter *construct(const char* fname);
+
+    virtual bool isFail() const override { return !_fp; }
+    //pic_out carries pts and dts only when the CLI is asked for them
+    virtual bool needPTS() const override { return true; }
+    virtual void release() override { delete this; }
+    virtual const char* getName() const override { return "ts"; }
+    virtual void setParam(x265_param* param) override;
+
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+
+protected:
+    FILE *_fp;
+    TsMuxer _mux;
+};
+
+/* udp+ts://ip:port[?tee=file&pace=percent&ttl=hops], the MPEG-TS of tsmux.h
+ * over UDP with the pacing and multicast options of udp://. Datagrams hold
+ * TS_DATAGRAM packets, 1316 bytes, except the last of each access unit
+ * which takes what is left rather than waiting for the next one. tee=
+ * writes the elementary stream. There is no fec= and no streaming of
+ * slices, every PES packet is a whole access unit */
+class UdpTsWriter : public UdpWriter
+{
+public:
+    static UdpTsWriter *construct(const char* fname);
+
+    virtual bool needPTS() const override { return true; }
+    virtual const char* getName() const override { return "udp+ts"; }
+    virtual void setParam(x265_param* param) override;
+    virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
+    virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic) override;
+    virtual bool canStream() const override { return false; }
+
+protected:
+    enum { TS_DATAGRAM = 7 };//packets, the most that fit an Ethernet MTU
+
+    virtual bool applyOptions(std::map<std::string, std::string> &options) override;
+
+    TsMuxer _mux;
+};
@@ -1,5 +1,18 @@
 #include "writer.h"
 
+#include <algorithm>
+#include <errno.h>
+#include <netinet/udp.h>
+
+#include "common.h"
+#include "fec.h"
+
+using namespace X265_NS;
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 //linux/udp.h, for C libraries that predate it
+#endif
+
 BufferWriter::BufferWriter(std::function<int(const unsigned char *data, ssize_t bytes)> writeData)
     : _writeData(writeData)
 {}
@@ -37,19 +50,38 @@ int BufferWriter::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_pictur
 
     return bytes;
 }
+int BufferWriter::writePartial(const x265_nal* nal, uint32_t nalcount, int64_t, bool)
+{
+    x265_picture unused;
+    return writeFrame(nal, nalcount, unused);
+}
+
 void BufferWriter::closeFile(int64_t largest_pts, int64_t second_largest_pts)
 {}
 
 UdpWriter::UdpWriter()
     : sock(-1)
+    , fp(nullptr)
+    , _gso(false)
+    , _datagram(DEFAULT_MTU - IP_UDP_HEADERS)
+    , _gsoDatagrams(MAX_UDP_PAYLOAD / (DEFAULT_MTU - IP_UDP_HEADERS))
+    , _bytesSent(0)
+    , _unitsSent(0)
+    , _fecMedia(0)
+    , _fecParity(0)
+    , _fecIrapParity(0)
+    , _fecBlock(0)
+    , _pace(0)
 {
-    fp = fopen("/tmp/frames.hevc", "wb");
 }
 UdpWriter::~UdpWriter()
 {
     if(sock != -1)
     {close(sock); /* close the socket */}
-    fclose(fp);
+    if(fp)
+    {
+        fclose(fp);
+    }
 }
 bool UdpWriter::initialize()
 {
@@ -67,8 +99,21 @@ bool UdpWriter::initialize()
 
     /* The address is IPv4 */
     sa.sin_family = AF_INET;
+
+    /* segmentation offload, kernels before 4.18 refuse the option */
+    int segment = _datagram;
+    _gso = setsockopt(sock, SOL_UDP, UDP_SEGMENT, &segment, sizeof segment) == 0;
     return true;
 }
+void UdpWriter::setDatagram(int bytes)
+{
+    _datagram = bytes;
+    _gsoDatagrams = std::min(MAX_UDP_PAYLOAD / bytes, (int)MAX_GSO_SEGMENTS);
+    if (_gso)
+    {
+        _gso = setsockopt(sock, SOL_UDP, UDP_SEGMENT, &bytes, sizeof bytes) == 0;
+    }
+}
 void UdpWriter::setendpoint(const char* destinationIp, unsigned short port)
 {
     /* IPv4 adresses is a uint32_t, convert a string representation of the octets to the appropriate value */
@@ -78,86 +123,482 @@ void UdpWriter::setendpoint(const char* destinationIp, unsigned short port)
     sa.sin_port = htons(port);
 
 }
-ssize_t UdpWriter::write(const char *data, ssize_t bytes) const
+bool UdpWriter::setTee(const char *filename)
+{
+    fp = fopen(filename, "wb");
+    if(!fp)
+    {
+        printf("Error opening %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    return true;
+}
+void UdpWriter::setParam(x265_param* param)
+{
+    if (!_pace)
+    {
+        return;
+    }
+    if (param->rc.vbvMaxBitrate <= 0 || param->rc.vbvBufferSize <= 0)
+    {
+        x265_log(NULL, X265_LOG_WARNING, "%s: pace= needs --vbv-maxrate and --vbv-bufsize, sending unpaced\n", getName());
+        return;
+    }
+    double rate = param->rc.vbvMaxBitrate * 1000.0 / 8 * _pace / 100;
+    double depth = param->rc.vbvBufferSize * 1000.0 / 8;
+    if (param->fpsNum && param->fpsDenom)
+    {
+        depth = std::min(depth, rate * param->fpsDenom / param->fpsNum);
+    }
+    _pacer.configure(rate, std::max(depth, (double)_datagram));
+    //segmented messages are bursts too, keep them within the bucket
+    _gsoDatagrams = std::max(1, std::min((int)(depth / _datagram), _gsoDatagrams));
+}
+void UdpWriter::disableGso()
+{
+    int segment = 0;
+    setsockopt(sock, SOL_UDP, UDP_SEGMENT, &segment, sizeof segment);
+    _gso = false;
+}
+int UdpWriter::buildMessages(const struct iovec *iov, int iovcnt, ssize_t offset)
+{
+    /* cut the bytes after offset into messages of msgSize, keeping the
+     * piece ranges by index until _msgIov stops growing */
+    ssize_t msgSize = (ssize_t)_datagram * (_gso ? _gsoDatagrams : 1);
+    std::vector<std::pair<size_t, size_t>> ranges;
+    _msgIov.clear();
+    int i = 0;
+    while (i < iovcnt && offset >= (ssize_t)iov[i].iov_len)
+    {
+        offset -= iov[i++].iov_len;
+    }
+    while (i < iovcnt && ranges.size() < MAX_MESSAGES)
+    {
+        size_t first = _msgIov.size();
+        ssize_t room = msgSize;
+        while (i < iovcnt && room > 0)
+        {
+            ssize_t len = std::min<ssize_t>(iov[i].iov_len - offset, room);
+            _msgIov.push_back({ (char *)iov[i].iov_base + offset, (size_t)len });
+            room -= len;
+            offset += len;
+            if (offset == (ssize_t)iov[i].iov_len)
+            {
+                offset = 0;
+                i++;
+            }
+        }
+        ranges.emplace_back(first, _msgIov.size() - first);
+    }
+
+    _msgs.resize(ranges.size());
+    for (size_t m = 0; m < ranges.size(); m++)
+    {
+        memset(&_msgs[m], 0, sizeof _msgs[m]);
+        _msgs[m].msg_hdr.msg_name = &sa;
+        _msgs[m].msg_hdr.msg_namelen = sizeof sa;
+        _msgs[m].msg_hdr.msg_iov = &_msgIov[ranges[m].first];
+        _msgs[m].msg_hdr.msg_iovlen = ranges[m].second;
+    }
+    return (int)ranges.size();
+}
+ssize_t UdpWriter::write(const struct iovec *iov, int iovcnt)
 {
     if(sock==-1)
     {
         return -1;
     }
-    constexpr ssize_t DATAGRAM_SIZE = 8192;
-    ssize_t total_sent  = 0;
+    ssize_t bytes = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        bytes += iov[i].iov_len;
+    }
+    ssize_t total_sent = 0;
     while(total_sent < bytes)
     {
-        ssize_t bytes_sent = sendto(sock, &data[total_sent], std::min<ssize_t>(DATAGRAM_SIZE, bytes - total_sent), 0,(struct sockaddr*)&sa, sizeof sa);
-        if (bytes_sent < 0)
+        int count = buildMessages(iov, iovcnt, total_sent);
+        int sent = sendMessages(_msgs.data(), count);
+        if (sent < 0)
         {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (_gso && (errno == EINVAL || errno == EIO || errno == EMSGSIZE))
+            {
+                //segments larger than the route MTU or no offload on the device
+                x265_log(NULL, X265_LOG_WARNING, "%s: segmentation offload refused (%s), sending datagrams one at a time\n",
+                         getName(), strerror(errno));
+                disableGso();
+                continue;
+            }
             printf("Error sending packet: %s\n", strerror(errno));
             return -1;
         }
-        total_sent+=bytes_sent;
-//        usleep(1000*100);
+        for (int m = 0; m < sent; m++)
+        {
+            total_sent += _msgs[m].msg_len;
+        }
     }
-    fwrite(data, bytes, 1, fp);
-    fprintf(stderr, "total_sent: %u  \r", total_sent);
     return total_sent;
 }
-
-int UdpWriter::writeHeaders(const x265_nal *nal, uint32_t nalcount)
+ssize_t UdpWriter::write(const char *data, ssize_t bytes)
 {
-    uint32_t bytes = 0;
+    struct iovec iov = { (void *)data, (size_t)bytes };
+    return write(&iov, 1);
+}
 
+int UdpWriter::writeNals(const x265_nal *nal, uint32_t nalcount, bool bLast)
+{
+    _nalIov.resize(nalcount);
     for (uint32_t i = 0; i < nalcount; i++)
     {
-        write((const char*)nal->payload, nal->sizeBytes);
-        bytes += nal->sizeBytes;
-        nal++;
+        _nalIov[i].iov_base = nal[i].payload;
+        _nalIov[i].iov_len = nal[i].sizeBytes;
+    }
+    ssize_t bytes;
+    if (_fecMedia)
+    {
+        //parameter sets get the IRAP protection too, nothing decodes without them
+        bool irap = false;
+        for (uint32_t i = 0; i < nalcount; i++)
+        {
+            irap |= (nal[i].type >= NAL_UNIT_CODED_SLICE_BLA_W_LP && nal[i].type <= NAL_UNIT_CODED_SLICE_CRA) ||
+                    (nal[i].type >= NAL_UNIT_VPS && nal[i].type <= NAL_UNIT_PPS);
+        }
+        bytes = writeFec(_nalIov.data(), (int)nalcount, irap);
+    }
+    else
+    {
+        bytes = write(_nalIov.data(), (int)nalcount);
+    }
+    if (bytes < 0)
+    {
+        return 0;
+    }
+    teeNals(nal, nalcount, bytes, bLast);
+    return (int)bytes;
+}
+
+ssize_t UdpWriter::writeFec(const struct iovec *iov, int iovcnt, bool irap)
+{
+    if(sock==-1)
+    {
+        return -1;
+    }
+    ssize_t bytes = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        bytes += iov[i].iov_len;
     }
+    //one symbol a datagram, a lost IP fragment would take the whole symbol
+    ssize_t symbolPayload = _datagram - FEC_HEADER - FEC_LENGTH;
+    int symbols = (int)((bytes + symbolPayload - 1) / symbolPayload);
+    int blocks = (symbols + _fecMedia - 1) / _fecMedia;
+    int parity = irap ? _fecIrapParity : _fecParity;
+    size_t slot = _datagram;
+    _fecBuf.resize((size_t)(symbols + blocks * parity) * slot);
+    _msgIov.clear();
+
+    uint8_t *out = _fecBuf.data();
+    int piece = 0;
+    size_t offset = 0;//into iov[piece]
+    ssize_t left = bytes;
+    for (int first = 0; first < symbols; first += _fecMedia)
+    {
+        //a short last block keeps the parity ratio, rounded up
+        int k = std::min(_fecMedia, symbols - first);
+        int m = (parity * k + _fecMedia - 1) / _fecMedia;
+        const uint8_t *data[FEC_MAX_DATA];
+        size_t longest = 0;
+        for (int i = 0; i < k + m; i++, out += slot)
+        {
+            out[0] = (uint8_t)i;
+            out[1] = (uint8_t)k;
+            out[2] = (uint8_t)m;
+            out[3] = 0;
+            out[4] = (uint8_t)(_fecBlock >> 24);
+            out[5] = (uint8_t)(_fecBlock >> 16);
+            out[6] = (uint8_t)(_fecBlock >> 8);
+            out[7] = (uint8_t)_fecBlock;
+            uint8_t *symbol = out + FEC_HEADER;
+            if (i >= k)
+            {
+                fecEncode(data, k, i - k, symbol, FEC_LENGTH + longest);
+                _msgIov.push_back({ out, FEC_HEADER + FEC_LENGTH + longest });
+                continue;
+            }
 
+            size_t len = (size_t)std::min(left, symbolPayload);
+            symbol[0] = (uint8_t)(len >> 8);
+            symbol[1] = (uint8_t)len;
+            for (size_t copied = 0; copied < len; )
+            {
+                size_t n = std::min(len - copied, iov[piece].iov_len - offset);
+                memcpy(symbol + FEC_LENGTH + copied, (const char *)iov[piece].iov_base + offset, n);
+                copied += n;
+                offset += n;
+                if (offset == iov[piece].iov_len)
+                {
+                    offset = 0;
+                    piece++;
+                }
+            }
+            //parity runs over the longest symbol, shorter ones count as zero padded
+            memset(symbol + FEC_LENGTH + len, 0, symbolPayload - len);
+            data[i] = symbol;
+            longest = std::max(longest, len);
+            left -= len;
+            _msgIov.push_back({ out, FEC_HEADER + FEC_LENGTH + len });
+        }
+        _fecBlock++;
+    }
+
+    _msgs.resize(_msgIov.size());
+    for (size_t m = 0; m < _msgIov.size(); m++)
+    {
+        memset(&_msgs[m], 0, sizeof _msgs[m]);
+        _msgs[m].msg_hdr.msg_name = &sa;
+        _msgs[m].msg_hdr.msg_namelen = sizeof sa;
+        _msgs[m].msg_hdr.msg_iov = &_msgIov[m];
+        _msgs[m].msg_hdr.msg_iovlen = 1;
+    }
+    if (!sendAll(_msgs.data(), (int)_msgs.size()))
+    {
+        return -1;
+    }
     return bytes;
 }
 
-int UdpWriter::writeFrame(const x265_nal *nal, uint32_t nalcount, x265_picture &)
+void UdpWriter::teeNals(const x265_nal *nal, uint32_t nalcount, ssize_t sent, bool bLast)
+{
+    if (fp)
+    {
+        for (uint32_t i = 0; i < nalcount; i++)
+        {
+            fwrite(nal[i].payload, nal[i].sizeBytes, 1, fp);
+        }
+    }
+    _bytesSent += sent;
+    if (bLast)
+    {
+        _unitsSent++;
+        if (_pacer.enabled())
+        {
+            _pacer.endUnit();
+        }
+    }
+}
+
+int UdpWriter::sendMessages(struct mmsghdr *msgs, int count)
 {
-    int bytes = 0;
+    if (!_pacer.enabled())
+    {
+        return sendmmsg(sock, msgs, count, 0);
+    }
+    _msgBytes.resize(count);
+    for (int m = 0; m < count; m++)
+    {
+        _msgBytes[m] = 0;
+        for (size_t i = 0; i < msgs[m].msg_hdr.msg_iovlen; i++)
+        {
+            _msgBytes[m] += msgs[m].msg_hdr.msg_iov[i].iov_len;
+        }
+    }
+    _pacer.wait(_msgBytes[0]);
+    int n = 1;
+    while (n < count && _pacer.take(_msgBytes[n]))
+    {
+        n++;
+    }
+    int sent = sendmmsg(sock, msgs, n, 0);
+    for (int m = std::max(sent, 0); m < n; m++)
+    {
+        _pacer.refund(_msgBytes[m]);
+    }
+    return sent;
+}
 
-    for (uint32_t i = 0; i < nalcount; i++)
+bool UdpWriter::sendAll(struct mmsghdr *msgs, int count)
+{
+    int done = 0;
+    while (done < count)
     {
-        write((const char*)nal->payload, nal->sizeBytes);
-        bytes += nal->sizeBytes;
-        nal++;
+        int sent = sendMessages(msgs + done, count - done);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("Error sending packet: %s\n", strerror(errno));
+            return false;
+        }
+        done += sent;
     }
+    return true;
+}
 
-    return bytes;
+int UdpWriter::writeHeaders(const x265_nal *nal, uint32_t nalcount)
+{
+    return writeNals(nal, nalcount);
+}
+
+int UdpWriter::writeFrame(const x265_nal *nal, uint32_t nalcount, x265_picture &)
+{
+    return writeNals(nal, nalcount);
+}
+
+int UdpWriter::writePartial(const x265_nal *nal, uint32_t nalcount, int64_t, bool bLast)
+{
+    if (!nalcount)
+    {
+        teeNals(nal, 0, 0, bLast);
+        return 0;
+    }
+    return writeNals(nal, nalcount, bLast);
 }
 
 void UdpWriter::closeFile(int64_t largest_pts, int64_t second_largest_pts)
 {
-//    if (ofs != stdout)
-//        fclose(ofs);
+    if (fp)
+    {
+        fflush(fp);
+    }
+    if (_unitsSent)
+    {
+        x265_log(NULL, X265_LOG_INFO, "%s: sent %llu bytes in %llu access units\n",
+                 getName(), (unsigned long long)_bytesSent, (unsigned long long)_unitsSent);
+    }
+    Pacer::Stats stats = _pacer.GetStats();
+    if (stats.units)
+    {
+        x265_log(NULL, X265_LOG_INFO, "%s: paced at %.0f kbps, %llu of %llu units waited, wait avg %.2f ms max %.2f ms\n",
+                 getName(), _pacer.rate() * 8 / 1000, (unsigned long long)stats.pacedUnits, (unsigned long long)stats.units,
+                 stats.delaySum / 1000.0 / stats.units, stats.maxDelay / 1000.0);
+    }
+}
+
+bool UdpWriter::parseUrl(const char* url, std::string &ip, unsigned short &port, std::map<std::string, std::string> &options)
+{
+    std::string str;
+    if (!OutputFile::parseUrl(url, str, options))
+    {
+        return false;
+    }
+
+    std::size_t colon = str.rfind(':');
+    if (colon == std::string::npos || colon + 1 == str.size())
+    {
+        std::cout << "No port in " << url << "\n";
+        return false;
+    }
+    ip = str.substr(0, colon);
+    port = (unsigned short)atoi(str.c_str() + colon + 1);
+    return true;
+}
+
+bool UdpWriter::applyOptions(std::map<std::string, std::string> &options)
+{
+    auto mtu = options.find("mtu");
+    if (mtu != options.end())
+    {
+        int bytes = atoi(mtu->second.c_str());
+        if (bytes < MIN_MTU || bytes > 65535)
+        {
+            std::cout << "Invalid " << getName() << " mtu " << mtu->second << ", expected " << MIN_MTU << " to 65535\n";
+            return false;
+        }
+        setDatagram(std::min(bytes - IP_UDP_HEADERS, (int)MAX_UDP_PAYLOAD));
+        options.erase(mtu);
+    }
+    auto tee = options.find("tee");
+    if (tee != options.end())
+    {
+        if (!setTee(tee->second.c_str()))
+        {
+            return false;
+        }
+        options.erase(tee);
+    }
+    auto pace = options.find("pace");
+    if (pace != options.end())
+    {
+        _pace = atoi(pace->second.c_str());
+        if (_pace < 0 || _pace > 1000)
+        {
+            std::cout << "Invalid " << getName() << " pace " << pace->second << ", expected a percentage of --vbv-maxrate\n";
+            return false;
+        }
+        options.erase(pace);
+    }
+    auto ttl = options.find("ttl");
+    if (ttl != options.end())
+    {
+        //hops, for multicast groups above all, which default to 1
+        int hops = atoi(ttl->second.c_str());
+        if (hops < 1 || hops > 255 ||
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof hops) ||
+            setsockopt(sock, IPPROTO_IP, IP_TTL, &hops, sizeof hops))
+        {
+            std::cout << "Invalid " << getName() << " ttl " << ttl->second << "\n";
+            return false;
+        }
+        options.erase(ttl);
+    }
+    auto fec = options.find("fec");
+    if (fec != options.end())
+    {
+        int media = 0, parity = -1, irapParity = -1;
+        int fields = sscanf(fec->second.c_str(), "%d:%d:%d", &media, &parity, &irapParity);
+        if (fields == 2)
+        {
+            irapParity = parity;
+        }
+        if (fields < 2 || media < 1 || media > FEC_MAX_DATA ||
+            parity < 0 || parity > FEC_MAX_PARITY || irapParity < 0 || irapParity > FEC_MAX_PARITY)
+        {
+            std::cout << "Invalid " << getName() << " fec " << fec->second << ", expected media:parity[:irap parity] with up to "
+                      << FEC_MAX_DATA << " media and " << FEC_MAX_PARITY << " parity datagrams\n";
+            return false;
+        }
+        _fecMedia = media;
+        _fecParity = parity;
+        _fecIrapParity = irapParity;
+        if (_gso)
+        {
+            disableGso();
+        }
+        options.erase(fec);
+    }
+    for (auto &option : options)
+    {
+        std::cout << "Unknown " << getName() << " output option " << option.first << "\n";
+        return false;
+    }
+    return true;
 }
 
 UdpWriter *UdpWriter::construct(const char* fname)
 {
-    std::string str = &fname[strlen(UDP)];
     std::string ip;
-    std::string port;
-
-    char delim = ':';
-    std::size_t current, previous = 0;
-    current = str.find(delim);
-    while (current != std::string::npos)
+    unsigned short port;
+    std::map<std::string, std::string> options;
+    if (!parseUrl(fname, ip, port, options))
     {
-        ip = str.substr(previous, current - previous);
-        previous = current + 1;
-        current = str.find(delim, previous);
+        return nullptr;
     }
-    port = str.substr(previous, str.size() - previous);
     auto out = new UdpWriter();
     if(!out->initialize())
     {
         delete out;
         return nullptr;
     }
-    out->setendpoint(ip.c_str(), std::stoi(port.c_str()));
+    out->setendpoint(ip.c_str(), port);
+    if (!out->applyOptions(options))
+    {
+        delete out;
+        return nullptr;
+    }
     return out;
 }
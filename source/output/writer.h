@@ -3,15 +3,20 @@
 #include <arpa/inet.h>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <netinet/in.h>
+#include <string>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <vector>
 
 #include "output.h"
+#include "fecreceiver.h"
+#include "pacer.h"
 
 constexpr char BUFFER[] = "buffer://";
 constexpr char UDP[] = "udp://";
@@ -31,12 +36,30 @@ public:
 
     virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
     virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture&) override;
+    virtual bool canStream() const override { return true; }
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
     virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
 
 protected:
     std::function<int(const unsigned char *data, ssize_t bytes)> _writeData;
 };
 
+/* udp://ip:port[?mtu=bytes&tee=file&fec=media:parity[:irap parity]&ttl=hops].
+ * Each access unit, or each slice of it when streaming, goes out as a run
+ * of datagrams that fit the mtu, 1500 by default, so none is fragmented,
+ * handed to the kernel in one sendmmsg call. With UDP_SEGMENT several
+ * datagrams share one message that the kernel splits. fec= adds parity
+ * datagrams to every block of up to media datagrams, irap parity of them
+ * for IRAP pictures, in the layout of fecreceiver.h. Segmentation is off
+ * then as the datagrams differ in size.
+ * pace= with --vbv-maxrate and --vbv-bufsize has a token bucket pace the
+ * messages at that percent of the maxrate. It holds what one frame
+ * interval drains at that rate, at most the VBV buffer, so a picture of
+ * average size leaves in one burst and larger ones, IDRs above all, are
+ * spread out. Pacing sleeps, so a paced writer asks for a writer thread
+ * of its own with isPaced. ip may be a multicast group, ttl= sets how many
+ * hops the datagrams live, 1 by default for groups. tee= also writes the
+ * stream to a file */
 class UdpWriter : public BufferWriter
 {
 public:
@@ -45,14 +68,57 @@ public:
     static UdpWriter *construct(const char* fname);
     bool initialize();
     void setendpoint(const char* destinationIp, unsigned short port);
-    ssize_t write(const char *data, ssize_t bytes) const;
+    bool setTee(const char *filename);
+    ssize_t write(const char *data, ssize_t bytes);
+    ssize_t write(const struct iovec *iov, int iovcnt);
 
+    virtual void setParam(x265_param* param) override;
     virtual int writeHeaders(const x265_nal* nal, uint32_t nalcount) override;
     virtual int writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture&) override;
+    virtual int writePartial(const x265_nal* nal, uint32_t nalcount, int64_t pts, bool bLast) override;
     virtual void closeFile(int64_t largest_pts, int64_t second_largest_pts) override;
+    virtual bool isPaced() const override { return _pace > 0; }
 
 protected:
+    enum { IP_UDP_HEADERS = 28 };//IPv4 without options
+    enum { DEFAULT_MTU = 1500 };//Ethernet
+    enum { MIN_MTU = 576 };//what every IPv4 host takes
+    enum { MAX_UDP_PAYLOAD = 65507 };//also for a segmented message
+    enum { MAX_GSO_SEGMENTS = 64 };//UDP_MAX_SEGMENTS
+    enum { MAX_MESSAGES = 64 };//per sendmmsg call
+
+    //splits scheme://ip:port[?key=value&key=value]
+    static bool parseUrl(const char* url, std::string &ip, unsigned short &port, std::map<std::string, std::string> &options);
+    //takes the options it knows out of options, fails on any left over
+    virtual bool applyOptions(std::map<std::string, std::string> &options);
+    int writeNals(const x265_nal* nal, uint32_t nalcount, bool bLast = true);
+    //bLast ends the access unit
+    void teeNals(const x265_nal* nal, uint32_t nalcount, ssize_t sent, bool bLast = true);
+    int buildMessages(const struct iovec *iov, int iovcnt, ssize_t offset);
+    ssize_t writeFec(const struct iovec *iov, int iovcnt, bool irap);
+    bool sendAll(struct mmsghdr *msgs, int count);
+    //sendmmsg of as many messages as the pacer lets through, at least one
+    int sendMessages(struct mmsghdr *msgs, int count);
+    void disableGso();
+    //payload bytes of each datagram, and so the UDP_SEGMENT size
+    void setDatagram(int bytes);
+
     int sock;
     struct sockaddr_in sa;
-    FILE *fp;
+    FILE *fp;//tee, NULL when off
+    bool _gso;//socket has UDP_SEGMENT set
+    int _datagram;//payload bytes, the MTU less IP and UDP headers
+    int _gsoDatagrams;//per message
+    uint64_t _bytesSent;
+    uint64_t _unitsSent;
+    std::vector<struct iovec> _nalIov;//the access unit being sent
+    std::vector<struct iovec> _msgIov;//its pieces, per message
+    std::vector<struct mmsghdr> _msgs;
+    std::vector<size_t> _msgBytes;//per message, when pacing
+    int _fecMedia;//datagrams per block, 0 without fec
+    int _fecParity, _fecIrapParity;
+    uint32_t _fecBlock;
+    std::vector<uint8_t> _fecBuf;//the datagrams of the access unit
+    int _pace;//percent of vbv-maxrate, 0 when off
+    Pacer _pacer;
 };
@@ -0,0 +1,387 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "colorconvertharness.h"
+
+using namespace X265_NS;
+
+static const char* const rgbPackingStr[NUM_RGB_PACKINGS] = { "rgb", "bgr", "rgba", "bgra", "rgb565" };
+
+ColorConvertHarness::ColorConvertHarness()
+{
+    /* [0] --- Random values
+     * [1] --- Minimum
+     * [2] --- Maximum */
+    for (int i = 0; i < SRC_STRIDE * MAX_HEIGHT; i++)
+    {
+        src_buf[0][i] = rand() & 0xFF;
+        src_buf[1][i] = 0;
+        src_buf[2][i] = 0xFF;
+    }
+
+    /* filtered rows span what bicubic overshoot can produce in Q6 */
+    for (int k = 0; k < MAX_TAPS; k++)
+        for (int i = 0; i < ROW_SIZE; i++)
+            scale_rows[k][i] = (int16_t)(rand() % 20480 - 2048);
+}
+
+/* random even tap counts and coefficients small enough that no sum can
+ * leave the 16bit range of the horizontal output */
+static int randomScaleCoeffs(int16_t* coeffs, int count)
+{
+    int taps = 2 * (1 + rand() % 4);
+    for (int i = 0; i < count * taps; i++)
+        coeffs[i] = (int16_t)(rand() % 6144 - 2048);
+    return taps;
+}
+
+bool ColorConvertHarness::check_rgb2yuv(rgb2yuv_t ref, rgb2yuv_t opt, int csp)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        const RGBToYUVCoeffs* coeffs = &g_rgbToYuvCoeffs[rand() % NUM_RGB_MATRICES];
+
+        /* widths cover vector bodies of every width plus their scalar tails */
+        int width = 2 * (1 + rand() % 160);
+        int height = 2 * (1 + rand() % (MAX_HEIGHT / 2));
+        intptr_t srcStride = SRC_STRIDE - 4 * (rand() % 16);
+        intptr_t strideY = width + rand() % 64;
+        intptr_t strideC = (width >> x265_cli_csps[csp].width[1]) + rand() % 64;
+        int offset = rand() % 16;
+
+        memset(ref_y, 0xCD, sizeof(ref_y));
+        memset(ref_u, 0xCD, sizeof(ref_u));
+        memset(ref_v, 0xCD, sizeof(ref_v));
+        memset(opt_y, 0xCD, sizeof(opt_y));
+        memset(opt_u, 0xCD, sizeof(opt_u));
+        memset(opt_v, 0xCD, sizeof(opt_v));
+
+        ref(src_buf[index] + offset, srcStride, ref_y, strideY, ref_u, ref_v, strideC, width, height, coeffs);
+        checked(opt, src_buf[index] + offset, srcStride, opt_y, strideY, opt_u, opt_v, strideC, width, height, coeffs);
+
+        if (memcmp(ref_y, opt_y, sizeof(ref_y)) ||
+            memcmp(ref_u, opt_u, sizeof(ref_u)) ||
+            memcmp(ref_v, opt_v, sizeof(ref_v)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::check_rgb2gbr(rgb2gbr_t ref, rgb2gbr_t opt)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+
+        int width = 1 + rand() % 320;
+        int height = 1 + rand() % MAX_HEIGHT;
+        intptr_t srcStride = SRC_STRIDE - 4 * (rand() % 16);
+        intptr_t dstStride = width + rand() % 64;
+        int offset = rand() % 16;
+
+        memset(ref_y, 0xCD, sizeof(ref_y));
+        memset(ref_u, 0xCD, sizeof(ref_u));
+        memset(ref_v, 0xCD, sizeof(ref_v));
+        memset(opt_y, 0xCD, sizeof(opt_y));
+        memset(opt_u, 0xCD, sizeof(opt_u));
+        memset(opt_v, 0xCD, sizeof(opt_v));
+
+        ref(src_buf[index] + offset, srcStride, ref_y, ref_u, ref_v, dstStride, width, height);
+        checked(opt, src_buf[index] + offset, srcStride, opt_y, opt_u, opt_v, dstStride, width, height);
+
+        if (memcmp(ref_y, opt_y, sizeof(ref_y)) ||
+            memcmp(ref_u, opt_u, sizeof(ref_u)) ||
+            memcmp(ref_v, opt_v, sizeof(ref_v)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::check_yuyv2yuv(yuyv2yuv_t ref, yuyv2yuv_t opt)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+
+        int width = 2 * (1 + rand() % 160);
+        int height = 2 * (1 + rand() % (MAX_HEIGHT / 2));
+        intptr_t srcStride = SRC_STRIDE - 4 * (rand() % 16);
+        intptr_t strideY = width + rand() % 64;
+        intptr_t strideC = (width >> 1) + rand() % 64;
+        int offset = rand() % 16;
+
+        memset(ref_y, 0xCD, sizeof(ref_y));
+        memset(ref_u, 0xCD, sizeof(ref_u));
+        memset(ref_v, 0xCD, sizeof(ref_v));
+        memset(opt_y, 0xCD, sizeof(opt_y));
+        memset(opt_u, 0xCD, sizeof(opt_u));
+        memset(opt_v, 0xCD, sizeof(opt_v));
+
+        ref(src_buf[index] + offset, srcStride, ref_y, strideY, ref_u, ref_v, strideC, width, height);
+        checked(opt, src_buf[index] + offset, srcStride, opt_y, strideY, opt_u, opt_v, strideC, width, height);
+
+        if (memcmp(ref_y, opt_y, sizeof(ref_y)) ||
+            memcmp(ref_u, opt_u, sizeof(ref_u)) ||
+            memcmp(ref_v, opt_v, sizeof(ref_v)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::check_uvsplit(uvsplit_t ref, uvsplit_t opt)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+
+        int width = 1 + rand() % 320;
+        int height = 1 + rand() % MAX_HEIGHT;
+        intptr_t srcStride = SRC_STRIDE - 4 * (rand() % 16);
+        intptr_t dstStride = width + rand() % 64;
+        int offset = rand() % 16;
+
+        memset(ref_u, 0xCD, sizeof(ref_u));
+        memset(ref_v, 0xCD, sizeof(ref_v));
+        memset(opt_u, 0xCD, sizeof(opt_u));
+        memset(opt_v, 0xCD, sizeof(opt_v));
+
+        ref(src_buf[index] + offset, srcStride, ref_u, ref_v, dstStride, width, height);
+        checked(opt, src_buf[index] + offset, srcStride, opt_u, opt_v, dstStride, width, height);
+
+        if (memcmp(ref_u, opt_u, sizeof(ref_u)) ||
+            memcmp(ref_v, opt_v, sizeof(ref_v)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::check_scaleh(scaleh_t ref, scaleh_t opt, int bpp)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+
+        int width = 1 + rand() % 320;
+        int taps = randomScaleCoeffs(scale_coeffs, width);
+        int srcWidth = taps + rand() % (MAX_WIDTH - taps);
+
+        /* windows ending at the right edge exercise the scalar fallback */
+        for (int x = 0; x < width; x++)
+            scale_pos[x] = (rand() & 3) ? rand() % (srcWidth - taps + 1) : srcWidth - taps;
+
+        memset(ref_s, 0xCD, sizeof(ref_s));
+        memset(opt_s, 0xCD, sizeof(opt_s));
+
+        ref(src_buf[index], ref_s, scale_pos, scale_coeffs, taps, width, srcWidth);
+        checked(opt, src_buf[index], opt_s, scale_pos, scale_coeffs, taps, width, srcWidth);
+
+        if (memcmp(ref_s, opt_s, width * bpp * sizeof(int16_t)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::check_scalev(scalev_t ref, scalev_t opt)
+{
+    const int16_t* rows[MAX_TAPS];
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int16_t coeffs[MAX_TAPS];
+        int taps = randomScaleCoeffs(coeffs, 1);
+        int count = 1 + rand() % (MAX_WIDTH * 3);
+
+        for (int k = 0; k < taps; k++)
+            rows[k] = scale_rows[rand() % MAX_TAPS] + rand() % 16;
+
+        memset(ref_y, 0xCD, sizeof(ref_y));
+        memset(opt_y, 0xCD, sizeof(opt_y));
+
+        ref(rows, ref_y, coeffs, taps, count);
+        checked(opt, rows, opt_y, coeffs, taps, count);
+
+        if (memcmp(ref_y, opt_y, sizeof(ref_y)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool ColorConvertHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
+{
+    for (int p = 0; p < NUM_RGB_PACKINGS; p++)
+    {
+        for (int csp = X265_CSP_I400; csp < X265_CSP_COUNT; csp++)
+        {
+            if (opt.rgb2yuv[p][csp])
+            {
+                if (!check_rgb2yuv(ref.rgb2yuv[p][csp], opt.rgb2yuv[p][csp], csp))
+                {
+                    printf("rgb2yuv[%s][%s] failed\n", rgbPackingStr[p], x265_source_csp_names[csp]);
+                    return false;
+                }
+            }
+        }
+
+        if (opt.rgb2gbr[p])
+        {
+            if (!check_rgb2gbr(ref.rgb2gbr[p], opt.rgb2gbr[p]))
+            {
+                printf("rgb2gbr[%s] failed\n", rgbPackingStr[p]);
+                return false;
+            }
+        }
+    }
+
+    for (int csp = X265_CSP_I400; csp < X265_CSP_COUNT; csp++)
+    {
+        if (opt.yuyv2yuv[csp])
+        {
+            if (!check_yuyv2yuv(ref.yuyv2yuv[csp], opt.yuyv2yuv[csp]))
+            {
+                printf("yuyv2yuv[%s] failed\n", x265_source_csp_names[csp]);
+                return false;
+            }
+        }
+    }
+
+    if (opt.uvsplit)
+    {
+        if (!check_uvsplit(ref.uvsplit, opt.uvsplit))
+        {
+            printf("uvsplit failed\n");
+            return false;
+        }
+    }
+
+    for (int b = 0; b < 2; b++)
+    {
+        if (opt.scaleh[b])
+        {
+            if (!check_scaleh(ref.scaleh[b], opt.scaleh[b], b + 3))
+            {
+                printf("scaleh[%d] failed\n", b + 3);
+                return false;
+            }
+        }
+    }
+
+    if (opt.scalev)
+    {
+        if (!check_scalev(ref.scalev, opt.scalev))
+        {
+            printf("scalev failed\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ColorConvertHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
+{
+    const RGBToYUVCoeffs* coeffs = &g_rgbToYuvCoeffs[RGB_MATRIX_BT709_LIMITED];
+
+    /* two 1080p rows, the smallest unit every color space converts */
+    for (int p = 0; p < NUM_RGB_PACKINGS; p++)
+    {
+        for (int csp = X265_CSP_I400; csp < X265_CSP_COUNT; csp++)
+        {
+            if (opt.rgb2yuv[p][csp])
+            {
+                printf("rgb2yuv[%4s][%s]", rgbPackingStr[p], x265_source_csp_names[csp]);
+                REPORT_SPEEDUP(opt.rgb2yuv[p][csp], ref.rgb2yuv[p][csp],
+                               src_buf[0], SRC_STRIDE, opt_y, MAX_WIDTH, opt_u, opt_v, MAX_WIDTH, MAX_WIDTH, 2, coeffs);
+            }
+        }
+
+        if (opt.rgb2gbr[p])
+        {
+            printf("rgb2gbr[%4s]     ", rgbPackingStr[p]);
+            REPORT_SPEEDUP(opt.rgb2gbr[p], ref.rgb2gbr[p],
+                           src_buf[0], SRC_STRIDE, opt_y, opt_u, opt_v, MAX_WIDTH, MAX_WIDTH, 2);
+        }
+    }
+
+    for (int csp = X265_CSP_I400; csp < X265_CSP_COUNT; csp++)
+    {
+        if (opt.yuyv2yuv[csp])
+        {
+            printf("yuyv2yuv[%s]    ", x265_source_csp_names[csp]);
+            REPORT_SPEEDUP(opt.yuyv2yuv[csp], ref.yuyv2yuv[csp],
+                           src_buf[0], SRC_STRIDE, opt_y, MAX_WIDTH, opt_u, opt_v, MAX_WIDTH, MAX_WIDTH, 2);
+        }
+    }
+
+    if (opt.uvsplit)
+    {
+        printf("uvsplit          ");
+        REPORT_SPEEDUP(opt.uvsplit, ref.uvsplit, src_buf[0], SRC_STRIDE, opt_u, opt_v, MAX_WIDTH, MAX_WIDTH / 2, 2);
+    }
+
+    /* one 1080p output row of a 4K to 1080p downscale by an 8 tap filter,
+     * the source row running on into the next rows of src_buf */
+    int16_t taps[MAX_TAPS];
+    for (int x = 0; x < MAX_WIDTH; x++)
+        scale_pos[x] = X265_MIN(2 * x, MAX_WIDTH * 2 - MAX_TAPS);
+    for (int i = 0; i < MAX_WIDTH * MAX_TAPS; i++)
+        scale_coeffs[i] = 2048;
+    for (int k = 0; k < MAX_TAPS; k++)
+        taps[k] = 2048;
+
+    for (int b = 0; b < 2; b++)
+    {
+        if (opt.scaleh[b])
+        {
+            printf("scaleh[%d]        ", b + 3);
+            REPORT_SPEEDUP(opt.scaleh[b], ref.scaleh[b], src_buf[0], opt_s, scale_pos, scale_coeffs, MAX_TAPS, MAX_WIDTH, MAX_WIDTH * 2);
+        }
+    }
+
+    if (opt.scalev)
+    {
+        const int16_t* rows[MAX_TAPS];
+        for (int k = 0; k < MAX_TAPS; k++)
+            rows[k] = scale_rows[k];
+
+        printf("scalev           ");
+        REPORT_SPEEDUP(opt.scalev, ref.scalev, rows, opt_y, taps, MAX_TAPS, MAX_WIDTH * 3);
+    }
+}
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef _COLORCONVERTHARNESS_H_1
+#define _COLORCONVERTHARNESS_H_1 1
+
+#include "testharness.h"
+#include "primitives.h"
+
+class ColorConvertHarness : public TestHarness
+{
+protected:
+
+    enum { TEST_CASES = 3 };
+    enum { ITERS = 50 };
+    enum { MAX_WIDTH = 1920 };
+    enum { MAX_HEIGHT = 32 };
+    enum { SRC_STRIDE = MAX_WIDTH * 4 };
+    enum { DST_SIZE = MAX_WIDTH * MAX_HEIGHT };
+
+    uint8_t src_buf[TEST_CASES][SRC_STRIDE * MAX_HEIGHT];
+
+    uint8_t ref_y[DST_SIZE], ref_u[DST_SIZE], ref_v[DST_SIZE];
+    uint8_t opt_y[DST_SIZE], opt_u[DST_SIZE], opt_v[DST_SIZE];
+
+    /* scaler tables and rows of horizontally filtered samples */
+    enum { MAX_TAPS = 8 };
+    enum { ROW_SIZE = MAX_WIDTH * 4 + 1 };
+
+    int32_t scale_pos[MAX_WIDTH];
+    ALIGN_VAR_32(int16_t, scale_coeffs[MAX_WIDTH * MAX_TAPS]);
+    int16_t scale_rows[MAX_TAPS][ROW_SIZE];
+    int16_t ref_s[ROW_SIZE], opt_s[ROW_SIZE];
+
+    bool check_rgb2yuv(rgb2yuv_t ref, rgb2yuv_t opt, int csp);
+    bool check_rgb2gbr(rgb2gbr_t ref, rgb2gbr_t opt);
+    bool check_yuyv2yuv(yuyv2yuv_t ref, yuyv2yuv_t opt);
+    bool check_uvsplit(uvsplit_t ref, uvsplit_t opt);
+    bool check_scaleh(scaleh_t ref, scaleh_t opt, int bpp);
+    bool check_scalev(scalev_t ref, scalev_t opt);
+
+public:
+
+    ColorConvertHarness();
+
+    const char *getName() const { return "colorconvert"; }
+
+    bool testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+
+    void measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+};
+
+#endif // ifndef _COLORCONVERTHARNESS_H_1
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "fecharness.h"
+
+using namespace X265_NS;
+
+FecHarness::FecHarness()
+{
+    for (int i = 0; i < BUF_SIZE; i++)
+    {
+        src_buf[i] = rand() & 0xFF;
+        init_buf[i] = rand() & 0xFF;
+    }
+}
+
+bool FecHarness::check_gfmuladd(gfmuladd_t ref, gfmuladd_t opt)
+{
+    for (int i = 0; i < ITERS; i++)
+    {
+        /* 0 and 1 take the shortcuts, the rest the table lookups */
+        uint8_t c = (uint8_t)(i < 2 ? i : rand() & 0xFF);
+        intptr_t size = rand() % MAX_SIZE + 1;
+        int srcOffset = rand() % 32;
+        int dstOffset = rand() % 32;
+
+        memcpy(ref_buf, init_buf, sizeof(ref_buf));
+        memcpy(opt_buf, init_buf, sizeof(opt_buf));
+
+        /* every fourth call scales in place, as the decoder does */
+        if (i & 3)
+        {
+            ref(ref_buf + dstOffset, src_buf + srcOffset, c, size);
+            checked(opt, opt_buf + dstOffset, src_buf + srcOffset, c, size);
+        }
+        else
+        {
+            ref(ref_buf + dstOffset, ref_buf + dstOffset, c, size);
+            checked(opt, opt_buf + dstOffset, opt_buf + dstOffset, c, size);
+        }
+
+        if (memcmp(ref_buf, opt_buf, sizeof(ref_buf)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool FecHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
+{
+    if (opt.gfmuladd)
+    {
+        if (!check_gfmuladd(ref.gfmuladd, opt.gfmuladd))
+        {
+            printf("gfmuladd failed\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FecHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
+{
+    /* one full datagram of parity */
+    if (opt.gfmuladd)
+    {
+        printf("gfmuladd         ");
+        REPORT_SPEEDUP(opt.gfmuladd, ref.gfmuladd, opt_buf, src_buf, 0x53, 1472);
+    }
+}
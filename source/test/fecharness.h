@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef _FECHARNESS_H_1
+#define _FECHARNESS_H_1 1
+
+#include "testharness.h"
+#include "primitives.h"
+
+class FecHarness : public TestHarness
+{
+protected:
+
+    enum { ITERS = 100 };
+    enum { MAX_SIZE = 1500 * 2 };
+    enum { BUF_SIZE = MAX_SIZE + 64 };
+
+    uint8_t src_buf[BUF_SIZE];
+    uint8_t init_buf[BUF_SIZE];
+    uint8_t ref_buf[BUF_SIZE];
+    uint8_t opt_buf[BUF_SIZE];
+
+    bool check_gfmuladd(gfmuladd_t ref, gfmuladd_t opt);
+
+public:
+
+    FecHarness();
+
+    const char *getName() const { return "fec"; }
+
+    bool testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+
+    void measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+};
+
+#endif // ifndef _FECHARNESS_H_1
@@ -30,7 +30,11 @@
 
 #include "input/input.h"
 #include "output/output.h"
+#include "output/asyncoutput.h"
+#include "output/fanout.h"
+#include "output/feedback.h"
 #include "output/reconplay.h"
+#include "output/writer.h"
 #include "svt.h"
 
 #if HAVE_VLD
@@ -89,6 +93,10 @@ struct CLIOptions
     bool bProgress;
     bool bForceY4m;
     bool bDither;
+    bool bStreamSlices;         // output takes each slice from the encoder's NAL callback
+    const char* feedbackAddress;
+    FeedbackListener* feedback; // receiver reports, NULL without --feedback
+    FanOutput* fanOut;          // the output when -o lists several destinations, else NULL
     uint32_t seek;              // number of frames to skip from the beginning
     uint32_t framesToBeEncoded; // number of frames to encode
     uint64_t totalbytes;
@@ -117,10 +125,17 @@ struct CLIOptions
         startTime = x265_mdate();
         prevUpdateTime = 0;
         bDither = false;
+        bStreamSlices = false;
+        feedbackAddress = NULL;
+        feedback = NULL;
+        fanOut = NULL;
     }
 
     void destroy();
     void printStatus(uint32_t frameNum);
+    uint32_t writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic);
+    bool applyFeedback(x265_encoder* encoder, x265_picture* pic);
+    bool pollFeedback(x265_encoder* encoder);
     bool parse(int argc, char **argv, Reader *reader, std::function<int(const unsigned char *data, ssize_t bytes)> writeEncodedFrame);
     bool parseZoneParam(int argc, char **argv, x265_param* globalParam, int zonefileCount);
     bool parseQPFile(x265_picture &pic_org);
@@ -147,6 +162,17 @@ void CLIOptions::destroy()
     if (output)
         output->release();
     output = NULL;
+    fanOut = NULL;
+    if (feedback)
+    {
+        FeedbackListener::Stats stats = feedback->GetStats();
+        x265_log(NULL, X265_LOG_INFO, "feedback: %llu reports, %llu ignored, %llu bitrate changes, %llu intra refreshes, %llu lost pictures\n",
+                 (unsigned long long)stats.reports, (unsigned long long)stats.invalid,
+                 (unsigned long long)stats.changes, (unsigned long long)stats.refreshes,
+                 (unsigned long long)stats.lostPictures);
+        delete feedback;
+    }
+    feedback = NULL;
 }
 
 void CLIOptions::printStatus(uint32_t frameNum)
@@ -176,6 +202,94 @@ void CLIOptions::printStatus(uint32_t frameNum)
     prevUpdateTime = time;
 }
 
+uint32_t CLIOptions::writeFrame(const x265_nal* nal, uint32_t nalcount, x265_picture& pic)
+{
+    if (!bStreamSlices)
+        return output->writeFrame(nal, nalcount, pic);
+
+    /* already written, slice by slice, from the NAL callback */
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+        bytes += nal[i].sizeBytes;
+    return bytes;
+}
+
+/* Applies what the receiver reports, and fan-out destinations that fell
+ * behind, asked for since the previous picture. Rates scale the starting
+ * --bitrate and VBV together, keeping the buffer duration. Receiver refreshes
+ * use periodic intra refresh when it is on. Otherwise, and always for a
+ * destination, which resumes only at an IRAP, pic becomes an IDR and true is
+ * returned */
+bool CLIOptions::applyFeedback(x265_encoder* encoder, x265_picture* pic)
+{
+    bool resync = fanOut && fanOut->takeRefresh();
+    bool refresh = feedback && pollFeedback(encoder);
+
+    if (!resync && !refresh)
+        return false;
+    if (!resync && param->bIntraRefresh)
+    {
+        api->encoder_intra_refresh(encoder);
+        return false;
+    }
+    if (!pic)
+        return false;
+    pic->sliceType = X265_TYPE_IDR;
+    return true;
+}
+
+/* Retargets the bitrate and invalidates lost references, true when the
+ * receiver needs a refresh */
+bool CLIOptions::pollFeedback(x265_encoder* encoder)
+{
+    double target;
+    bool refresh;
+    bool retarget = feedback->poll(target, refresh);
+
+    /* Predict around pictures the receiver lost. Once the picture has left
+     * the DPB that is no longer possible, refresh instead */
+    std::vector<int> lostPictures;
+    if (feedback->takeLostPictures(lostPictures))
+    {
+        for (int poc : lostPictures)
+        {
+            if (api->encoder_invalidate_reference(encoder, poc) < 0)
+                refresh = true;
+        }
+    }
+
+    double start = param->rc.vbvMaxBitrate > 0 ? param->rc.vbvMaxBitrate : param->rc.bitrate;
+    if (retarget && start > 0)
+    {
+        double scale = target / start;
+        x265_param* p = api->param_alloc();
+        api->encoder_parameters(encoder, p);
+        if (p->rc.rateControlMode == X265_RC_ABR)
+            p->rc.bitrate = X265_MAX((int)(param->rc.bitrate * scale), 1);
+        if (p->rc.vbvMaxBitrate > 0 && p->rc.vbvBufferSize > 0)
+        {
+            p->rc.vbvMaxBitrate = X265_MAX((int)(param->rc.vbvMaxBitrate * scale), 1);
+            p->rc.vbvBufferSize = X265_MAX((int)(param->rc.vbvBufferSize * scale), 1);
+        }
+        /* 1 is a reconfigure still in progress, poll offers the target again */
+        int ret = api->encoder_reconfig(encoder, p);
+        if (!ret)
+        {
+            feedback->applied(target);
+            x265_log(NULL, X265_LOG_DEBUG, "feedback: bitrate %.0f kbps\n", target);
+        }
+        else if (ret < 0)
+            feedback->applied(target); // not taken, do not retry every picture
+        api->param_free(p);
+    }
+    return refresh;
+}
+
+static void streamNals(void *opaque, const x265_nal *nal, uint32_t nalcount, int64_t pts, int bLast)
+{
+    static_cast<OutputFile*>(opaque)->writePartial(nal, nalcount, pts, !!bLast);
+}
+
 bool CLIOptions::parseZoneParam(int argc, char **argv, x265_param* globalParam, int zonefileCount)
 {
     bool bError = false;
@@ -287,6 +401,8 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
     int inputBitDepth = 8;
     int outputBitDepth = 0;
     int reconFileBitDepth = 0;
+    int outputWidth = 0, outputHeight = 0;
+    int outputQueue = 0;
     const char *inputfn = NULL;
     const char *reconfn = NULL;
     const char *outputfn = NULL;
@@ -423,8 +539,19 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
             if (0) ;
             OPT2("frame-skip", "seek") this->seek = (uint32_t)x265_atoi(optarg, bError);
             OPT("frames") this->framesToBeEncoded = (uint32_t)x265_atoi(optarg, bError);
+            OPT("loop") reader->args.Loop = true;
+            OPT("no-loop") reader->args.Loop = false;
+            OPT("capture-policy") bError |= !Reader::ParseCapturePolicy(optarg, reader->args.Policy);
+            OPT("raw-format") bError |= !Reader::ParseFormat(optarg, reader->args.Format);
+            OPT("output-res") bError |= sscanf(optarg, "%dx%d", &outputWidth, &outputHeight) != 2 || outputWidth <= 0 || outputHeight <= 0;
+            OPT("scale-filter") bError |= !RgbScaler::ParseFilter(optarg, reader->args.ScaleFilter);
+            OPT("progressive-input") reader->args.Progressive = true;
+            OPT("reader-threads") bError |= (reader->args.Threads = x265_atoi(optarg, bError)) < 0;
             OPT("no-progress") this->bProgress = false;
             OPT("output") outputfn = optarg;
+            OPT("output-queue") outputQueue = x265_atoi(optarg, bError);
+            OPT("stream-slices") this->bStreamSlices = true;
+            OPT("feedback") this->feedbackAddress = optarg;
             OPT("input") inputfn = optarg;
             OPT("recon") reconfn = optarg;
             OPT("input-depth") inputBitDepth = (uint32_t)x265_atoi(optarg, bError);
@@ -534,9 +661,22 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
     getParamAspectRatio(param, info.sarWidth, info.sarHeight);
 
     reader->args.device.Name = inputfn;
+    /* --colormatrix gbr: skip the colour conversion, the planes carry G, B, R */
+    reader->args.Gbr = param->vui.matrixCoeffs == 0;
+    /* otherwise convert with the matrix and range the VUI describes */
+    reader->args.MatrixCoeffs = param->vui.matrixCoeffs;
+    reader->args.FullRange = !!param->vui.bEnableVideoFullRangeFlag;
+    /* --output-res: capture at --input-res and encode the scaled frames */
+    if (outputWidth && (outputWidth != info.width || outputHeight != info.height))
+    {
+        reader->args.CaptureWidth = info.width;
+        reader->args.CaptureHeight = info.height;
+        info.width = outputWidth;
+        info.height = outputHeight;
+    }
 
     this->input = InputFile::open(info, this->bForceY4m);
-    if (!reader && (!this->input || this->input->isFail()))
+    if (!this->input || this->input->isFail())
     {
         x265_log_file(param, X265_LOG_ERROR, "unable to open input file <%s>\n", inputfn);
         return true;
@@ -595,6 +735,10 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
     if (api->param_apply_profile(param, profile))
         return true;
 
+    /* slices can only be sent as they complete when frames are coded one at a time */
+    if (this->bStreamSlices && !param->frameNumThreads)
+        param->frameNumThreads = 1;
+
     if (param->logLevel >= X265_LOG_INFO)
     {
         char buf[128];
@@ -614,8 +758,6 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
         general_log(param, input->getName(), X265_LOG_INFO, "%s\n", buf);
     }
 
-    this->input->startReader();
-
     if (reconfn)
     {
         if (reconFileBitDepth == 0)
@@ -658,12 +800,27 @@ bool CLIOptions::parse(int argc, char **argv, Reader *reader, std::function<int(
         return true;
     }
 #endif
-    this->output = OutputFile::open(outputfn, info, writeEncodedFrame);
-    if (this->output->isFail())
+    if (FanOutput::isDestination(outputfn) && strchr(outputfn, ','))
+    {
+        /* each destination queues on its own thread, no AsyncOutput in front */
+        fanOut = FanOutput::construct(outputfn, info, outputQueue > 0 ? outputQueue : 16);
+        this->output = fanOut;
+    }
+    else
+        this->output = OutputFile::open(outputfn, info, writeEncodedFrame);
+    if (!this->output || this->output->isFail())
     {
         x265_log_file(param, X265_LOG_ERROR, "failed to open output file <%s> for writing\n", outputfn);
         return true;
     }
+    if ((outputQueue > 0 || this->output->isPaced()) && !fanOut && strncmp(outputfn, BUFFER, strlen(BUFFER)))
+    {
+        /* keep encoder_encode fed while the output blocks on the network or disk,
+         * or sleeps to pace. The buffer:// callback stays on the thread that calls x265main */
+        OutputFile *async = AsyncOutput::construct(this->output, outputQueue > 0 ? outputQueue : 16);
+        if (async)
+            this->output = async;
+    }
     general_log_file(param, this->output->getName(), X265_LOG_INFO, "output file: %s\n", outputfn);
     return false;
 }
@@ -852,7 +1009,7 @@ static int rpuParser(x265_picture * pic, FILE * ptr)
 
 int x265main(int argc,
              char **argv,
-             std::function<int(char **data, ssize_t *bytes, int width, int height)> readRgb888,
+             ReadRawFrame readFrame,
              std::function<int(const unsigned char *data, ssize_t bytes)> writeEncodedFrame,
              std::atomic<bool> &killed
              )//--input /dev/screen --input-res 1920x1080 --fps 5 --preset ultrafast --tune psnr --tune ssim --tune fastdecode  --tune zerolatency --output udp://127.0.0.1:7878
@@ -865,7 +1022,7 @@ int x265main(int argc,
     THREAD_NAME("API", 0);
 
     /////osm
-    Reader reader(readRgb888);
+    Reader reader(readFrame);
     if(!reader.ParseDevicesFromCommandLine(argc, argv))
     {
         return -1;
@@ -928,6 +1085,37 @@ int x265main(int argc,
     /* get the encoder parameters post-initialization */
     api->encoder_parameters(encoder, param);
 
+    if (cliopt.bStreamSlices)
+    {
+        if (!cliopt.output->canStream())
+        {
+            x265_log(param, X265_LOG_WARNING, "%s output cannot send partial access units, ignoring --stream-slices\n", cliopt.output->getName());
+            cliopt.bStreamSlices = false;
+        }
+        else if (api->encoder_set_nal_callback(encoder, streamNals, cliopt.output) < 0)
+            cliopt.bStreamSlices = false;
+    }
+
+    if (cliopt.feedbackAddress)
+    {
+        double start = param->rc.vbvMaxBitrate > 0 ? param->rc.vbvMaxBitrate : param->rc.bitrate;
+        if (start <= 0)
+            x265_log(param, X265_LOG_WARNING, "feedback: no --bitrate or --vbv-maxrate to adapt, reports only trigger intra refreshes\n");
+        cliopt.feedback = FeedbackListener::construct(cliopt.feedbackAddress, start, start / 16, start);
+        if (!cliopt.feedback)
+        {
+            api->encoder_close(encoder);
+            cliopt.destroy();
+            api->param_free(param);
+            api->cleanup();
+            exit(2);
+        }
+    }
+
+    /* the device reader converts with the encoder primitives, which are only
+     * set up once the encoder is open */
+    cliopt.input->startReader();
+
      /* Control-C handler */
     if (signal(SIGINT, sigint_handler) == SIG_ERR)
         x265_log(param, X265_LOG_ERROR, "Unable to register CTRL+C handler: %s\n", strerror(errno));
@@ -1017,8 +1205,9 @@ int x265main(int argc,
                 x265_dither_image(pic_in, cliopt.input->getWidth(), cliopt.input->getHeight(), errorBuf, param->internalBitDepth);
                 pic_in->bitDepth = param->internalBitDepth;
             }
-            /* Overwrite PTS */
-            pic_in->pts = pic_in->poc;
+            /* Overwrite PTS, live inputs stamp their capture time */
+            if (!cliopt.input->isLive())
+                pic_in->pts = pic_in->poc;
 
             // convert to field
             if (param->bField && param->interlaceMode)
@@ -1116,7 +1305,10 @@ int x265main(int argc,
             else
                 picInput = pic_in;
 
+            bool bFeedbackIdr = cliopt.applyFeedback(encoder, picInput);
             int numEncoded = api->encoder_encode( encoder, &p_nal, &nal, picInput, pic_recon );
+            if (bFeedbackIdr)
+                picInput->sliceType = X265_TYPE_AUTO;
             if( numEncoded < 0 )
             {
                 b_ctrl_c = 1;
@@ -1133,7 +1325,7 @@ int x265main(int argc,
                 cliopt.recon->writePicture(pic_out);
             if (nal)
             {
-                cliopt.totalbytes += cliopt.output->writeFrame(p_nal, nal, pic_out);
+                cliopt.totalbytes += cliopt.writeFrame(p_nal, nal, pic_out);
                 if (pts_queue)
                 {
                     pts_queue->push(-pic_out.pts);
@@ -1163,7 +1355,7 @@ int x265main(int argc,
             cliopt.recon->writePicture(pic_out);
         if (nal)
         {
-            cliopt.totalbytes += cliopt.output->writeFrame(p_nal, nal, pic_out);
+            cliopt.totalbytes += cliopt.writeFrame(p_nal, nal, pic_out);
             if (pts_queue)
             {
                 pts_queue->push(-pic_out.pts);
@@ -1245,12 +1437,37 @@ fail:
 
     return ret;
 }
+/* packed RGB24 sources */
+int x265main(int argc,
+             char **argv,
+             ReadRgb888Damage readRgb888,
+             std::function<int(const unsigned char *data, ssize_t bytes)> writeEncodedFrame,
+             std::atomic<bool> &killed)
+{
+    return x265main(argc, argv, ReadRawFrameFromRgb888(readRgb888), writeEncodedFrame, killed);
+}
+/* for sources that cannot report damage, every frame is converted whole */
+int x265main(int argc,
+             char **argv,
+             ReadRgb888 readRgb888,
+             std::function<int(const unsigned char *data, ssize_t bytes)> writeEncodedFrame,
+             std::atomic<bool> &killed)
+{
+    ReadRgb888Damage readDamaged;
+    if (readRgb888)
+        readDamaged = [readRgb888](char **data, ssize_t *bytes, int width, int height, RgbDamage *)
+        {
+            return readRgb888(data, bytes, width, height);
+        };
+    return x265main(argc, argv, readDamaged, writeEncodedFrame, killed);
+}
+
 #ifndef USE_X265_LIB
 int main(int argc, char **argv)
 {
     std::atomic<bool> killed;
     return x265main(argc, argv,
-                    nullptr, //todo: provide lambda function that will read rgb888 data
+                    ReadRawFrame(), //todo: provide lambda function that will read captured frames
                     nullptr, //todo: provide lambda function that will do something with the encoded data
                     killed);
 }
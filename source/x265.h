@@ -476,6 +476,29 @@ typedef struct x265_picture
     uint32_t picStruct;
 
     int    width;
+
+    /* An optional array of change flags, one byte for each 16x16 block of the
+     * picture in raster order (the same layout as quantOffsets). Zero marks a
+     * block whose pixels are identical to the previous input picture's. The
+     * encoder codes a CTU made only of unchanged blocks as a zero motion skip
+     * without mode analysis, when the previous picture is its first L0
+     * reference. NULL when the application does not track changes */
+    uint8_t *changeMap;
+
+    /* Optional, lets the encoder start on a picture whose planes are still
+     * being written. Called from encoder threads with a count of luma rows
+     * from the top, it must block until at least that many luma rows, and
+     * the chroma rows beneath them, are in the planes and then return the
+     * number of luma rows written. The planes must stay valid until
+     * x265_encoder_encode returns. Rows are read as the CTU rows that need
+     * them are started only when the encoder can decide the picture without
+     * its pixels: no lookahead, B frames, frame threads or slices (as
+     * --tune zerolatency), constant QP, no adaptive quantization, weighted
+     * prediction, scenecut detection or analysis save/load. Otherwise
+     * x265_encoder_encode waits for the whole picture before copying it. NULL
+     * when the planes are complete */
+    int (*rowsReady)(void *opaque, int rows);
+    void *rowsOpaque;
 } x265_picture;
 
 typedef enum
@@ -2078,6 +2101,39 @@ int x265_encoder_intra_refresh(x265_encoder *);
  */
 int x265_encoder_ctu_info(x265_encoder *, int poc, x265_ctu_info_t** ctu);
 
+/* x265_nal_callback:
+ *    receives an access unit piece by piece while its picture is still being
+ *    coded. Called on an encoder worker thread; the NALs are valid only until
+ *    the callback returns. pts is the picture's presentation time stamp and
+ *    bLast is set on the final call of each access unit, which may carry no
+ *    NALs. */
+typedef void (*x265_nal_callback)(void *opaque, const x265_nal *nal, uint32_t numNal, int64_t pts, int bLast);
+
+/* x265_encoder_set_nal_callback:
+ *    Register a callback that is given each slice NAL, along with the NALs
+ *    ahead of it, as soon as all of its CTU rows are entropy coded, so the
+ *    first bytes of an access unit can be sent before x265_encoder_encode
+ *    returns. Slices are only sent early when SAO is disabled, since SAO is
+ *    coded once the whole picture has been filtered; otherwise the access
+ *    unit arrives in one call when the picture is complete. Every access unit
+ *    is given to the callback in decode order and is also still returned by
+ *    x265_encoder_encode. Requires frameNumThreads to be 1 and must be called
+ *    before the first picture is encoded; a NULL callback unregisters.
+ *    Returns 0 on success, negative on error. */
+int x265_encoder_set_nal_callback(x265_encoder *, x265_nal_callback callback, void *opaque);
+
+/* x265_encoder_invalidate_reference:
+ *    Tell the encoder the receiver lost the picture with the given POC. That
+ *    picture, and every picture predicted from it, are never used for
+ *    reference again, so later pictures predict from the newest picture the
+ *    receiver can still decode. A picture left with no valid reference is
+ *    coded as an I slice, and a B picture left with no future reference as
+ *    a P slice; maxNumReferences above 1 keeps an older picture to predict
+ *    from. Should not be called during an x265_encoder_encode.
+ *    Returns 0 on success, negative if the picture is no longer (or not yet)
+ *    held for reference. */
+int x265_encoder_invalidate_reference(x265_encoder *, int poc);
+
 /* x265_get_slicetype_poc_and_scenecut:
  *     get the slice type, poc and scene cut information for the current frame,
  *     returns negative on error, 0 when access unit were output.
@@ -2194,6 +2250,8 @@ typedef struct x265_api
     void          (*vmaf_encoder_log)(x265_encoder*, int, char**, x265_param *, x265_vmaf_data *);
 #endif
     int           (*zone_param_parse)(x265_param*, const char*, const char*);
+    int           (*encoder_set_nal_callback)(x265_encoder*, x265_nal_callback, void*);
+    int           (*encoder_invalidate_reference)(x265_encoder*, int);
     /* add new pointers to the end, or increment X265_MAJOR_VERSION */
 } x265_api;
 
@@ -78,6 +78,17 @@ static const struct option long_options[] =
     { "fps",            required_argument, NULL, 0 },
     { "seek",           required_argument, NULL, 0 },
     { "frame-skip",     required_argument, NULL, 0 },
+    { "loop",                 no_argument, NULL, 0 },
+    { "no-loop",              no_argument, NULL, 0 },
+    { "capture-policy", required_argument, NULL, 0 },
+    { "raw-format",     required_argument, NULL, 0 },
+    { "output-res",     required_argument, NULL, 0 },
+    { "output-queue",   required_argument, NULL, 0 },
+    { "stream-slices",        no_argument, NULL, 0 },
+    { "feedback",       required_argument, NULL, 0 },
+    { "scale-filter",   required_argument, NULL, 0 },
+    { "progressive-input",    no_argument, NULL, 0 },
+    { "reader-threads", required_argument, NULL, 0 },
     { "frames",         required_argument, NULL, 'f' },
     { "recon",          required_argument, NULL, 'r' },
     { "recon-depth",    required_argument, NULL, 0 },
@@ -375,13 +386,31 @@ static void showHelp(x265_param *param)
 
     H0("\nSyntax: x265 [options] infile [-o] outfile\n");
     H0("    infile can be YUV or Y4M\n");
-    H0("    outfile is raw HEVC bitstream\n");
+    H0("    outfile is raw HEVC bitstream, fragmented MP4 if it ends in .mp4\n");
     H0("\nExecutable Options:\n");
     H0("-h/--help                        Show this help text and exit\n");
     H0("   --fullhelp                    Show all options and exit\n");
     H0("-V/--version                     Show version info and exit\n");
     H0("\nOutput Options:\n");
     H0("-o/--output <filename>           Bitstream output file name\n");
+    H0("                                 udp://ip:port[?mtu=1500&tee=file&fec=media:parity[:irap parity]&pace=percent&ttl=1] sends it over UDP, tee= also writes it to file,\n");
+    H0("                                 ttl= sets the hops datagrams live, for multicast groups,\n");
+    H0("                                 fec= adds parity datagrams per block of media datagrams, more for IRAP pictures if given,\n");
+    H0("                                 pace= sends at that percentage of --vbv-maxrate on a writer thread of its own. Default unpaced\n");
+    H0("                                 rtp://ip:port[?mtu=1500&pt=96&tee=file&pace=percent&nack=ms] sends RFC 7798 RTP packets,\n");
+    H0("                                 nack= resends packets of the last ms milliseconds that receivers ask for with RTCP NACKs\n");
+    H0("                                 mp4://file[?fragment=gop|frame] writes fragmented MP4, a moof and mdat per GOP or per frame\n");
+    H0("                                 ts://file writes MPEG-TS, udp+ts://ip:port[?tee=file&pace=percent&ttl=1] sends it 7 packets a datagram\n");
+    H0("                                 shm://name[?size=16&wait=ms] puts access units in a ring in /dev/shm for a reader on this host,\n");
+    H0("                                 blocking while it is full, wait= drops after ms. shmcat is a test reader\n");
+    H0("                                 udp://, rtp://, udp+ts:// and shm:// destinations separated by commas each get a queue of --output-queue\n");
+    H0("                                 access units, 16 when 0, one that falls behind skips to the next IRAP picture\n");
+    H0("   --output-queue <integer>      Access units queued for a writer thread, 0 writes on the encoding thread unless paced. Default 0\n");
+    H0("   --stream-slices               Send each slice to a udp, rtp or buffer output as soon as it is coded. Needs --no-sao and --frame-threads 1\n");
+    H0("   --feedback <[ip:]port>        Take receiver reports (RTCP RR/REMB/PLI/FIR or loss= jitter= rate= estimate= lost=\n");
+    H0("                                 pli= text) there, to adapt --bitrate and --vbv-maxrate within 1/16 of their start and to\n");
+    H0("                                 refresh on PLI, FIR or pli=1. Lost packets alone are left to fec=, nack= and lostpoc=.\n");
+    H0("                                 lostpoc=<n> stops referencing picture n and those predicted from it, best with --ref 2 or more\n");
     H0("-D/--output-depth 8|10|12        Output bit depth (also internal bit depth). Default %d\n", param->internalBitDepth);
     H0("   --log-level <string>          Logging level: none error warning info debug full. Default %s\n", X265_NS::logLevelNames[param->logLevel + 1]);
     H0("   --no-progress                 Disable CLI progress reports\n");
@@ -408,6 +437,13 @@ static void showHelp(x265_param *param)
     H0("   --nalu-file <filename>        Text file containing SEI messages in the following format : <POC><space><PREFIX><space><NAL UNIT TYPE>/<SEI TYPE><space><SEI Payload>\n");
     H0("-f/--frames <integer>            Maximum number of frames to encode. Default all\n");
     H0("   --seek <integer>              First frame to encode\n");
+    H0("   --[no-]loop                   Restart raw RGB file input at its first frame when it ends. Default disabled\n");
+    H0("   --capture-policy <string>     Live capture when the encoder falls behind --fps: drop-oldest, drop-newest, duplicate. Default drop-oldest\n");
+    H0("   --raw-format <string>         Pixel format of raw device and file input: rgb, bgr, rgba, bgra, rgb565, nv12, yuyv. Default rgb\n");
+    H0("   --output-res WxH              Scale raw RGB input captured at --input-res to this size before encoding\n");
+    H0("   --scale-filter <string>       Filter of --output-res scaling: bilinear, bicubic, area. Default bicubic\n");
+    H0("   --progressive-input           Start encoding each live capture while it is converted. Needs --tune zerolatency, constant QP and no scenecut. Default disabled\n");
+    H0("   --reader-threads <integer>    Threads of the reader's own converting live RGB captures, on top of the encoder's. Default 0, the capture thread converts\n");
     H1("   --[no-]interlace <bff|tff>    Indicate input pictures are interlace fields in temporal order. Default progressive\n");
     H0("   --[no-]field                  Enable or disable field coding. Default %s\n", OPT( param->bField));
     H1("   --dither                      Enable dither if downscaling to 8 bit pixels. Default disabled\n");
@@ -625,6 +661,7 @@ static void showHelp(x265_param *param)
     H0("                                 bt2020-10, bt2020-12, smpte2084, smpte428, arib-std-b67. Default undef\n");
     H1("   --colormatrix <string>        Specify color matrix setting from undef, bt709, fcc, bt470bg, smpte170m,\n");
     H1("                                 smpte240m, GBR, YCgCo, bt2020nc, bt2020c, smpte2085, chroma-derived-nc, chroma-derived-c, ictcp. Default undef\n");
+    H1("                                 With RGB device input gbr encodes the G, B, R planes unconverted, needs i444\n");
     H1("   --chromaloc <integer>         Specify chroma sample location (0 to 5). Default of %d\n", param->vui.chromaSampleLocTypeTopField);
     H0("   --master-display <string>     SMPTE ST 2086 master display color volume info SEI (HDR)\n");
     H0("                                    format: G(x,y)B(x,y)R(x,y)WP(x,y)L(max,min)\n");